@@ -0,0 +1,288 @@
+/*
+ * dvbepgtest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QtTest>
+#include "dvb/dvbepg.h"
+
+class DvbEpgTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void expiryHeapOrder();
+	void expiryHeapEqualEnds();
+	void expiryHeapRebuild();
+	void textIndexWords();
+	void textIndexPartialWords();
+	void textIndexRemove();
+	void textIndexWithoutWords();
+
+private:
+	static DvbSharedEpgEntry makeEntry(const QDateTime &end);
+	static DvbSharedEpgEntry makeEntry(const QString &title, const QString &subheading,
+		const QString &details);
+};
+
+DvbSharedEpgEntry DvbEpgTest::makeEntry(const QDateTime &end)
+{
+	DvbEpgEntry *entry = new DvbEpgEntry();
+	entry->begin = end.addSecs(-3600);
+	entry->duration = QTime(1, 0);
+	entry->end = end;
+	return DvbSharedEpgEntry(entry);
+}
+
+DvbSharedEpgEntry DvbEpgTest::makeEntry(const QString &title, const QString &subheading,
+	const QString &details)
+{
+	DvbEpgEntry *entry = new DvbEpgEntry();
+	entry->title = title;
+	entry->subheading = subheading;
+	entry->details = details;
+	return DvbSharedEpgEntry(entry);
+}
+
+void DvbEpgTest::expiryHeapOrder()
+{
+	QDateTime now = QDateTime(QDate(2026, 1, 1), QTime(12, 0), Qt::UTC);
+	DvbEpgExpiryHeap heap;
+	QList<int> offsets = QList<int>() << 300 << -60 << 0 << 7200 << -3600 << 60 << -1;
+
+	foreach (int offset, offsets) {
+		heap.insert(makeEntry(now.addSecs(offset)));
+	}
+
+	QCOMPARE(heap.size(), offsets.size());
+	DvbSharedEpgEntry entry;
+
+	// the entries which end at or before 'now' are taken in the order of their end
+	QVERIFY(heap.takeExpired(now, entry));
+	QCOMPARE(entry->end, now.addSecs(-3600));
+	QVERIFY(heap.takeExpired(now, entry));
+	QCOMPARE(entry->end, now.addSecs(-60));
+	QVERIFY(heap.takeExpired(now, entry));
+	QCOMPARE(entry->end, now.addSecs(-1));
+	QVERIFY(heap.takeExpired(now, entry));
+	QCOMPARE(entry->end, now);
+	QVERIFY(!heap.takeExpired(now, entry));
+	QCOMPARE(heap.size(), 3);
+
+	heap.insert(makeEntry(now.addSecs(30)));
+	QVERIFY(heap.takeExpired(now.addSecs(100), entry));
+	QCOMPARE(entry->end, now.addSecs(30));
+	QVERIFY(heap.takeExpired(now.addSecs(100), entry));
+	QCOMPARE(entry->end, now.addSecs(60));
+	QVERIFY(!heap.takeExpired(now.addSecs(100), entry));
+	QCOMPARE(heap.size(), 2);
+
+	QVERIFY(heap.takeExpired(now.addDays(1), entry));
+	QVERIFY(heap.takeExpired(now.addDays(1), entry));
+	QCOMPARE(entry->end, now.addSecs(7200));
+	QVERIFY(!heap.takeExpired(now.addDays(1), entry));
+	QCOMPARE(heap.size(), 0);
+}
+
+void DvbEpgTest::expiryHeapEqualEnds()
+{
+	QDateTime now = QDateTime(QDate(2026, 1, 1), QTime(12, 0), Qt::UTC);
+	DvbEpgExpiryHeap heap;
+	QList<DvbSharedEpgEntry> entries;
+
+	for (int i = 0; i < 100; ++i) {
+		entries.append(makeEntry(now.addSecs(((i * 37) % 10) * 60)));
+		heap.insert(entries.last());
+	}
+
+	QList<DvbSharedEpgEntry> expiredEntries;
+	DvbSharedEpgEntry entry;
+
+	while (heap.takeExpired(now.addSecs(4 * 60), entry)) {
+		if (!expiredEntries.isEmpty()) {
+			QVERIFY(expiredEntries.last()->end <= entry->end);
+		}
+
+		expiredEntries.append(entry);
+	}
+
+	// five distinct ends (0 to 4 minutes) with 10 entries each
+	QCOMPARE(expiredEntries.size(), 50);
+	QCOMPARE(heap.size(), 50);
+
+	foreach (const DvbSharedEpgEntry &expiredEntry, expiredEntries) {
+		QVERIFY(entries.contains(expiredEntry));
+	}
+}
+
+void DvbEpgTest::expiryHeapRebuild()
+{
+	QDateTime now = QDateTime(QDate(2026, 1, 1), QTime(12, 0), Qt::UTC);
+	DvbEpgExpiryHeap heap;
+	QVector<DvbSharedEpgEntry> currentEntries;
+
+	for (int i = 0; i < 20; ++i) {
+		DvbSharedEpgEntry entry = makeEntry(now.addSecs(20 - i));
+		heap.insert(entry);
+
+		if ((i % 2) == 0) {
+			currentEntries.append(entry);
+		}
+	}
+
+	// the removed entries are dropped
+	heap.rebuild(currentEntries);
+	QCOMPARE(heap.size(), 10);
+	DvbSharedEpgEntry entry;
+	QDateTime lastEnd;
+
+	while (heap.takeExpired(now.addSecs(100), entry)) {
+		QVERIFY(currentEntries.contains(entry));
+		QVERIFY(!lastEnd.isValid() || (lastEnd <= entry->end));
+		lastEnd = entry->end;
+	}
+
+	QCOMPARE(heap.size(), 0);
+}
+
+void DvbEpgTest::textIndexWords()
+{
+	DvbEpgTextIndex index;
+	DvbSharedEpgEntry tatort = makeEntry(QLatin1String("Tatort: Der Fall"),
+		QLatin1String("Krimi"), QLatin1String("Kommissarin Lena Odenthal ermittelt."));
+	DvbSharedEpgEntry news = makeEntry(QLatin1String("Tagesschau"), QString(),
+		QLatin1String("Nachrichten aus aller Welt"));
+	index.insert(tatort);
+	index.insert(news);
+	QList<DvbSharedEpgEntry> candidates;
+
+	// a complete word anywhere in title, subheading or details (case insensitive)
+	QVERIFY(index.findCandidates(QLatin1String(" der "), candidates));
+	QVERIFY(candidates.contains(tatort));
+	QVERIFY(!candidates.contains(news));
+
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String(" KRIMI "), candidates));
+	QVERIFY(candidates.contains(tatort));
+	QVERIFY(!candidates.contains(news));
+
+	// the details are indexed as well
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String(" aller Welt"), candidates));
+	QVERIFY(candidates.contains(news));
+	QVERIFY(!candidates.contains(tatort));
+
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String(" Lena Odenthal "), candidates));
+	QVERIFY(candidates.contains(tatort));
+	QVERIFY(!candidates.contains(news));
+
+	// all words have to match
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String(" der welt "), candidates));
+	QVERIFY(candidates.isEmpty());
+}
+
+void DvbEpgTest::textIndexPartialWords()
+{
+	DvbEpgTextIndex index;
+	DvbSharedEpgEntry tatort = makeEntry(QLatin1String("Tatort: Der Fall"), QString(),
+		QString());
+	DvbSharedEpgEntry news = makeEntry(QLatin1String("Tagesschau"), QString(), QString());
+	index.insert(tatort);
+	index.insert(news);
+	QList<DvbSharedEpgEntry> candidates;
+
+	// the first word may be a part of a word
+	QVERIFY(index.findCandidates(QLatin1String("tort"), candidates));
+	QVERIFY(candidates.contains(tatort));
+	QVERIFY(!candidates.contains(news));
+
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String("sschau"), candidates));
+	QVERIFY(candidates.contains(news));
+	QVERIFY(!candidates.contains(tatort));
+
+	// the last word may be the beginning of a word
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String("tort: der fa"), candidates));
+	QVERIFY(candidates.contains(tatort));
+
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String("tort: de fall"), candidates));
+	QVERIFY(!candidates.contains(tatort));
+
+	// the text is a substring of both entries
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String("ta"), candidates));
+	QVERIFY(candidates.contains(tatort));
+	QVERIFY(candidates.contains(news));
+}
+
+void DvbEpgTest::textIndexRemove()
+{
+	DvbEpgTextIndex index;
+	QList<DvbSharedEpgEntry> entries;
+
+	for (int i = 0; i < 2000; ++i) {
+		entries.append(makeEntry(QLatin1String("Title ") + QString::number(i),
+			QLatin1String("Episode ") + QString::number(i % 10),
+			QLatin1String("Details of a long description")));
+		index.insert(entries.last());
+	}
+
+	// most entries are removed (the word lists are rebuilt meanwhile)
+	for (int i = 0; i < 2000; ++i) {
+		if ((i % 100) != 0) {
+			index.remove(entries.at(i));
+		}
+	}
+
+	// removing an entry twice is harmless
+	index.remove(entries.at(1));
+
+	QList<DvbSharedEpgEntry> candidates;
+	QVERIFY(index.findCandidates(QLatin1String(" description "), candidates));
+	QCOMPARE(candidates.size(), 20);
+
+	foreach (const DvbSharedEpgEntry &candidate, candidates) {
+		QVERIFY((entries.indexOf(candidate) % 100) == 0);
+	}
+
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String(" title 1 "), candidates));
+	QVERIFY(candidates.isEmpty());
+
+	candidates.clear();
+	QVERIFY(index.findCandidates(QLatin1String(" title 100 "), candidates));
+	QCOMPARE(candidates.size(), 1);
+	QVERIFY(candidates.at(0) == entries.at(100));
+}
+
+void DvbEpgTest::textIndexWithoutWords()
+{
+	DvbEpgTextIndex index;
+	index.insert(makeEntry(QLatin1String("Tatort"), QString(), QString()));
+	QList<DvbSharedEpgEntry> candidates;
+	QVERIFY(!index.findCandidates(QString(), candidates));
+	QVERIFY(!index.findCandidates(QLatin1String(" - "), candidates));
+	QVERIFY(candidates.isEmpty());
+}
+
+QTEST_GUILESS_MAIN(DvbEpgTest)
+
+#include "dvbepgtest.moc"
@@ -0,0 +1,242 @@
+/*
+ * dvbrecordingschedulertest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QtTest>
+#include "dvb/dvbmanager.h"
+#include "dvb/dvbrecording.h"
+#include "dvb/dvbrecording_p.h"
+
+class DvbRecordingSchedulerTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void conflict();
+	void sharedTransponder();
+	void adjacentRecordings();
+	void redistribution();
+	void redistributionKeepsOtherRecordings();
+	void unknownSource();
+	void abortedSearch();
+
+private:
+	// 'sources' are received by 'numberOfTuners' tuners
+	static DvbDeviceConfig makeDeviceConfig(const QStringList &sources, int numberOfTuners);
+	static DvbSharedChannel makeChannel(const QString &source, int frequency);
+	// 'begin' and 'end' are minutes after the base time
+	DvbSharedRecording makeRecording(const DvbSharedChannel &channel, int begin, int end);
+
+	QDateTime baseTime;
+};
+
+DvbDeviceConfig DvbRecordingSchedulerTest::makeDeviceConfig(const QStringList &sources,
+	int numberOfTuners)
+{
+	DvbDeviceConfig deviceConfig(QLatin1String("test"), QLatin1String("test"), NULL);
+	deviceConfig.numberOfTuners = numberOfTuners;
+
+	foreach (const QString &source, sources) {
+		DvbConfig config(new DvbConfigBase(DvbConfigBase::DvbT));
+		config->name = source;
+		deviceConfig.configs.append(config);
+	}
+
+	return deviceConfig;
+}
+
+DvbSharedChannel DvbRecordingSchedulerTest::makeChannel(const QString &source, int frequency)
+{
+	DvbChannel *channel = new DvbChannel();
+	channel->name = source + QLatin1Char(' ') + QString::number(frequency);
+	channel->source = source;
+	channel->transponder = DvbTransponder(DvbTransponderBase::DvbT);
+	channel->transponder.as<DvbTTransponder>()->frequency = frequency;
+	return DvbSharedChannel(channel);
+}
+
+DvbSharedRecording DvbRecordingSchedulerTest::makeRecording(const DvbSharedChannel &channel,
+	int begin, int end)
+{
+	DvbRecording *recording = new DvbRecording();
+	recording->name = channel->name;
+	recording->channel = channel;
+	recording->begin = baseTime.addSecs(begin * 60);
+	recording->end = baseTime.addSecs(end * 60);
+	recording->duration = QTime(0, 0).addSecs((end - begin) * 60);
+	return DvbSharedRecording(recording);
+}
+
+void DvbRecordingSchedulerTest::initTestCase()
+{
+	baseTime = QDateTime(QDate(2026, 1, 1), QTime(20, 0), Qt::UTC);
+}
+
+void DvbRecordingSchedulerTest::conflict()
+{
+	QList<DvbDeviceConfig> deviceConfigs;
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("T"), 2));
+	DvbRecordingScheduler scheduler(deviceConfigs);
+	QVERIFY(scheduler.hasTuners());
+
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 500000000), 0, 60)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 600000000), 30, 90)));
+	// both tuners are tuned to other transponders
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 700000000), 45, 50)));
+	// the rejected recording hasn't changed anything
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 700000000), 60, 120)));
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 800000000), 80, 85)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 800000000), 90, 100)));
+}
+
+void DvbRecordingSchedulerTest::sharedTransponder()
+{
+	QList<DvbDeviceConfig> deviceConfigs;
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("T"), 1));
+	DvbRecordingScheduler scheduler(deviceConfigs);
+
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 500000000), 0, 60)));
+	// another service on the same transponder (the frequency may differ a bit)
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 501000000), 10, 70)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 500000000), 20, 30)));
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 600000000), 65, 80)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 600000000), 70, 80)));
+}
+
+void DvbRecordingSchedulerTest::adjacentRecordings()
+{
+	QList<DvbDeviceConfig> deviceConfigs;
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("T"), 1));
+	DvbRecordingScheduler scheduler(deviceConfigs);
+
+	for (int i = 0; i < 50; ++i) {
+		QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"),
+			500000000 + ((i % 5) * 100000000)), i * 30, (i + 1) * 30)));
+	}
+
+	// a long recording is found by the overlap checks of later recordings
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 500000000),
+		2000, 3000)));
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 600000000),
+		2900, 2910)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 600000000),
+		3000, 3010)));
+}
+
+void DvbRecordingSchedulerTest::redistribution()
+{
+	// both tuners can receive S1, only the first one can receive S2
+	QList<DvbDeviceConfig> deviceConfigs;
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("S1") <<
+		QLatin1String("S2"), 1));
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("S1") <<
+		QLatin1String("S3"), 1));
+	DvbRecordingScheduler scheduler(deviceConfigs);
+
+	// goes to the first tuner (equal number of sources)
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S1"), 500000000), 0, 60)));
+	// only fits if the first recording is moved to the second tuner
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S2"), 500000000), 30, 90)));
+	// both tuners are busy now
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("S3"), 500000000), 40, 50)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S3"), 500000000), 60, 70)));
+}
+
+void DvbRecordingSchedulerTest::redistributionKeepsOtherRecordings()
+{
+	QList<DvbDeviceConfig> deviceConfigs;
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("S1") <<
+		QLatin1String("S2"), 1));
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("S1") <<
+		QLatin1String("S3"), 1));
+	DvbRecordingScheduler scheduler(deviceConfigs);
+
+	// recordings far away from the conflict
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S2"), 500000000), 0, 60)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S3"), 500000000), 0, 60)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S2"), 500000000),
+		1000, 1060)));
+
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S1"), 600000000),
+		100, 160)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S2"), 600000000),
+		130, 190)));
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("S1"), 700000000),
+		140, 150)));
+
+	// the recordings outside of the overlapping range are still assigned
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("S1"), 700000000), 0, 10)));
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("S2"), 600000000),
+		1010, 1020)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S1"), 700000000),
+		1010, 1020)));
+}
+
+void DvbRecordingSchedulerTest::unknownSource()
+{
+	QList<DvbDeviceConfig> deviceConfigs;
+	QVERIFY(!DvbRecordingScheduler(deviceConfigs).hasTuners());
+	// devices without source are ignored
+	deviceConfigs.append(makeDeviceConfig(QStringList(), 2));
+	QVERIFY(!DvbRecordingScheduler(deviceConfigs).hasTuners());
+
+	deviceConfigs.append(makeDeviceConfig(QStringList() << QLatin1String("T"), 1));
+	DvbRecordingScheduler scheduler(deviceConfigs);
+	QVERIFY(scheduler.hasTuners());
+	QVERIFY(!scheduler.add(makeRecording(makeChannel(QLatin1String("C"), 500000000), 0, 60)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("T"), 500000000), 0, 60)));
+}
+
+void DvbRecordingSchedulerTest::abortedSearch()
+{
+	// many tuners with distinct sources make the search space large
+	QList<DvbDeviceConfig> deviceConfigs;
+	QStringList sources;
+
+	for (int i = 0; i < 12; ++i) {
+		sources.append(QLatin1String("S") + QString::number(i));
+	}
+
+	for (int i = 0; i < 12; ++i) {
+		deviceConfigs.append(makeDeviceConfig(QStringList() << sources.at(i) <<
+			sources.at((i + 1) % 12) << QLatin1String("X"), 1));
+	}
+
+	DvbRecordingScheduler scheduler(deviceConfigs);
+
+	// recordings of "X" fit on any tuner, so the greedy assignment works
+	for (int i = 0; i < 12; ++i) {
+		QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("X"),
+			100000000 * (i + 1)), i, 600)));
+	}
+
+	// every tuner is busy with another transponder of "X"; there are too many possible
+	// assignments to prove the conflict, so the recording is kept (it isn't disabled)
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S0"), 500000000),
+		300, 310)));
+	// the tuners are free again once the recordings of "X" have ended
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S0"), 500000000),
+		600, 610)));
+	QVERIFY(scheduler.add(makeRecording(makeChannel(QLatin1String("S1"), 600000000),
+		600, 610)));
+}
+
+QTEST_GUILESS_MAIN(DvbRecordingSchedulerTest)
+
+#include "dvbrecordingschedulertest.moc"
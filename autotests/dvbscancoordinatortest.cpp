@@ -0,0 +1,299 @@
+/*
+ * dvbscancoordinatortest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QSignalSpy>
+#include <QtTest>
+#include "dvb/dvbbackenddevice.h"
+#include "dvb/dvbdevice.h"
+#include "dvb/dvbscan.h"
+
+Q_DECLARE_METATYPE(QList<DvbPreviewChannel>)
+
+// the coordinator only asks the devices for their transmission types
+
+class TestBackendDevice : public DvbBackendDevice
+{
+public:
+	explicit TestBackendDevice(TransmissionTypes transmissionTypes_) :
+		transmissionTypes(transmissionTypes_) { }
+	~TestBackendDevice() { }
+
+	QString getDeviceId() { return QLatin1String("test"); }
+	QString getFrontendName() { return QLatin1String("test"); }
+	TransmissionTypes getTransmissionTypes() { return transmissionTypes; }
+	Capabilities getCapabilities() { return Capabilities(); }
+	void setFrontendDevice(DvbFrontendDevice *frontend) { Q_UNUSED(frontend) }
+	void setDeviceEnabled(bool enabled) { Q_UNUSED(enabled) }
+	bool acquire() { return true; }
+	bool setTone(SecTone tone) { Q_UNUSED(tone) return true; }
+	bool setVoltage(SecVoltage voltage) { Q_UNUSED(voltage) return true; }
+	bool sendMessage(const char *message, int length)
+	{
+		Q_UNUSED(message)
+		Q_UNUSED(length)
+		return true;
+	}
+	bool sendBurst(SecBurst burst) { Q_UNUSED(burst) return true; }
+	bool tune(const DvbTransponder &transponder) { Q_UNUSED(transponder) return true; }
+	bool isTuned() { return false; }
+	int getSignal() { return -1; }
+	int getSnr() { return -1; }
+	bool addPidFilter(int pid) { Q_UNUSED(pid) return true; }
+	void removePidFilter(int pid) { Q_UNUSED(pid) }
+	void startDescrambling(const QByteArray &pmtSectionData) { Q_UNUSED(pmtSectionData) }
+	void stopDescrambling(int serviceId) { Q_UNUSED(serviceId) }
+	void release() { }
+
+private:
+	TransmissionTypes transmissionTypes;
+};
+
+class DvbScanCoordinatorTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void initTestCase();
+	void init();
+	void cleanup();
+	void handOut();
+	void addTransponder();
+	void releasedTransponderHandedOutAgain();
+	void releasedIdleDevice();
+	void duplicateServices();
+
+private:
+	static DvbTransponder makeTransponder(int frequency);
+	static DvbTransponder makeS2Transponder(int frequency);
+	static DvbPreviewChannel makeChannel(int serviceId, const DvbTransponder &transponder);
+
+	TestBackendDevice *sBackend;
+	TestBackendDevice *s2Backend;
+	DvbDevice *sDevice; // can't tune DVB-S2 transponders
+	DvbDevice *s2Device;
+};
+
+DvbTransponder DvbScanCoordinatorTest::makeTransponder(int frequency)
+{
+	DvbTransponder transponder(DvbTransponderBase::DvbS);
+	transponder.as<DvbSTransponder>()->frequency = frequency;
+	transponder.as<DvbSTransponder>()->polarization = DvbSTransponder::Horizontal;
+	return transponder;
+}
+
+DvbTransponder DvbScanCoordinatorTest::makeS2Transponder(int frequency)
+{
+	DvbTransponder transponder(DvbTransponderBase::DvbS2);
+	transponder.as<DvbS2Transponder>()->frequency = frequency;
+	transponder.as<DvbS2Transponder>()->polarization = DvbSTransponder::Horizontal;
+	return transponder;
+}
+
+DvbPreviewChannel DvbScanCoordinatorTest::makeChannel(int serviceId,
+	const DvbTransponder &transponder)
+{
+	DvbPreviewChannel channel;
+	channel.name = QLatin1String("Service ") + QString::number(serviceId);
+	channel.source = QLatin1String("S");
+	channel.transponder = transponder;
+	channel.networkId = 1;
+	channel.transportStreamId = 2;
+	channel.serviceId = serviceId;
+	return channel;
+}
+
+void DvbScanCoordinatorTest::initTestCase()
+{
+	qRegisterMetaType<QList<DvbPreviewChannel> >();
+}
+
+void DvbScanCoordinatorTest::init()
+{
+	sBackend = new TestBackendDevice(DvbDeviceBase::DvbS);
+	s2Backend = new TestBackendDevice(DvbDeviceBase::DvbS | DvbDeviceBase::DvbS2);
+	sDevice = new DvbDevice(sBackend, this);
+	s2Device = new DvbDevice(s2Backend, this);
+}
+
+void DvbScanCoordinatorTest::cleanup()
+{
+	delete sDevice;
+	delete s2Device;
+	delete sBackend;
+	delete s2Backend;
+}
+
+void DvbScanCoordinatorTest::handOut()
+{
+	QList<DvbTransponder> transponders;
+	transponders.append(makeS2Transponder(11000000));
+	transponders.append(makeTransponder(12000000));
+	DvbScanCoordinator coordinator(QList<DvbDevice *>() << sDevice << s2Device,
+		QLatin1String("S"), transponders);
+	// the scans are never started (resume() doesn't do anything)
+	DvbScan sScan(sDevice, QLatin1String("S"), &coordinator, false);
+	DvbScan s2Scan(s2Device, QLatin1String("S"), &coordinator, false);
+	QSignalSpy progressSpy(&coordinator, SIGNAL(scanProgress(int)));
+	DvbTransponder transponder;
+
+	// the DVB-S2 transponder is left for the other device
+	QVERIFY(coordinator.takeTransponder(&sScan, sDevice, &transponder));
+	QVERIFY(transponder.corresponds(transponders.at(1)));
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(transponder.corresponds(transponders.at(0)));
+
+	// the first device waits for transponders from the NIT of the other one
+	QVERIFY(!coordinator.takeTransponder(&sScan, sDevice, &transponder));
+	QVERIFY(!coordinator.isFinished());
+	QCOMPARE(progressSpy.count(), 3);
+	QCOMPARE(progressSpy.at(2).at(0).toInt(), 50);
+
+	QVERIFY(!coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(coordinator.isFinished());
+	QCOMPARE(progressSpy.last().at(0).toInt(), 100);
+	QVERIFY(!coordinator.takeTransponder(&sScan, sDevice, &transponder));
+}
+
+void DvbScanCoordinatorTest::addTransponder()
+{
+	QList<DvbTransponder> transponders;
+	transponders.append(makeTransponder(12000000));
+	DvbScanCoordinator coordinator(QList<DvbDevice *>() << sDevice << s2Device,
+		QLatin1String("S"), transponders);
+	DvbScan sScan(sDevice, QLatin1String("S"), &coordinator, false);
+	DvbScan s2Scan(s2Device, QLatin1String("S"), &coordinator, false);
+	DvbTransponder transponder;
+
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(!coordinator.takeTransponder(&sScan, sDevice, &transponder));
+
+	// known transponders (at a slightly different frequency) are ignored
+	coordinator.addTransponder(makeTransponder(12001000));
+	QVERIFY(!coordinator.takeTransponder(&sScan, sDevice, &transponder));
+
+	coordinator.addTransponder(makeTransponder(12500000));
+	QVERIFY(coordinator.takeTransponder(&sScan, sDevice, &transponder));
+	QVERIFY(transponder.corresponds(makeTransponder(12500000)));
+
+	// nothing is pending anymore once no device is busy
+	QVERIFY(!coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(!coordinator.isFinished());
+	QVERIFY(!coordinator.takeTransponder(&sScan, sDevice, &transponder));
+	QVERIFY(coordinator.isFinished());
+}
+
+void DvbScanCoordinatorTest::releasedTransponderHandedOutAgain()
+{
+	QList<DvbTransponder> transponders;
+	transponders.append(makeTransponder(11000000));
+	transponders.append(makeTransponder(12000000));
+	DvbScanCoordinator coordinator(QList<DvbDevice *>() << sDevice << s2Device,
+		QLatin1String("S"), transponders);
+	DvbScan sScan(sDevice, QLatin1String("S"), &coordinator, false);
+	DvbScan s2Scan(s2Device, QLatin1String("S"), &coordinator, false);
+	DvbTransponder transponder;
+	DvbTransponder sTransponder;
+
+	QVERIFY(coordinator.takeTransponder(&sScan, sDevice, &sTransponder));
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(!coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+
+	// the device is taken while it's scanning; its transponder is scanned by the other one
+	// (a started scan would take it while it's resumed)
+	coordinator.deviceReleased(&sScan, sDevice, sTransponder);
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(transponder.corresponds(sTransponder));
+
+	QVERIFY(!coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(coordinator.isFinished());
+}
+
+void DvbScanCoordinatorTest::releasedIdleDevice()
+{
+	QList<DvbTransponder> transponders;
+	transponders.append(makeTransponder(11000000));
+	DvbScanCoordinator coordinator(QList<DvbDevice *>() << sDevice << s2Device,
+		QLatin1String("S"), transponders);
+	DvbScan sScan(sDevice, QLatin1String("S"), &coordinator, false);
+	DvbScan s2Scan(s2Device, QLatin1String("S"), &coordinator, false);
+	DvbTransponder transponder;
+
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(!coordinator.takeTransponder(&sScan, sDevice, &transponder));
+
+	// an idle device doesn't give anything back
+	coordinator.deviceReleased(&sScan, sDevice, DvbTransponder());
+	QVERIFY(!coordinator.isFinished());
+
+	// the transponders which are found later are scanned by the remaining device
+	coordinator.addTransponder(makeS2Transponder(12000000));
+	coordinator.addTransponder(makeTransponder(12500000));
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(transponder.corresponds(makeS2Transponder(12000000)));
+	QVERIFY(coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(transponder.corresponds(makeTransponder(12500000)));
+	QVERIFY(!coordinator.takeTransponder(&s2Scan, s2Device, &transponder));
+	QVERIFY(coordinator.isFinished());
+}
+
+void DvbScanCoordinatorTest::duplicateServices()
+{
+	DvbTransponder transponder = makeTransponder(11000000);
+	DvbScanCoordinator coordinator(QList<DvbDevice *>() << sDevice,
+		QLatin1String("S"), QList<DvbTransponder>() << transponder);
+	QSignalSpy foundSpy(&coordinator, SIGNAL(foundChannels(QList<DvbPreviewChannel>)));
+	QList<DvbPreviewChannel> channels;
+	channels.append(makeChannel(1, transponder));
+	channels.append(makeChannel(2, transponder));
+	QVERIFY(QMetaObject::invokeMethod(&coordinator, "scanFoundChannels", Qt::DirectConnection,
+		Q_ARG(QList<DvbPreviewChannel>, channels)));
+	QCOMPARE(foundSpy.count(), 1);
+	QCOMPARE(foundSpy.at(0).at(0).value<QList<DvbPreviewChannel> >().size(), 2);
+
+	// the same transponder at a slightly different frequency (e.g. from the NIT)
+	channels.clear();
+	channels.append(makeChannel(1, makeTransponder(11001000)));
+	channels.append(makeChannel(3, makeTransponder(11001000)));
+	QVERIFY(QMetaObject::invokeMethod(&coordinator, "scanFoundChannels", Qt::DirectConnection,
+		Q_ARG(QList<DvbPreviewChannel>, channels)));
+	QCOMPARE(foundSpy.count(), 2);
+	QList<DvbPreviewChannel> newChannels =
+		foundSpy.at(1).at(0).value<QList<DvbPreviewChannel> >();
+	QCOMPARE(newChannels.size(), 1);
+	QCOMPARE(newChannels.at(0).serviceId, 3);
+
+	// the same ids on another transponder are another service
+	channels.clear();
+	channels.append(makeChannel(1, makeTransponder(11500000)));
+	QVERIFY(QMetaObject::invokeMethod(&coordinator, "scanFoundChannels", Qt::DirectConnection,
+		Q_ARG(QList<DvbPreviewChannel>, channels)));
+	QCOMPARE(foundSpy.count(), 3);
+	newChannels = foundSpy.at(2).at(0).value<QList<DvbPreviewChannel> >();
+	QCOMPARE(newChannels.size(), 1);
+	QVERIFY(newChannels.at(0).transponder.corresponds(makeTransponder(11500000)));
+
+	// nothing new
+	QVERIFY(QMetaObject::invokeMethod(&coordinator, "scanFoundChannels", Qt::DirectConnection,
+		Q_ARG(QList<DvbPreviewChannel>, channels)));
+	QCOMPARE(foundSpy.count(), 3);
+}
+
+QTEST_GUILESS_MAIN(DvbScanCoordinatorTest)
+
+#include "dvbscancoordinatortest.moc"
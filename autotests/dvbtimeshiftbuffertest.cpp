@@ -0,0 +1,306 @@
+/*
+ * dvbtimeshiftbuffertest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QTemporaryDir>
+#include <QtEndian>
+#include <QtTest>
+#include "dvb/dvbtimeshiftbuffer.h"
+
+class DvbTimeShiftBufferTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void readWrite();
+	void skip();
+	void skipAfterDiscard();
+	void memoryWrapAround();
+	void fileWrapAround();
+	void clear();
+
+private:
+	enum {
+		ChunkSize = (1 << 20),
+		VideoPid = 0x100
+	};
+
+	// a packet every 0.5 seconds; every fourth one is a random access point; the packet
+	// number is stored after the pcr
+	static QByteArray makeStream(int firstPacket, int packetCount);
+	static int packetNumber(const char *packet);
+	// a read() may end at a chunk boundary
+	static bool readPacket(DvbTimeShiftBuffer *buffer, char packet[188]);
+	// every 32 bit word contains its own offset (divided by 4)
+	static QByteArray makeData(qint64 offset, int size);
+	// returns the offset of the data or -1 if it isn't consistent
+	static qint64 checkData(const char *data, int size);
+};
+
+QByteArray DvbTimeShiftBufferTest::makeStream(int firstPacket, int packetCount)
+{
+	QByteArray stream;
+
+	for (int i = firstPacket; i < (firstPacket + packetCount); ++i) {
+		bool randomAccess = ((i % 4) == 0);
+		qint64 pcr = (qint64(i) * 45000);
+		QByteArray packet(188, char(0xff));
+		packet[0] = char(0x47);
+		packet[1] = char((randomAccess ? 0x40 : 0x00) | (VideoPid >> 8));
+		packet[2] = char(VideoPid & 0xff);
+		packet[3] = char(0x20);
+		packet[4] = char(183);
+		packet[5] = char((randomAccess ? 0x40 : 0x00) | 0x10);
+		packet[6] = char(pcr >> 25);
+		packet[7] = char(pcr >> 17);
+		packet[8] = char(pcr >> 9);
+		packet[9] = char(pcr >> 1);
+		packet[10] = char(((pcr & 0x01) << 7) | 0x7e);
+		packet[11] = char(0x00);
+		qToBigEndian<qint32>(i, reinterpret_cast<uchar *>(packet.data() + 12));
+		stream += packet;
+	}
+
+	return stream;
+}
+
+int DvbTimeShiftBufferTest::packetNumber(const char *packet)
+{
+	return qFromBigEndian<qint32>(reinterpret_cast<const uchar *>(packet + 12));
+}
+
+bool DvbTimeShiftBufferTest::readPacket(DvbTimeShiftBuffer *buffer, char packet[188])
+{
+	int size = 0;
+
+	while (size < 188) {
+		int count = buffer->read(packet + size, 188 - size);
+
+		if (count <= 0) {
+			return false;
+		}
+
+		size += count;
+	}
+
+	return true;
+}
+
+QByteArray DvbTimeShiftBufferTest::makeData(qint64 offset, int size)
+{
+	QByteArray data(size, 0);
+
+	for (int i = 0; i < size; i += 4) {
+		qToBigEndian<quint32>(quint32((offset + i) / 4),
+			reinterpret_cast<uchar *>(data.data() + i));
+	}
+
+	return data;
+}
+
+qint64 DvbTimeShiftBufferTest::checkData(const char *data, int size)
+{
+	if (((size % 4) != 0) || (size == 0)) {
+		return -1;
+	}
+
+	qint64 offset = (qint64(qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data))) * 4);
+
+	for (int i = 0; i < size; i += 4) {
+		if (qFromBigEndian<quint32>(reinterpret_cast<const uchar *>(data + i)) !=
+		    quint32((offset + i) / 4)) {
+			return -1;
+		}
+	}
+
+	return offset;
+}
+
+void DvbTimeShiftBufferTest::readWrite()
+{
+	DvbTimeShiftBuffer buffer;
+	buffer.start(QString(), 2 * ChunkSize, 0);
+	QVERIFY(buffer.isActive());
+	buffer.open();
+	buffer.write("abc", 3);
+	buffer.write("def", 3);
+
+	char data[8];
+	QCOMPARE(buffer.read(data, 4), 4);
+	QCOMPARE(QByteArray(data, 4), QByteArray("abcd"));
+	QCOMPARE(buffer.read(data, 8), 2);
+	QCOMPARE(QByteArray(data, 2), QByteArray("ef"));
+
+	buffer.interrupt();
+	QCOMPARE(buffer.read(data, 8), -1);
+	buffer.stop();
+	QVERIFY(!buffer.isActive());
+}
+
+void DvbTimeShiftBufferTest::skip()
+{
+	DvbTimeShiftBuffer buffer;
+	buffer.start(QString(), 2 * ChunkSize, 0);
+	buffer.setIndexPids(VideoPid, VideoPid);
+	buffer.open();
+	// random access points at 0, 2, 4, 6 and 8 seconds
+	QByteArray stream = makeStream(0, 20);
+	buffer.write(stream.constData(), stream.size());
+	char packet[188];
+
+	// nothing to skip back to
+	QCOMPARE(buffer.skip(-1000), 0);
+	// less than the distance to the next random access point
+	QCOMPARE(buffer.skip(1500), 0);
+
+	QCOMPARE(buffer.skip(2500), 2000);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 4);
+
+	// relative to the random access point before the read position
+	QCOMPARE(buffer.skip(4000), 4000);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 12);
+
+	QCOMPARE(buffer.skip(-3500), -4000);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 4);
+
+	// the skip stops at the first or last random access point
+	QCOMPARE(buffer.skip(-100000), -2000);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 0);
+
+	QCOMPARE(buffer.skip(100000), 8000);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 16);
+}
+
+void DvbTimeShiftBufferTest::skipAfterDiscard()
+{
+	DvbTimeShiftBuffer buffer;
+	buffer.start(QString(), 2 * ChunkSize, 0);
+	buffer.setIndexPids(VideoPid, VideoPid);
+	buffer.open();
+	// 3.5 chunks; only the last two (incomplete) chunks are kept
+	int packetCount = ((7 * ChunkSize) / (2 * 188));
+	QByteArray stream = makeStream(0, packetCount);
+	buffer.write(stream.constData(), stream.size());
+	char packet[188];
+
+	// the read position has been moved to the oldest data which is still there (which
+	// isn't aligned to a packet)
+	int partialSize = (188 - ((2 * ChunkSize) % 188));
+	QCOMPARE(buffer.read(packet, partialSize), partialSize);
+	int firstPacket = (((2 * ChunkSize) + 187) / 188);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), firstPacket);
+
+	// the random access points in the discarded chunks are gone
+	QCOMPARE(buffer.skip(-1000000), 0);
+	QVERIFY(buffer.skip(1000000) > 0);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), ((packetCount - 1) / 4) * 4);
+	QVERIFY(buffer.skip(-1000000) < 0);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), ((firstPacket + 3) / 4) * 4);
+}
+
+void DvbTimeShiftBufferTest::memoryWrapAround()
+{
+	DvbTimeShiftBuffer buffer;
+	buffer.start(QString(), 2 * ChunkSize, 0);
+	buffer.open();
+	QByteArray data(65536, 0);
+	qint64 offset = 0;
+
+	// the chunks are reused
+	for (int i = 0; i < 10; ++i) {
+		buffer.write(makeData(offset, ChunkSize / 2).constData(), ChunkSize / 2);
+		offset += (ChunkSize / 2);
+		QCOMPARE(buffer.read(data.data(), 4096), 4096);
+		QVERIFY(checkData(data.constData(), 4096) >= 0);
+	}
+
+	buffer.write(makeData(offset, 3 * ChunkSize).constData(), 3 * ChunkSize);
+	offset += (3 * ChunkSize);
+	// only the last two chunks are kept
+	QCOMPARE(buffer.read(data.data(), data.size()), data.size());
+	QCOMPARE(checkData(data.constData(), data.size()), offset - (2 * ChunkSize));
+}
+
+void DvbTimeShiftBufferTest::fileWrapAround()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString fileName = dir.path() + QLatin1String("/timeshift.m2t");
+	DvbTimeShiftBuffer buffer;
+	// two chunks in memory and three chunks in the file ring
+	buffer.start(fileName, 2 * ChunkSize, 3 * ChunkSize);
+	QVERIFY(QFile::exists(fileName));
+	buffer.open();
+	const qint64 size = (8 * ChunkSize);
+
+	for (qint64 offset = 0; offset < size; offset += ChunkSize) {
+		buffer.write(makeData(offset, ChunkSize).constData(), ChunkSize);
+	}
+
+	// where the data starts depends on the progress of the spill thread; the data which
+	// is read (from the file ring or from memory) has to be consistent in any case
+	QByteArray data(100000, 0);
+	qint64 lastOffset = -1;
+
+	while (lastOffset < (size - 4)) {
+		int count = buffer.read(data.data(), data.size());
+		QVERIFY(count > 0);
+		QCOMPARE(count % 4, 0);
+		qint64 offset = checkData(data.constData(), count);
+		QVERIFY(offset >= 0);
+		QVERIFY(offset > lastOffset);
+		QVERIFY((lastOffset >= 0) || ((offset % ChunkSize) == 0));
+		lastOffset = (offset + count - 4);
+	}
+
+	buffer.stop();
+	QVERIFY(!QFile::exists(fileName));
+}
+
+void DvbTimeShiftBufferTest::clear()
+{
+	DvbTimeShiftBuffer buffer;
+	buffer.start(QString(), 2 * ChunkSize, 0);
+	buffer.setIndexPids(VideoPid, VideoPid);
+	buffer.open();
+	QByteArray stream = makeStream(0, 20);
+	buffer.write(stream.constData(), stream.size());
+	buffer.clear();
+	QCOMPARE(buffer.skip(2000), 0);
+
+	stream = makeStream(100, 8);
+	buffer.write(stream.constData(), stream.size());
+	char packet[188];
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 100);
+	QCOMPARE(buffer.skip(2000), 2000);
+	QVERIFY(readPacket(&buffer, packet));
+	QCOMPARE(packetNumber(packet), 104);
+}
+
+QTEST_GUILESS_MAIN(DvbTimeShiftBufferTest)
+
+#include "dvbtimeshiftbuffertest.moc"
@@ -0,0 +1,258 @@
+/*
+ * mediastreambuffertest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QThread>
+#include <QtTest>
+#include "mediastreambuffer.h"
+
+// reads 'size' bytes and checks that byte n of the stream is (n % 251)
+
+class MediaStreamBufferReader : public QThread
+{
+public:
+	MediaStreamBufferReader(MediaStreamBuffer *buffer_, qint64 size_) : buffer(buffer_),
+		size(size_), bytesRead(0), valid(true) { }
+	~MediaStreamBufferReader() { }
+
+	qint64 getBytesRead() const
+	{
+		return bytesRead;
+	}
+
+	bool isValid() const
+	{
+		return valid;
+	}
+
+private:
+	void run()
+	{
+		QByteArray data(65536, 0);
+
+		while (bytesRead < size) {
+			int count = buffer->read(data.data(), data.size());
+
+			if (count <= 0) {
+				valid = false;
+				return;
+			}
+
+			for (int i = 0; i < count; ++i) {
+				if (quint8(data.at(i)) != ((bytesRead + i) % 251)) {
+					valid = false;
+				}
+			}
+
+			bytesRead += count;
+		}
+	}
+
+	MediaStreamBuffer *buffer;
+	qint64 size;
+	qint64 bytesRead;
+	bool valid;
+};
+
+class MediaStreamBufferTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void readWrite();
+	void openStartsAtEnd();
+	void wrapAround();
+	void dropsWhenFull();
+	void flush();
+	void interrupt();
+	void concurrentReadWrite();
+
+private:
+	static QByteArray makeData(qint64 offset, int size);
+	static QByteArray readData(MediaStreamBuffer *buffer, int size);
+};
+
+QByteArray MediaStreamBufferTest::makeData(qint64 offset, int size)
+{
+	QByteArray data(size, 0);
+
+	for (int i = 0; i < size; ++i) {
+		data[i] = char((offset + i) % 251);
+	}
+
+	return data;
+}
+
+QByteArray MediaStreamBufferTest::readData(MediaStreamBuffer *buffer, int size)
+{
+	QByteArray data(size, 0);
+	int offset = 0;
+
+	while (offset < size) {
+		int count = buffer->read(data.data() + offset, size - offset);
+
+		if (count <= 0) {
+			return QByteArray();
+		}
+
+		offset += count;
+	}
+
+	return data;
+}
+
+void MediaStreamBufferTest::readWrite()
+{
+	MediaStreamBuffer buffer;
+	buffer.open();
+	buffer.write("abc", 3);
+	buffer.write("def", 3);
+	QCOMPARE(buffer.getBufferedBytes(), 6);
+
+	char data[4];
+	QCOMPARE(buffer.read(data, 4), 4);
+	QCOMPARE(QByteArray(data, 4), QByteArray("abcd"));
+	QCOMPARE(buffer.getBufferedBytes(), 2);
+	QCOMPARE(buffer.read(data, 4), 2);
+	QCOMPARE(QByteArray(data, 2), QByteArray("ef"));
+	QCOMPARE(buffer.getBufferedBytes(), 0);
+}
+
+void MediaStreamBufferTest::openStartsAtEnd()
+{
+	MediaStreamBuffer buffer;
+	// without flush the data written before open() isn't played
+	buffer.write("old", 3);
+	buffer.open();
+	buffer.write("new", 3);
+
+	char data[8];
+	QCOMPARE(buffer.read(data, 8), 3);
+	QCOMPARE(QByteArray(data, 3), QByteArray("new"));
+}
+
+void MediaStreamBufferTest::wrapAround()
+{
+	MediaStreamBuffer buffer;
+	buffer.open();
+	// the chunk size doesn't divide the size of the ring
+	const int chunkSize = 1000003;
+	qint64 offset = 0;
+
+	for (int i = 0; i < 20; ++i) {
+		buffer.write(makeData(offset, chunkSize).constData(), chunkSize);
+		QCOMPARE(readData(&buffer, chunkSize), makeData(offset, chunkSize));
+		offset += chunkSize;
+	}
+
+	QCOMPARE(buffer.getBytesDropped(), Q_INT64_C(0));
+}
+
+void MediaStreamBufferTest::dropsWhenFull()
+{
+	MediaStreamBuffer buffer;
+	buffer.open();
+	const int size = (4 << 20);
+	buffer.write(makeData(0, size - 100).constData(), size - 100);
+	QCOMPARE(buffer.getBufferedBytes(), size - 100);
+	// doesn't fit anymore
+	buffer.write(makeData(size - 100, 188).constData(), 188);
+	QCOMPARE(buffer.getBytesDropped(), Q_INT64_C(188));
+	QCOMPARE(buffer.getBufferedBytes(), size - 100);
+	buffer.write(makeData(size - 100, 100).constData(), 100);
+	QCOMPARE(buffer.getBufferedBytes(), size);
+	QCOMPARE(readData(&buffer, size), makeData(0, size));
+}
+
+void MediaStreamBufferTest::flush()
+{
+	MediaStreamBuffer buffer;
+	buffer.open();
+	buffer.write("old", 3);
+	buffer.flush();
+	buffer.write("new", 3);
+	QCOMPARE(buffer.getBufferedBytes(), 3);
+
+	char data[8];
+	QCOMPARE(buffer.read(data, 8), 3);
+	QCOMPARE(QByteArray(data, 3), QByteArray("new"));
+
+	// open() starts at the last flush which hasn't been seen yet
+	buffer.write("old", 3);
+	buffer.flush();
+	buffer.write("next", 4);
+	buffer.open();
+	QCOMPARE(buffer.read(data, 8), 4);
+	QCOMPARE(QByteArray(data, 4), QByteArray("next"));
+
+	// the space in front of the flush position is reused at once
+	const int size = (4 << 20);
+	buffer.write(makeData(0, size - 100).constData(), size - 100);
+	buffer.flush();
+	buffer.write(makeData(0, size).constData(), size);
+	QCOMPARE(buffer.getBytesDropped(), Q_INT64_C(0));
+	QCOMPARE(readData(&buffer, size), makeData(0, size));
+}
+
+void MediaStreamBufferTest::interrupt()
+{
+	MediaStreamBuffer buffer;
+	buffer.open();
+	buffer.write("abc", 3);
+	buffer.interrupt();
+
+	char data[8];
+	QCOMPARE(buffer.read(data, 8), -1);
+	QCOMPARE(buffer.read(data, 8), -1);
+
+	buffer.open();
+	buffer.write("def", 3);
+	QCOMPARE(buffer.read(data, 8), 3);
+	QCOMPARE(QByteArray(data, 3), QByteArray("def"));
+}
+
+void MediaStreamBufferTest::concurrentReadWrite()
+{
+	MediaStreamBuffer buffer;
+	buffer.open();
+	const qint64 size = (64 << 20);
+	MediaStreamBufferReader reader(&buffer, size);
+	reader.start();
+	qint64 offset = 0;
+
+	while (offset < size) {
+		// keep the producer behind the consumer, so that nothing is dropped
+		if (buffer.getBufferedBytes() > (2 << 20)) {
+			QThread::yieldCurrentThread();
+			continue;
+		}
+
+		int count = int(qMin(size - offset, qint64(47 * 188)));
+		buffer.write(makeData(offset, count).constData(), count);
+		offset += count;
+	}
+
+	QVERIFY(reader.wait(60000));
+	QCOMPARE(buffer.getBytesDropped(), Q_INT64_C(0));
+	QCOMPARE(reader.getBytesRead(), size);
+	QVERIFY(reader.isValid());
+}
+
+QTEST_GUILESS_MAIN(MediaStreamBufferTest)
+
+#include "mediastreambuffertest.moc"
@@ -0,0 +1,241 @@
+/*
+ * tablemodeltest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QSignalSpy>
+#include <QtTest>
+#include "shareddata.h"
+#include "tablemodel.h"
+
+class TestItem : public SharedData
+{
+public:
+	explicit TestItem(int value_) : value(value_) { }
+	~TestItem() { }
+
+	int value;
+};
+
+typedef ExplicitlySharedDataPointer<const TestItem> TestSharedItem;
+
+class TestItemLessThan
+{
+public:
+	TestItemLessThan() : sortOrder(ValueAscending) { }
+	~TestItemLessThan() { }
+
+	enum SortOrder
+	{
+		ValueAscending = 0,
+		ValueDescending = 1
+	};
+
+	SortOrder getSortOrder() const
+	{
+		return sortOrder;
+	}
+
+	void setSortOrder(SortOrder sortOrder_)
+	{
+		sortOrder = sortOrder_;
+	}
+
+	bool operator()(const TestSharedItem &x, const TestSharedItem &y) const
+	{
+		if (sortOrder == ValueAscending) {
+			return (x->value < y->value);
+		}
+
+		return (y->value < x->value);
+	}
+
+private:
+	SortOrder sortOrder;
+};
+
+class TestTableModelHelper
+{
+public:
+	TestTableModelHelper() { }
+	~TestTableModelHelper() { }
+
+	typedef TestSharedItem ItemType;
+	typedef TestItemLessThan LessThanType;
+
+	int columnCount() const
+	{
+		return 1;
+	}
+
+	// odd values are filtered out
+	bool filterAcceptsItem(const TestSharedItem &item) const
+	{
+		return ((item->value % 2) == 0);
+	}
+};
+
+class TestTableModel : public TableModel<TestTableModelHelper>
+{
+public:
+	TestTableModel() : TableModel<TestTableModelHelper>(NULL) { }
+	~TestTableModel() { }
+
+	QVariant data(const QModelIndex &index, int role) const
+	{
+		if (role == Qt::DisplayRole) {
+			const TestSharedItem &item = value(index);
+
+			if (item.isValid()) {
+				return item->value;
+			}
+		}
+
+		return QVariant();
+	}
+
+	void insertTestItems(const QList<TestSharedItem> &items)
+	{
+		insertItems(items);
+	}
+
+	void removeTestItems(const QList<TestSharedItem> &items)
+	{
+		removeItems(items);
+	}
+
+	QList<int> values() const
+	{
+		QList<int> result;
+
+		for (int row = 0; row < rowCount(QModelIndex()); ++row) {
+			result.append(value(row)->value);
+		}
+
+		return result;
+	}
+};
+
+class TableModelTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void insertItemsMerges();
+	void insertItemsKeepsPersistentIndexes();
+	void insertSingleItem();
+	void removeItems();
+	void removeSingleItem();
+
+private:
+	static QList<TestSharedItem> makeItems(const QList<int> &values);
+};
+
+QList<TestSharedItem> TableModelTest::makeItems(const QList<int> &values)
+{
+	QList<TestSharedItem> items;
+
+	foreach (int value, values) {
+		items.append(TestSharedItem(new TestItem(value)));
+	}
+
+	return items;
+}
+
+void TableModelTest::insertItemsMerges()
+{
+	TestTableModel model;
+	model.insertTestItems(makeItems(QList<int>() << 8 << 2 << 6));
+	QCOMPARE(model.values(), QList<int>() << 2 << 6 << 8);
+
+	QSignalSpy layoutSpy(&model, SIGNAL(layoutChanged()));
+	QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+	model.insertTestItems(makeItems(QList<int>() << 10 << 3 << 4 << 0 << 6));
+	// one layout change for the whole batch; the odd value is filtered out
+	QCOMPARE(layoutSpy.count(), 1);
+	QCOMPARE(insertSpy.count(), 0);
+	QCOMPARE(model.values(), QList<int>() << 0 << 2 << 4 << 6 << 6 << 8 << 10);
+}
+
+void TableModelTest::insertItemsKeepsPersistentIndexes()
+{
+	TestTableModel model;
+	QList<TestSharedItem> items = makeItems(QList<int>() << 2 << 4 << 6);
+	model.insertTestItems(items);
+	QPersistentModelIndex index = model.find(items.at(1));
+	QCOMPARE(index.row(), 1);
+
+	model.insertTestItems(makeItems(QList<int>() << 0 << 1 << 3 << 8));
+	QVERIFY(index.isValid());
+	QCOMPARE(index.row(), 2);
+	QCOMPARE(index.data().toInt(), 4);
+}
+
+void TableModelTest::insertSingleItem()
+{
+	TestTableModel model;
+	model.insertTestItems(makeItems(QList<int>() << 2 << 6));
+
+	QSignalSpy layoutSpy(&model, SIGNAL(layoutChanged()));
+	QSignalSpy insertSpy(&model, SIGNAL(rowsInserted(QModelIndex,int,int)));
+	// a single accepted item is inserted as a row
+	model.insertTestItems(makeItems(QList<int>() << 5 << 4));
+	QCOMPARE(layoutSpy.count(), 0);
+	QCOMPARE(insertSpy.count(), 1);
+	QCOMPARE(insertSpy.at(0).at(1).toInt(), 1);
+	QCOMPARE(model.values(), QList<int>() << 2 << 4 << 6);
+}
+
+void TableModelTest::removeItems()
+{
+	TestTableModel model;
+	QList<TestSharedItem> items = makeItems(QList<int>() << 0 << 2 << 4 << 6 << 8);
+	model.insertTestItems(items);
+	QPersistentModelIndex removedIndex = model.find(items.at(2));
+	QPersistentModelIndex keptIndex = model.find(items.at(3));
+
+	QSignalSpy layoutSpy(&model, SIGNAL(layoutChanged()));
+	QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+	// items which aren't part of the model are ignored
+	model.removeTestItems(QList<TestSharedItem>() << items.at(4) << items.at(0) << items.at(2) <<
+		TestSharedItem(new TestItem(12)) << TestSharedItem());
+	QCOMPARE(layoutSpy.count(), 1);
+	QCOMPARE(removeSpy.count(), 0);
+	QCOMPARE(model.values(), QList<int>() << 2 << 6);
+	QVERIFY(!removedIndex.isValid());
+	QCOMPARE(keptIndex.row(), 1);
+	QCOMPARE(keptIndex.data().toInt(), 6);
+}
+
+void TableModelTest::removeSingleItem()
+{
+	TestTableModel model;
+	QList<TestSharedItem> items = makeItems(QList<int>() << 0 << 2 << 4);
+	model.insertTestItems(items);
+
+	QSignalSpy layoutSpy(&model, SIGNAL(layoutChanged()));
+	QSignalSpy removeSpy(&model, SIGNAL(rowsRemoved(QModelIndex,int,int)));
+	model.removeTestItems(QList<TestSharedItem>() << items.at(1));
+	QCOMPARE(layoutSpy.count(), 0);
+	QCOMPARE(removeSpy.count(), 1);
+	QCOMPARE(removeSpy.at(0).at(1).toInt(), 1);
+	QCOMPARE(model.values(), QList<int>() << 0 << 4);
+}
+
+QTEST_GUILESS_MAIN(TableModelTest)
+
+#include "tablemodeltest.moc"
@@ -0,0 +1,253 @@
+/*
+ * tsindextest.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <QTemporaryDir>
+#include <QtTest>
+#include "tsindex.h"
+
+class TsIndexTest : public QObject
+{
+	Q_OBJECT
+private slots:
+	void randomAccessPacket();
+	void writerEntries();
+	void writerIgnoresPcrJumps();
+	void indexLookup();
+	void indexFollowsMediaFile();
+	void invalidIndex();
+
+private:
+	enum {
+		VideoPid = 0x100,
+		AudioPid = 0x101
+	};
+
+	// adaptation field only; 'pcr' = -1 means without pcr
+	static QByteArray makePacket(int pid, qint64 pcr, bool randomAccess);
+	// pes packet with 'payload' after the (empty) pes header
+	static QByteArray makePesPacket(int pid, const QByteArray &payload);
+	// a packet every 0.5 seconds; every fourth one is a random access point
+	static QByteArray makeStream(int packetCount);
+};
+
+QByteArray TsIndexTest::makePacket(int pid, qint64 pcr, bool randomAccess)
+{
+	QByteArray packet(188, char(0xff));
+	packet[0] = char(0x47);
+	packet[1] = char((randomAccess ? 0x40 : 0x00) | (pid >> 8));
+	packet[2] = char(pid & 0xff);
+	packet[3] = char(0x20);
+	packet[4] = char(183);
+	packet[5] = char((randomAccess ? 0x40 : 0x00) | ((pcr >= 0) ? 0x10 : 0x00));
+
+	if (pcr >= 0) {
+		packet[6] = char(pcr >> 25);
+		packet[7] = char(pcr >> 17);
+		packet[8] = char(pcr >> 9);
+		packet[9] = char(pcr >> 1);
+		packet[10] = char(((pcr & 0x01) << 7) | 0x7e);
+		packet[11] = char(0x00);
+	}
+
+	return packet;
+}
+
+QByteArray TsIndexTest::makePesPacket(int pid, const QByteArray &payload)
+{
+	QByteArray packet(188, char(0xff));
+	packet[0] = char(0x47);
+	packet[1] = char(0x40 | (pid >> 8));
+	packet[2] = char(pid & 0xff);
+	packet[3] = char(0x10);
+	// pes header without optional fields
+	QByteArray pes = QByteArray::fromHex("000001e00000800000") + payload;
+	packet.replace(4, pes.size(), pes);
+	return packet;
+}
+
+QByteArray TsIndexTest::makeStream(int packetCount)
+{
+	QByteArray stream;
+
+	for (int i = 0; i < packetCount; ++i) {
+		stream += makePacket(VideoPid, i * 45000, (i % 4) == 0);
+	}
+
+	return stream;
+}
+
+void TsIndexTest::randomAccessPacket()
+{
+	QVERIFY(TsGopCache::isRandomAccessPacket(makePacket(VideoPid, 0, true).constData(),
+		VideoPid));
+	QVERIFY(!TsGopCache::isRandomAccessPacket(makePacket(VideoPid, 0, false).constData(),
+		VideoPid));
+	QVERIFY(!TsGopCache::isRandomAccessPacket(makePacket(AudioPid, 0, true).constData(),
+		VideoPid));
+
+	// mpeg-2 sequence header
+	QVERIFY(TsGopCache::isRandomAccessPacket(
+		makePesPacket(VideoPid, QByteArray::fromHex("000001b3")).constData(), VideoPid));
+	// h.264 access unit delimiter (I slices only and P slices)
+	QVERIFY(TsGopCache::isRandomAccessPacket(
+		makePesPacket(VideoPid, QByteArray::fromHex("0000010910")).constData(), VideoPid));
+	QVERIFY(!TsGopCache::isRandomAccessPacket(
+		makePesPacket(VideoPid, QByteArray::fromHex("0000010930")).constData(), VideoPid));
+	// hevc access unit delimiter
+	QVERIFY(TsGopCache::isRandomAccessPacket(
+		makePesPacket(VideoPid, QByteArray::fromHex("000001460110")).constData(), VideoPid));
+	QVERIFY(!TsGopCache::isRandomAccessPacket(
+		makePesPacket(VideoPid, QByteArray::fromHex("000001460150")).constData(), VideoPid));
+}
+
+void TsIndexTest::writerEntries()
+{
+	TsIndexWriter writer;
+	writer.setKeepEntries(true);
+	writer.setPids(VideoPid, VideoPid);
+	QByteArray stream = makeStream(10);
+	writer.processData(stream.constData(), stream.size(), 188 * 100);
+
+	QVector<TsIndexEntry> entries = writer.takeEntries();
+	QCOMPARE(entries.size(), 3);
+	QCOMPARE(entries.at(0).time, 0);
+	QCOMPARE(entries.at(0).offset, qint64(188 * 100));
+	QCOMPARE(entries.at(1).time, 2000);
+	QCOMPARE(entries.at(1).offset, qint64(188 * 104));
+	QCOMPARE(entries.at(2).time, 4000);
+	QCOMPARE(entries.at(2).offset, qint64(188 * 108));
+	QVERIFY(writer.takeEntries().isEmpty());
+
+	// nothing is indexed without video pid
+	writer.reset();
+	writer.setPids(-1, VideoPid);
+	writer.processData(stream.constData(), stream.size(), 0);
+	QVERIFY(writer.takeEntries().isEmpty());
+}
+
+void TsIndexTest::writerIgnoresPcrJumps()
+{
+	TsIndexWriter writer;
+	writer.setKeepEntries(true);
+	writer.setPids(VideoPid, AudioPid);
+	QByteArray stream;
+	// a random access point before the first pcr isn't indexed
+	stream += makePacket(VideoPid, -1, true);
+	stream += makePacket(AudioPid, 90000, false);
+	stream += makePacket(VideoPid, -1, true);
+	// discontinuity (e.g. after retuning)
+	stream += makePacket(AudioPid, 90000 * 100, false);
+	stream += makePacket(AudioPid, 90000 * 101, false);
+	stream += makePacket(VideoPid, -1, true);
+	writer.processData(stream.constData(), stream.size(), 0);
+
+	QVector<TsIndexEntry> entries = writer.takeEntries();
+	QCOMPARE(entries.size(), 2);
+	QCOMPARE(entries.at(0).time, 0);
+	QCOMPARE(entries.at(0).offset, qint64(2 * 188));
+	QCOMPARE(entries.at(1).time, 1000);
+	QCOMPARE(entries.at(1).offset, qint64(5 * 188));
+}
+
+void TsIndexTest::indexLookup()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString mediaFileName = dir.path() + QLatin1String("/test.m2t");
+	QByteArray stream = makeStream(10);
+	QFile mediaFile(mediaFileName);
+	QVERIFY(mediaFile.open(QIODevice::WriteOnly));
+	QCOMPARE(mediaFile.write(stream), qint64(stream.size()));
+	mediaFile.close();
+
+	TsIndex index;
+	QVERIFY(!index.open(mediaFileName));
+
+	TsIndexWriter writer;
+	QVERIFY(writer.open(mediaFileName));
+	writer.setPids(VideoPid, VideoPid);
+	writer.processData(stream.constData(), stream.size(), 0);
+	writer.close();
+	QVERIFY(QFile::exists(TsIndex::indexFileName(mediaFileName)));
+
+	QVERIFY(index.open(mediaFileName));
+	QCOMPARE(index.findEntry(-1).offset, qint64(-1));
+	QCOMPARE(index.findEntry(0).offset, qint64(0));
+	QCOMPARE(index.findEntry(1999).offset, qint64(0));
+	QCOMPARE(index.findEntry(2000).offset, qint64(4 * 188));
+	QCOMPARE(index.findEntry(2000).time, 2000);
+	QCOMPARE(index.findEntry(100000).offset, qint64(8 * 188));
+	QCOMPARE(index.getMediaFileSize(), qint64(stream.size()));
+}
+
+void TsIndexTest::indexFollowsMediaFile()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString mediaFileName = dir.path() + QLatin1String("/test.m2t");
+	QByteArray stream = makeStream(12);
+	QFile mediaFile(mediaFileName);
+	QVERIFY(mediaFile.open(QIODevice::WriteOnly));
+	QCOMPARE(mediaFile.write(stream.left(6 * 188)), qint64(6 * 188));
+	mediaFile.flush();
+
+	// the stream is parsed without file; the entries are written by another instance
+	TsIndexWriter parser;
+	parser.setPids(VideoPid, VideoPid);
+	parser.setKeepEntries(true);
+	TsIndexWriter writer;
+	QVERIFY(writer.open(mediaFileName));
+	parser.processData(stream.constData(), 6 * 188, 0);
+	writer.writeEntries(parser.takeEntries());
+
+	TsIndex index;
+	QVERIFY(index.open(mediaFileName));
+	QCOMPARE(index.findEntry(100000).offset, qint64(4 * 188));
+
+	// the index may be ahead of the media file
+	parser.processData(stream.constData() + (6 * 188), 6 * 188, 6 * 188);
+	writer.writeEntries(parser.takeEntries());
+	QCOMPARE(index.findEntry(100000).offset, qint64(4 * 188));
+
+	QCOMPARE(mediaFile.write(stream.mid(6 * 188)), qint64(6 * 188));
+	mediaFile.flush();
+	QCOMPARE(index.findEntry(100000).offset, qint64(8 * 188));
+	QCOMPARE(index.findEntry(3000).offset, qint64(4 * 188));
+}
+
+void TsIndexTest::invalidIndex()
+{
+	QTemporaryDir dir;
+	QVERIFY(dir.isValid());
+	QString mediaFileName = dir.path() + QLatin1String("/test.m2t");
+	QFile indexFile(TsIndex::indexFileName(mediaFileName));
+	QVERIFY(indexFile.open(QIODevice::WriteOnly));
+	indexFile.write("KTSI\x00\x00\x00\x63", 8);
+	indexFile.close();
+
+	TsIndex index;
+	QVERIFY(!index.open(mediaFileName));
+	QVERIFY(!index.isOpen());
+	QCOMPARE(index.findEntry(0).offset, qint64(-1));
+}
+
+QTEST_GUILESS_MAIN(TsIndexTest)
+
+#include "tsindextest.moc"
@@ -72,6 +72,12 @@ void AbstractMediaWidget::customEvent(QEvent *event)
 {
 	Q_UNUSED(event)
 
+	if (mediaWidget == NULL) {
+		// a player without user interface (e.g. multi view); nothing to update
+		pendingUpdates.fetchAndStoreRelaxed(0);
+		return;
+	}
+
 	while (true) {
 		int oldValue = pendingUpdates;
 		int lowestPendingUpdate = (oldValue & (~(oldValue - 1)));
@@ -184,6 +190,11 @@ void DummyMediaWidget::seek(int time)
 	Q_UNUSED(time)
 }
 
+void DummyMediaWidget::seekFraction(double fraction)
+{
+	Q_UNUSED(fraction)
+}
+
 void DummyMediaWidget::setCurrentAudioStream(int currentAudioStream)
 {
 	Q_UNUSED(currentAudioStream)
@@ -30,6 +30,7 @@ public:
 	explicit AbstractMediaWidget(QWidget *parent);
 	virtual ~AbstractMediaWidget();
 
+	// without media widget the player can only be controlled directly
 	void connectToMediaWidget(MediaWidget *mediaWidget_);
 
 	// zero-based numbering is used everywhere (e.g. first audio channel = 0)
@@ -60,6 +61,8 @@ public:
 	virtual void stop() = 0;
 	virtual void setPaused(bool paused) = 0;
 	virtual void seek(int time) = 0; // milliseconds
+	// [0 - 1]; for transport streams this is the byte position
+	virtual void seekFraction(double fraction) = 0;
 	virtual void setCurrentAudioStream(int currentAudioStream) = 0;
 	virtual void setCurrentSubtitle(int currentSubtitle) = 0;
 	virtual void setExternalSubtitle(const QUrl &subtitleUrl) = 0;
@@ -144,6 +147,7 @@ public:
 	void stop();
 	void setPaused(bool paused);
 	void seek(int time); // milliseconds
+	void seekFraction(double fraction);
 	void setCurrentAudioStream(int currentAudioStream);
 	void setCurrentSubtitle(int currentSubtitle);
 	void setExternalSubtitle(const QUrl &subtitleUrl);
@@ -21,11 +21,39 @@
 #include "vlcmediawidget.h"
 
 #include <QMouseEvent>
+#include <QTimerEvent>
 #include <vlc/vlc.h>
 #include "../log.h"
+#include "../mediastreambuffer.h"
+
+static int vlcStreamOpen(void *opaque, void **data, uint64_t *size)
+{
+	MediaStream *stream = static_cast<MediaStream *>(opaque);
+	stream->open();
+	*data = stream;
+	*size = UINT64_MAX;
+	return 0;
+}
+
+static ssize_t vlcStreamRead(void *data, unsigned char *buffer, size_t size)
+{
+	return static_cast<MediaStream *>(data)->read(reinterpret_cast<char *>(buffer),
+		int(qMin(size, size_t(1 << 20))));
+}
+
+static void addCachingOptions(libvlc_media_t *vlcMedia, int caching)
+{
+	// which value is used depends on the access module; set all of them
+	QByteArray value = QByteArray::number(caching);
+	libvlc_media_add_option(vlcMedia, QByteArray(":live-caching=" + value).constData());
+	libvlc_media_add_option(vlcMedia, QByteArray(":network-caching=" + value).constData());
+	libvlc_media_add_option(vlcMedia, QByteArray(":file-caching=" + value).constData());
+}
 
 VlcMediaWidget::VlcMediaWidget(QWidget *parent) : AbstractMediaWidget(parent), vlcInstance(NULL),
-	vlcMediaPlayer(NULL), playingDvd(false)
+	vlcMediaPlayer(NULL), playingDvd(false), lowLatency(false), liveCaching(DefaultLiveCaching),
+	stableTime(0), restartTime(0), lastReadBytes(0), lastLostFrames(0), latencySum(0),
+	latencyCount(0), stallCount(0)
 {
 }
 
@@ -66,6 +94,10 @@ bool VlcMediaWidget::init()
 
 VlcMediaWidget::~VlcMediaWidget()
 {
+	if (stream != NULL) {
+		stream->interrupt();
+	}
+
 	if (vlcMediaPlayer != NULL) {
 		libvlc_media_player_release(vlcMediaPlayer);
 	}
@@ -140,6 +172,7 @@ void VlcMediaWidget::setDeinterlacing(bool deinterlacing)
 #include <unistd.h>
 void VlcMediaWidget::play(const MediaSource &source)
 {
+	stopLowLatency();
 	addPendingUpdates(PlaybackStatus | DvdMenu);
 	QByteArray url = source.getUrl().toEncoded();
 	char buf[50];
@@ -186,7 +219,16 @@ void VlcMediaWidget::play(const MediaSource &source)
 		break;
 	}
 
-	libvlc_media_t *vlcMedia = libvlc_media_new_location(vlcInstance, url.constData());
+	QSharedPointer<MediaStream> newStream = source.getStream();
+	libvlc_media_t *vlcMedia;
+
+	if (newStream != NULL) {
+		// not seekable
+		vlcMedia = libvlc_media_new_callbacks(vlcInstance, vlcStreamOpen, vlcStreamRead,
+			NULL, NULL, newStream.data());
+	} else {
+		vlcMedia = libvlc_media_new_location(vlcInstance, url.constData());
+	}
 
 	if (vlcMedia == NULL) {
 		libvlc_media_player_stop(vlcMediaPlayer);
@@ -194,17 +236,20 @@ void VlcMediaWidget::play(const MediaSource &source)
 		return;
 	}
 
-	libvlc_event_manager_t *eventManager = libvlc_media_event_manager(vlcMedia);
-	libvlc_event_e eventTypes[] = { libvlc_MediaMetaChanged };
+	// seekFraction() lands exactly on the byte position (see TsIndex)
+	libvlc_media_add_option(vlcMedia, ":ts-seek-percent");
 
-	for (uint i = 0; i < (sizeof(eventTypes) / sizeof(eventTypes[0])); ++i) {
-		if (libvlc_event_attach(eventManager, eventTypes[i], vlcEventHandler, this) != 0) {
-			Log("VlcMediaWidget::play: cannot attach event handler") << eventTypes[i];
-		}
+	if (newStream != NULL) {
+		// skip probing
+		libvlc_media_add_option(vlcMedia, ":demux=ts");
+		lowLatency = source.preferLowLatency();
 	}
 
-	libvlc_media_player_set_media(vlcMediaPlayer, vlcMedia);
-	libvlc_media_release(vlcMedia);
+	if (lowLatency) {
+		addCachingOptions(vlcMedia, liveCaching);
+	}
+
+	setMedia(vlcMedia, newStream);
 
 //	FIXME!
 
@@ -219,10 +264,27 @@ void VlcMediaWidget::play(const MediaSource &source)
 	if (libvlc_media_player_play(vlcMediaPlayer) != 0) {
 		Log("VlcMediaWidget::play: cannot play media") << source.getUrl().toDisplayString();
 	}
+
+	if (lowLatency) {
+		stableTime = 0;
+		restartTime = 0;
+		lastReadBytes = 0;
+		lastLostFrames = 0;
+		latencySum = 0;
+		latencyCount = 0;
+		stallCount = 0;
+		latencyTimer.start(LatencyInterval, this);
+	}
 }
 
 void VlcMediaWidget::stop()
 {
+	stopLowLatency();
+
+	if (stream != NULL) {
+		stream->interrupt();
+	}
+
 	libvlc_media_player_stop(vlcMediaPlayer);
 }
 
@@ -238,6 +300,11 @@ void VlcMediaWidget::seek(int time)
 	libvlc_media_player_set_time(vlcMediaPlayer, time);
 }
 
+void VlcMediaWidget::seekFraction(double fraction)
+{
+	libvlc_media_player_set_position(vlcMediaPlayer, float(fraction));
+}
+
 void VlcMediaWidget::setCurrentAudioStream(int currentAudioStream)
 {
 	// skip the 'deactivate' audio channel
@@ -500,6 +567,75 @@ void VlcMediaWidget::updateVideoSize()
 	// FIXME
 }
 
+void VlcMediaWidget::setMedia(libvlc_media_t *vlcMedia, const QSharedPointer<MediaStream> &newStream)
+{
+	libvlc_event_manager_t *eventManager = libvlc_media_event_manager(vlcMedia);
+	libvlc_event_e eventTypes[] = { libvlc_MediaMetaChanged };
+
+	for (uint i = 0; i < (sizeof(eventTypes) / sizeof(eventTypes[0])); ++i) {
+		if (libvlc_event_attach(eventManager, eventTypes[i], vlcEventHandler, this) != 0) {
+			Log("VlcMediaWidget::setMedia: cannot attach event handler") << eventTypes[i];
+		}
+	}
+
+	// the reading thread of the current media has to return before it can be stopped
+	if (stream != NULL) {
+		stream->interrupt();
+	}
+
+	libvlc_media_player_set_media(vlcMediaPlayer, vlcMedia);
+	libvlc_media_release(vlcMedia);
+	stream = newStream;
+}
+
+void VlcMediaWidget::stopLowLatency()
+{
+	if (!lowLatency) {
+		return;
+	}
+
+	lowLatency = false;
+	latencyTimer.stop();
+
+	if (latencyCount > 0) {
+		Log("VlcMediaWidget::stopLowLatency: average estimated latency (ms) / stalls / "
+			"caching (ms)") << qint64(latencySum / latencyCount) << stallCount << liveCaching;
+	}
+}
+
+void VlcMediaWidget::restartLowLatency()
+{
+	if (mediaWidget != NULL) {
+		// the source starts the stream again with the cached group of pictures (the
+		// picture doesn't go blank) and play() uses the current caching
+		addPendingUpdates(PlaybackFinished);
+		restartTime = 0;
+		return;
+	}
+
+	libvlc_media_t *vlcMedia = libvlc_media_new_callbacks(vlcInstance, vlcStreamOpen,
+		vlcStreamRead, NULL, NULL, stream.data());
+
+	if (vlcMedia == NULL) {
+		Log("VlcMediaWidget::restartLowLatency: cannot create media");
+		return;
+	}
+
+	libvlc_media_add_option(vlcMedia, ":demux=ts");
+	addCachingOptions(vlcMedia, liveCaching);
+	// the new media starts reading at the current end of the stream (there's no picture
+	// until the next random access point)
+	setMedia(vlcMedia, stream);
+
+	if (libvlc_media_player_play(vlcMediaPlayer) != 0) {
+		Log("VlcMediaWidget::restartLowLatency: cannot play media");
+	}
+
+	restartTime = 0;
+	lastReadBytes = 0;
+	lastLostFrames = 0;
+}
+
 void VlcMediaWidget::mousePressEvent(QMouseEvent *event)
 {
 	if (event->button() == Qt::LeftButton) {
@@ -509,6 +645,81 @@ void VlcMediaWidget::mousePressEvent(QMouseEvent *event)
 	AbstractMediaWidget::mousePressEvent(event);
 }
 
+void VlcMediaWidget::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() != latencyTimer.timerId()) {
+		AbstractMediaWidget::timerEvent(event);
+		return;
+	}
+
+	if ((stream == NULL) || (libvlc_media_player_get_state(vlcMediaPlayer) != libvlc_Playing)) {
+		return;
+	}
+
+	libvlc_media_t *vlcMedia = libvlc_media_player_get_media(vlcMediaPlayer);
+
+	if (vlcMedia == NULL) {
+		return;
+	}
+
+	libvlc_media_stats_t stats;
+	bool statsValid = libvlc_media_get_stats(vlcMedia, &stats);
+	libvlc_media_release(vlcMedia);
+
+	if (!statsValid) {
+		return;
+	}
+
+	qint64 readBytes = stats.i_read_bytes;
+	qint64 lostFrames = (qint64(stats.i_lost_pictures) + stats.i_lost_abuffers);
+	qint64 readDelta = (readBytes - lastReadBytes);
+	bool stalled = (lostFrames > lastLostFrames);
+	lastReadBytes = readBytes;
+	lastLostFrames = lostFrames;
+	stableTime += LatencyInterval;
+	restartTime += LatencyInterval;
+
+	int bufferedBytes = stream->getBufferedBytes();
+	int backlogTime = 0;
+
+	if (bufferedBytes > 0) {
+		if (readDelta > 0) {
+			backlogTime = int((bufferedBytes * qint64(LatencyInterval)) / readDelta);
+		} else {
+			// there's data, but the player doesn't read it
+			backlogTime = LatencyInterval;
+			stalled = true;
+		}
+	}
+
+	int latency = (liveCaching + backlogTime);
+	latencySum += latency;
+	++latencyCount;
+
+	if (restartTime < MinRestartInterval) {
+		// the player is still starting
+		return;
+	}
+
+	if (stalled) {
+		++stallCount;
+		stableTime = 0;
+	}
+
+	if (stalled && (liveCaching < MaxLiveCaching)) {
+		liveCaching = qMin(((liveCaching * 3) / 2), int(MaxLiveCaching));
+		Log("VlcMediaWidget::timerEvent: stall; increasing caching (ms) / latency (ms)") <<
+			liveCaching << latency;
+		restartLowLatency();
+	} else if ((stableTime >= StableTime) && (liveCaching > MinLiveCaching)) {
+		// the stream isn't restarted for this (the new caching is used at the next start)
+		liveCaching = qMax(((liveCaching * 4) / 5), int(MinLiveCaching));
+		stableTime = 0;
+		Log("VlcMediaWidget::timerEvent: stable; decreasing caching (ms) / latency (ms)") <<
+			liveCaching << latency;
+	}
+}
+
 void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 {
 	PendingUpdates pendingUpdatesToBeAdded = 0;
@@ -531,7 +742,11 @@ void VlcMediaWidget::vlcEvent(const libvlc_event_t *event)
 		break;
 	case libvlc_MediaPlayerStopped:
 		playbackStatus = MediaWidget::Idle;
-		mediaWidget->playbackStatusChanged();
+
+		if (mediaWidget != NULL) {
+			mediaWidget->playbackStatusChanged();
+		}
+
 		break;
 	case libvlc_MediaPlayerTimeChanged:
 		pendingUpdatesToBeAdded = CurrentTotalTime;
@@ -21,10 +21,12 @@
 #ifndef VLCMEDIAWIDGET_H
 #define VLCMEDIAWIDGET_H
 
+#include <QBasicTimer>
 #include "../abstractmediawidget.h"
 
 class libvlc_event_t;
 class libvlc_instance_t;
+class libvlc_media_t;
 class libvlc_media_player_t;
 
 class VlcMediaWidget : public AbstractMediaWidget
@@ -48,6 +50,7 @@ public:
 	void stop();
 	void setPaused(bool paused);
 	void seek(int time); // milliseconds
+	void seekFraction(double fraction);
 	void setCurrentAudioStream(int currentAudioStream);
 	void setCurrentSubtitle(int currentSubtitle);
 	void setExternalSubtitle(const QUrl &subtitleUrl);
@@ -71,14 +74,46 @@ public:
 	void updateVideoSize();
 
 private:
+	enum Constants {
+		// low latency mode (the caching is in milliseconds)
+		DefaultLiveCaching = 300,
+		MinLiveCaching = 100,
+		MaxLiveCaching = 2000,
+		LatencyInterval = 1000, // ms; the buffer fill and the player statistics are checked
+		StableTime = 60000, // ms; the caching is decreased after this time without stalls
+		MinRestartInterval = 5000 // ms
+	};
+
+	void setMedia(libvlc_media_t *vlcMedia, const QSharedPointer<MediaStream> &newStream);
+	void stopLowLatency();
+	// restarts the stream with the current caching (after a stall)
+	void restartLowLatency();
 	void mousePressEvent(QMouseEvent *event);
+	void timerEvent(QTimerEvent *event);
 	void vlcEvent(const libvlc_event_t *event);
 
 	static void vlcEventHandler(const libvlc_event_t *event, void *instance);
 
 	libvlc_instance_t *vlcInstance;
 	libvlc_media_player_t *vlcMediaPlayer;
+	QSharedPointer<MediaStream> stream; // of the current media (if any)
 	bool playingDvd;
+
+	// low latency mode for live streams: the caching is increased after stalls (lost
+	// pictures or audio buffers) and slowly decreased while playback is stable (this is
+	// used at the next start); the reported latency is an estimate (caching + not yet read
+	// data / read rate), not the glass-to-glass delay (decoding, output and the delay of
+	// the broadcast itself aren't included)
+	bool lowLatency;
+	int liveCaching; // kept across streams
+	QBasicTimer latencyTimer;
+	int stableTime;
+	int restartTime; // time since the last restart
+	qint64 lastReadBytes;
+	qint64 lastLostFrames;
+	qint64 latencySum;
+	int latencyCount;
+	int stallCount;
 };
 
 #endif /* VLCMEDIAWIDGET_H */
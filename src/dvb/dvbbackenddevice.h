@@ -82,6 +82,9 @@ class DvbPidFilter
 {
 public:
 	virtual void processData(const char data[188]) = 0;
+	// called after the packets which were available at once have been passed to
+	// processData() (the filter can pass its data on in one piece)
+	virtual void processBatchEnd() { }
 
 protected:
 	DvbPidFilter() { }
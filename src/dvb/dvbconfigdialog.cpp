@@ -28,6 +28,7 @@
 #include <QProgressBar>
 #include <QPushButton>
 #include <QRadioButton>
+#include <QRegExp>
 #include <QSpinBox>
 #include <QToolButton>
 #include <QTreeWidget>
@@ -105,16 +106,24 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 	endMarginBox->setRange(0, 99);
 	endMarginBox->setValue(manager->getEndMargin() / 60);
 	gridLayout->addWidget(endMarginBox, 3, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Tune in advance (seconds):")), 4, 0);
+
+	preTuneTimeBox = new QSpinBox(widget);
+	preTuneTimeBox->setRange(0, 300);
+	preTuneTimeBox->setValue(manager->getPreTuneTime());
+	preTuneTimeBox->setToolTip(i18n("The device is tuned before the recording starts, so that the first second is not lost."));
+	gridLayout->addWidget(preTuneTimeBox, 4, 1);
 	boxLayout->addLayout(gridLayout);
 
-	gridLayout->addWidget(new QLabel(i18n("Naming style for recordings:")), 4, 0);
+	gridLayout->addWidget(new QLabel(i18n("Naming style for recordings:")), 5, 0);
 
 	namingFormat = new KLineEdit(widget);
 	namingFormat->setText(manager->getNamingFormat());
 	namingFormat->setToolTip(i18n("The following substitutions work: \"%year\" for year (YYYY) and the following: %month, %day, %hour, %min, %sec, %channel and %title"));
 	connect(namingFormat, SIGNAL(textChanged(QString)), this, SLOT(namingFormatChanged(QString)));
 
-	gridLayout->addWidget(namingFormat, 4, 1);
+	gridLayout->addWidget(namingFormat, 5, 1);
 	boxLayout->addLayout(gridLayout);
 
 	validPixmap = QIcon::fromTheme(QLatin1String("dialog-ok-apply")).pixmap(KIconLoader::SizeSmallMedium);
@@ -122,15 +131,15 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 
 	namingFormatValidLabel = new QLabel(widget);
 	namingFormatValidLabel->setPixmap(validPixmap);
-	gridLayout->addWidget(namingFormatValidLabel, 4,2);
+	gridLayout->addWidget(namingFormatValidLabel, 5,2);
 
 
-	gridLayout->addWidget(new QLabel(i18n("Action after recording finishes.")),	5, 0);
+	gridLayout->addWidget(new QLabel(i18n("Action after recording finishes.")),	6, 0);
 
 	actionAfterRecordingLineEdit = new KLineEdit(widget);
 	actionAfterRecordingLineEdit->setText(manager->getActionAfterRecording());
 	actionAfterRecordingLineEdit->setToolTip(i18n("Leave empty for no command."));
-	gridLayout->addWidget(actionAfterRecordingLineEdit, 5, 1);
+	gridLayout->addWidget(actionAfterRecordingLineEdit, 6, 1);
 
 	boxLayout->addLayout(gridLayout);
 
@@ -154,6 +163,125 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 	scanWhenIdleBox->setChecked(manager->isScanWhenIdle());
 	gridLayout->addWidget(scanWhenIdleBox, 3, 1);
 
+	gridLayout->addWidget(new QLabel(i18n("Write recordings to disk:")), 4, 0);
+	writeSyncPolicyBox = new KComboBox(widget);
+	writeSyncPolicyBox->addItem(i18n("When the system decides"));
+	writeSyncPolicyBox->addItem(i18n("Continuously"));
+	writeSyncPolicyBox->addItem(i18n("Synchronously"));
+	writeSyncPolicyBox->setCurrentIndex(manager->getWriteSyncPolicy());
+	gridLayout->addWidget(writeSyncPolicyBox, 4, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Bypass the page cache for recordings:")), 5, 0);
+	directIoBox = new QCheckBox(widget);
+	directIoBox->setChecked(manager->isDirectIoEnabled());
+	gridLayout->addWidget(directIoBox, 5, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Split recordings after (MiB):")), 6, 0);
+	segmentSizeBox = new QSpinBox(widget);
+	segmentSizeBox->setRange(0, 999999);
+	segmentSizeBox->setSpecialValueText(i18n("Never"));
+	segmentSizeBox->setValue(manager->getSegmentSize());
+	gridLayout->addWidget(segmentSizeBox, 6, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Split recordings after (minutes):")), 7, 0);
+	segmentDurationBox = new QSpinBox(widget);
+	segmentDurationBox->setRange(0, 9999);
+	segmentDurationBox->setSpecialValueText(i18n("Never"));
+	segmentDurationBox->setValue(manager->getSegmentDuration());
+	gridLayout->addWidget(segmentDurationBox, 7, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Number of parts to keep:")), 8, 0);
+	segmentRetentionBox = new QSpinBox(widget);
+	segmentRetentionBox->setRange(0, 9999);
+	segmentRetentionBox->setSpecialValueText(i18n("All"));
+	segmentRetentionBox->setValue(manager->getSegmentRetention());
+	segmentRetentionBox->setToolTip(i18n("The oldest parts of split recordings are deleted (for monitoring channels). Requires a playlist."));
+	gridLayout->addWidget(segmentRetentionBox, 8, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Create a playlist for split recordings:")), 9, 0);
+	segmentManifestBox = new QCheckBox(widget);
+	segmentManifestBox->setChecked(manager->isSegmentManifestEnabled());
+	gridLayout->addWidget(segmentManifestBox, 9, 1);
+	// without a playlist the recording would point to a deleted part
+	segmentRetentionBox->setEnabled(segmentManifestBox->isChecked());
+	connect(segmentManifestBox, SIGNAL(toggled(bool)), segmentRetentionBox, SLOT(setEnabled(bool)));
+
+	DvbStreamSelection streamSelection(manager->getStreamSelection());
+
+	gridLayout->addWidget(new QLabel(i18n("Record audio languages:")), 10, 0);
+	audioLanguagesEdit = new KLineEdit(widget);
+	audioLanguagesEdit->setText(streamSelection.audioLanguages.join(QLatin1String(",")));
+	audioLanguagesEdit->setToolTip(i18n("Comma separated language codes (for example \"deu,eng\"). Leave empty to record all audio streams."));
+	gridLayout->addWidget(audioLanguagesEdit, 10, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Do not record audio description:")), 11, 0);
+	dropAudioDescriptionBox = new QCheckBox(widget);
+	dropAudioDescriptionBox->setChecked(streamSelection.dropAudioDescription);
+	gridLayout->addWidget(dropAudioDescriptionBox, 11, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Do not record teletext:")), 12, 0);
+	dropTeletextBox = new QCheckBox(widget);
+	dropTeletextBox->setChecked(streamSelection.dropTeletext);
+	gridLayout->addWidget(dropTeletextBox, 12, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Record subtitle language:")), 13, 0);
+	subtitleLanguageEdit = new KLineEdit(widget);
+	subtitleLanguageEdit->setText(streamSelection.subtitleLanguage);
+	subtitleLanguageEdit->setToolTip(i18n("Leave empty to record all subtitles."));
+	gridLayout->addWidget(subtitleLanguageEdit, 13, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Record overlapping recordings of a transponder into one file:")), 14, 0);
+	muxRecordingBox = new QCheckBox(widget);
+	muxRecordingBox->setChecked(manager->isMuxRecordingEnabled());
+	muxRecordingBox->setToolTip(i18n("Recordings on the same transponder share a single file. Recordings which are written this way are not split into parts."));
+	gridLayout->addWidget(muxRecordingBox, 14, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Extract the recordings from the transponder file:")), 15, 0);
+	muxExtractionBox = new QCheckBox(widget);
+	muxExtractionBox->setChecked(manager->isMuxExtractionEnabled());
+	muxExtractionBox->setToolTip(i18n("The transponder file is deleted after the recordings have been extracted."));
+	gridLayout->addWidget(muxExtractionBox, 15, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Time shift buffer in memory (MiB):")), 16, 0);
+	timeShiftMemorySizeBox = new QSpinBox(widget);
+	timeShiftMemorySizeBox->setRange(2, 4096);
+	timeShiftMemorySizeBox->setValue(manager->getTimeShiftMemorySize());
+	gridLayout->addWidget(timeShiftMemorySizeBox, 16, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Time shift buffer on disk (MiB):")), 17, 0);
+	timeShiftFileSizeBox = new QSpinBox(widget);
+	timeShiftFileSizeBox->setRange(0, 999999);
+	timeShiftFileSizeBox->setSpecialValueText(i18n("None"));
+	timeShiftFileSizeBox->setValue(manager->getTimeShiftFileSize());
+	timeShiftFileSizeBox->setToolTip(i18n("The space is reserved in the time shift folder. The oldest part of the buffer is overwritten when it is full."));
+	gridLayout->addWidget(timeShiftFileSizeBox, 17, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Always buffer live TV:")), 18, 0);
+	timeShiftAlwaysOnBox = new QCheckBox(widget);
+	timeShiftAlwaysOnBox->setChecked(manager->isTimeShiftAlwaysOn());
+	timeShiftAlwaysOnBox->setToolTip(i18n("Live TV can be rewound at any time. Otherwise buffering starts when pausing."));
+	gridLayout->addWidget(timeShiftAlwaysOnBox, 18, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Pre-tune neighbouring channels:")), 19, 0);
+	fastZapBox = new QCheckBox(widget);
+	fastZapBox->setChecked(manager->isFastZapEnabled());
+	fastZapBox->setToolTip(i18n("Switching to the previous or next channel is faster. Uses idle devices."));
+	gridLayout->addWidget(fastZapBox, 19, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Streaming server port:")), 20, 0);
+	streamingPortBox = new QSpinBox(widget);
+	streamingPortBox->setRange(0, 65535);
+	streamingPortBox->setSpecialValueText(i18n("Disabled"));
+	streamingPortBox->setValue(manager->getStreamingPort());
+	streamingPortBox->setToolTip(i18n("Live TV is served to other players on the network (the channel list is at http://host:port/)."));
+	gridLayout->addWidget(streamingPortBox, 20, 1);
+
+	gridLayout->addWidget(new QLabel(i18n("Low latency live TV:")), 21, 0);
+	lowLatencyBox = new QCheckBox(widget);
+	lowLatencyBox->setChecked(manager->isLowLatencyEnabled());
+	lowLatencyBox->setToolTip(i18n("Live TV is played with a smaller delay. Playback may stall briefly on weak systems."));
+	gridLayout->addWidget(lowLatencyBox, 21, 1);
+
 	boxLayout->addLayout(gridLayout);
 
 	QFrame *frame = new QFrame(widget);
@@ -234,6 +362,10 @@ DvbConfigDialog::DvbConfigDialog(DvbManager *manager_, QWidget *parent) : QDialo
 		inputLine->spinBox = new QSpinBox();
 		inputLine->spinBox->setValue(manager->getRecordingRegexPriorityList().value(j));
 		regexGrid->addWidget(inputLine->spinBox, j, 1);
+		inputLine->streamsEdit = new KLineEdit(widget);
+		inputLine->streamsEdit->setText(manager->getRecordingRegexStreamsList().value(j));
+		inputLine->streamsEdit->setToolTip(streamsToolTip());
+		regexGrid->addWidget(inputLine->streamsEdit, j, 3);
 
 		inputLine->index = j;
 
@@ -323,6 +455,10 @@ void DvbConfigDialog::newRegex()
 	inputLine->spinBox->setValue(5);
 	regexGrid->addWidget(inputLine->spinBox, regexInputList.size(), 1);
 
+	inputLine->streamsEdit = new KLineEdit(tabWidget);
+	inputLine->streamsEdit->setToolTip(streamsToolTip());
+	regexGrid->addWidget(inputLine->streamsEdit, regexInputList.size(), 3);
+
 	regexInputList.append(inputLine);
 }
 
@@ -364,6 +500,12 @@ void DvbConfigDialog::removeWidgets(QGridLayout *layout, int row, int column, bo
     }
 }
 
+QString DvbConfigDialog::streamsToolTip()
+{
+	return i18n("Streams to record, for example \"audio:deu,eng noad notext sub:deu\" "
+		"(\"all\" records everything). Leave empty to use the general options.");
+}
+
 void DvbConfigDialog::initRegexButtons(QGridLayout *buttonGrid)
 {
 	QAction *action = new QAction(QIcon::fromTheme(QLatin1String("list-add")), i18nc("@action", "Add new Regex"), tabWidget);
@@ -423,6 +565,10 @@ void DvbConfigDialog::removeRegex()
 		inputLine->spinBox = new QSpinBox();
 		inputLine->spinBox->setValue(oldLine->spinBox->value());
 		regexGrid->addWidget(inputLine->spinBox, j, 1);
+		inputLine->streamsEdit = new KLineEdit();
+		inputLine->streamsEdit->setText(oldLine->streamsEdit->text());
+		inputLine->streamsEdit->setToolTip(streamsToolTip());
+		regexGrid->addWidget(inputLine->streamsEdit, j, 3);
 
 		inputLine->index = j;
 
@@ -602,9 +748,33 @@ void DvbConfigDialog::accept()
 	manager->setActionAfterRecording(actionAfterRecordingLineEdit->text());
 	manager->setBeginMargin(beginMarginBox->value() * 60);
 	manager->setEndMargin(endMarginBox->value() * 60);
+	manager->setPreTuneTime(preTuneTimeBox->value());
 	manager->setOverride6937Charset(override6937CharsetBox->isChecked());
 	manager->setCreateInfoFile(createInfoFileBox->isChecked());
 	manager->setScanWhenIdle(scanWhenIdleBox->isChecked());
+	manager->setWriteSyncPolicy(writeSyncPolicyBox->currentIndex());
+	manager->setDirectIoEnabled(directIoBox->isChecked());
+	manager->setSegmentSize(segmentSizeBox->value());
+	manager->setSegmentDuration(segmentDurationBox->value());
+	manager->setSegmentRetention(segmentRetentionBox->value());
+	manager->setSegmentManifestEnabled(segmentManifestBox->isChecked());
+	DvbStreamSelection streamSelection;
+	streamSelection.audioLanguages = audioLanguagesEdit->text().toLower().split(
+		QRegExp(QLatin1String("[, ]")), QString::SkipEmptyParts);
+	streamSelection.dropAudioDescription = dropAudioDescriptionBox->isChecked();
+	streamSelection.dropTeletext = dropTeletextBox->isChecked();
+	streamSelection.subtitleLanguage = subtitleLanguageEdit->text().trimmed().toLower();
+	manager->setStreamSelection(streamSelection.toString());
+	manager->setMuxRecordingEnabled(muxRecordingBox->isChecked());
+	manager->setMuxExtractionEnabled(muxExtractionBox->isChecked());
+	manager->setTimeShiftMemorySize(timeShiftMemorySizeBox->value());
+	manager->setTimeShiftFileSize(timeShiftFileSizeBox->value());
+	manager->setTimeShiftAlwaysOn(timeShiftAlwaysOnBox->isChecked());
+	manager->setFastZapEnabled(fastZapBox->isChecked());
+	manager->setStreamingPort(streamingPortBox->value());
+	manager->setLowLatencyEnabled(lowLatencyBox->isChecked());
+
+	QStringList streamsList;
 	manager->setRecordingRegexList(QStringList());
 	manager->setRecordingRegexPriorityList(QList<int>());
 
@@ -616,8 +786,11 @@ void DvbConfigDialog::accept()
 		manager->addRecordingRegexPriority(regexInputLine->spinBox->value());
 		Log("DvbConfigDialog::accept: saved priority:") <<
 				regexInputLine->spinBox->value();
+		streamsList.append(regexInputLine->streamsEdit->text().trimmed());
 	}
 
+	manager->setRecordingRegexStreamsList(streamsList);
+
 	bool latitudeOk;
 	bool longitudeOk;
 	double latitude = toLatitude(latitudeEdit->text(), &latitudeOk);
@@ -638,8 +811,6 @@ void DvbConfigDialog::accept()
 
 	manager->updateDeviceConfigs(configUpdates);
 	manager->getRecordingModel()->findNewRecordings();
-	manager->getRecordingModel()->removeDuplicates();
-	manager->getRecordingModel()->disableConflicts();
 	//manager->getRecordingModel()->scanChannels();
 
 	QDialog::accept();
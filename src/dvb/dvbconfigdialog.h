@@ -61,6 +61,7 @@ public:
 	KLineEdit *lineEdit;
 	QSpinBox *spinBox;
 	QCheckBox *checkBox;
+	KLineEdit *streamsEdit;
 
 };
 
@@ -93,6 +94,7 @@ private:
 	static double toLongitude(const QString &text, bool *ok);
 	void removeWidgets(QGridLayout *layout, int row, int column, bool deleteWidgets);
 	void initRegexButtons(QGridLayout *buttonGrid);
+	static QString streamsToolTip();
 	//void deleteChildWidgets(QLayoutItem *item);
 
 	void accept();
@@ -103,10 +105,29 @@ private:
 	KLineEdit *timeShiftFolderEdit;
 	QSpinBox *beginMarginBox;
 	QSpinBox *endMarginBox;
+	QSpinBox *preTuneTimeBox;
 	KLineEdit *namingFormat;
 	QCheckBox *override6937CharsetBox;
 	QCheckBox *createInfoFileBox;
 	QCheckBox *scanWhenIdleBox;
+	KComboBox *writeSyncPolicyBox;
+	QCheckBox *directIoBox;
+	QSpinBox *segmentSizeBox;
+	QSpinBox *segmentDurationBox;
+	QSpinBox *segmentRetentionBox;
+	QCheckBox *segmentManifestBox;
+	KLineEdit *audioLanguagesEdit;
+	QCheckBox *dropAudioDescriptionBox;
+	QCheckBox *dropTeletextBox;
+	KLineEdit *subtitleLanguageEdit;
+	QCheckBox *muxRecordingBox;
+	QCheckBox *muxExtractionBox;
+	QSpinBox *timeShiftMemorySizeBox;
+	QSpinBox *timeShiftFileSizeBox;
+	QCheckBox *timeShiftAlwaysOnBox;
+	QCheckBox *fastZapBox;
+	QCheckBox *lowLatencyBox;
+	QSpinBox *streamingPortBox;
 	KLineEdit *latitudeEdit;
 	KLineEdit *longitudeEdit;
 	QPixmap validPixmap;
@@ -29,6 +29,7 @@
 #include "dvbconfig.h"
 #include "dvbmanager.h"
 #include "dvbsi.h"
+#include "dvbtswriter.h"
 
 class DvbFilterInternal
 {
@@ -209,7 +210,7 @@ void DvbSectionFilterInternal::processSections(bool force)
 	buffer.remove(0, int(it - buffer.constBegin()));
 }
 
-class DvbDataDumper : public QFile, public DvbPidFilter
+class DvbDataDumper : public DvbTsWriter, public DvbPidFilter
 {
 public:
 	DvbDataDumper();
@@ -220,11 +221,11 @@ public:
 
 DvbDataDumper::DvbDataDumper()
 {
-	setFileName(QDir::homePath() + QLatin1String("/KaffeineDvbDump-") + QString::number(qrand(), 16) +
-		QLatin1String(".bin"));
+	QString fileName = QDir::homePath() + QLatin1String("/KaffeineDvbDump-") +
+		QString::number(qrand(), 16) + QLatin1String(".bin");
 
-	if (!open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-		Log("DvbDataDumper::DvbDataDumper: cannot open") << fileName();
+	if (!open(fileName)) {
+		Log("DvbDataDumper::DvbDataDumper: cannot open") << fileName;
 	}
 }
 
@@ -957,6 +958,7 @@ void DvbDevice::customEvent(QEvent *)
 	}
 
 	DvbDeviceDataBuffer *buffer = NULL;
+	bool processedData = false;
 
 	while (true) {
 		dataChannelMutex.lock();
@@ -997,6 +999,19 @@ void DvbDevice::customEvent(QEvent *)
 			for (int j = 0; j < pidFiltersSize; ++j) {
 				pidFilters.at(j)->processData(packet);
 			}
+
+			processedData = true;
+		}
+	}
+
+	if (processedData) {
+		for (QMap<int, DvbFilterInternal>::const_iterator it = filters.constBegin();
+		     it != filters.constEnd(); ++it) {
+			const QList<DvbPidFilter *> &pidFilters = it->filters;
+
+			for (int j = 0; j < pidFilters.size(); ++j) {
+				pidFilters.at(j)->processBatchEnd();
+			}
 		}
 	}
 }
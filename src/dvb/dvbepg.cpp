@@ -21,9 +21,15 @@
 #include "dvbepg.h"
 #include "dvbepg_p.h"
 
+#include <QCoreApplication>
+#include <QDir>
+#include <QElapsedTimer>
 #include <QFile>
+#include <QMutex>
+#include <QSaveFile>
 #include <QStandardPaths>
 #include <QDataStream>
+#include <algorithm>
 #include "../ensurenopendingoperation.h"
 #include "../log.h"
 #include "dvbdevice.h"
@@ -40,37 +46,9 @@ bool DvbEpgEntry::validate() const
 	return false;
 }
 
-bool DvbEpgEntryId::operator<(const DvbEpgEntryId &other) const
-{
-	if (entry->channel != other.entry->channel) {
-		return (entry->channel < other.entry->channel);
-	}
-
-	if (entry->begin != other.entry->begin) {
-		return (entry->begin < other.entry->begin);
-	}
-
-	if (entry->duration != other.entry->duration) {
-		return (entry->duration < other.entry->duration);
-	}
-
-	if (entry->title != other.entry->title) {
-		return (entry->title < other.entry->title);
-	}
-
-	if (entry->subheading != other.entry->subheading) {
-		return (entry->subheading < other.entry->subheading);
-	}
-
-	if (!entry->details.isEmpty() && !other.entry->details.isEmpty()) {
-		return (entry->details < other.entry->details);
-	}
-
-	return false;
-}
-
 DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent),
-	manager(manager_), hasPendingOperation(false)
+	manager(manager_), decoder(NULL), storage(NULL), batchingEntries(false), loading(true),
+	replayingRecords(false), journalTimerId(0), entryCount(0), hasPendingOperation(false)
 {
 	currentDateTimeUtc = QDateTime::currentDateTime().toUTC();
 	startTimer(54000);
@@ -85,57 +63,9 @@ DvbEpgModel::DvbEpgModel(DvbManager *manager_, QObject *parent) : QObject(parent
 	connect(manager->getRecordingModel(), SIGNAL(recordingRemoved(DvbSharedRecording)),
 		this, SLOT(recordingRemoved(DvbSharedRecording)));
 
-	// TODO use SQL to store epg data
-
-	QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + QLatin1String("epgdata.dvb"));
-
-	if (!file.open(QIODevice::ReadOnly)) {
-		Log("DvbEpgModel::DvbEpgModel: cannot open") << file.fileName();
-		return;
-	}
-
-	QDataStream stream(&file);
-	stream.setVersion(QDataStream::Qt_4_4);
-	DvbRecordingModel *recordingModel = manager->getRecordingModel();
-	bool hasRecordingKey = true;
-	int version;
-	stream >> version;
-
-	if (version == 0x1ce0eca7) {
-		hasRecordingKey = false;
-	} else if (version != 0x79cffd36) {
-		Log("DvbEpgModel::DvbEpgModel: wrong version") << file.fileName();
-		return;
-	}
-
-	while (!stream.atEnd()) {
-		DvbEpgEntry entry;
-		QString channelName;
-		stream >> channelName;
-		entry.channel = channelModel->findChannelByName(channelName);
-		stream >> entry.begin;
-		entry.begin = entry.begin.toUTC();
-		stream >> entry.duration;
-		stream >> entry.title;
-		stream >> entry.subheading;
-		stream >> entry.details;
-
-		if (hasRecordingKey) {
-			SqlKey recordingKey;
-			stream >> recordingKey.sqlKey;
-
-			if (recordingKey.isSqlKeyValid()) {
-				entry.recording = recordingModel->findRecordingByKey(recordingKey);
-			}
-		}
-
-		if (stream.status() != QDataStream::Ok) {
-			Log("DvbEpgModel::DvbEpgModel: corrupt data") << file.fileName();
-			break;
-		}
-
-		addEntry(entry);
-	}
+	decoder = new DvbEpgDecoder(this);
+	storage = new DvbEpgStorage();
+	storage->startLoading(this);
 }
 
 DvbEpgModel::~DvbEpgModel()
@@ -148,33 +78,10 @@ DvbEpgModel::~DvbEpgModel()
 		Log("DvbEpgModel::~DvbEpgModel: filter list not empty");
 	}
 
-	QFile file(QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + QLatin1String("epgdata.dvb"));
-
-	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
-		Log("DvbEpgModel::~DvbEpgModel: cannot open") << file.fileName();
-		return;
-	}
-
-	QDataStream stream(&file);
-	stream.setVersion(QDataStream::Qt_4_4);
-	int version = 0x79cffd36;
-	stream << version;
-
-	foreach (const DvbSharedEpgEntry &entry, entries) {
-		SqlKey recordingKey;
-
-		if (entry->recording.isValid()) {
-			recordingKey = *entry->recording;
-		}
-
-		stream << entry->channel->name;
-		stream << entry->begin;
-		stream << entry->duration;
-		stream << entry->title;
-		stream << entry->subheading;
-		stream << entry->details;
-		stream << recordingKey.sqlKey;
-	}
+	// the remaining decoded entries are dropped
+	delete decoder;
+	// all changes are already in the journal
+	delete storage;
 }
 
 QMap<DvbSharedRecording, DvbSharedEpgEntry> DvbEpgModel::getRecordings() const
@@ -187,27 +94,91 @@ void DvbEpgModel::setRecordings(const QMap<DvbSharedRecording, DvbSharedEpgEntry
 	recordings = map;
 }
 
-QMap<DvbEpgEntryId, DvbSharedEpgEntry> DvbEpgModel::getEntries() const
+QList<DvbSharedEpgEntry> DvbEpgModel::getEntries() const
 {
-	return entries;
+	QList<DvbSharedEpgEntry> result;
+
+	for (ConstIterator it = channelEntries.constBegin(); it != channelEntries.constEnd(); ++it) {
+		foreach (const DvbSharedEpgEntry &entry, it->entries) {
+			result.append(entry);
+		}
+	}
+
+	return result;
+}
+
+QList<DvbSharedEpgEntry> DvbEpgModel::getEntries(const DvbSharedChannel &channel) const
+{
+	ConstIterator it = channelEntries.constFind(channel);
+
+	if (it == channelEntries.constEnd()) {
+		return QList<DvbSharedEpgEntry>();
+	}
+
+	return it->entries.toList();
+}
+
+QList<DvbSharedEpgEntry> DvbEpgModel::getEntries(const DvbSharedChannel &channel,
+	const QDateTime &begin, const QDateTime &end) const
+{
+	QList<DvbSharedEpgEntry> result;
+	ConstIterator it = channelEntries.constFind(channel);
+
+	if (it == channelEntries.constEnd()) {
+		return result;
+	}
+
+	// entries which begin earlier than 'begin - maxDuration' have ended before 'begin'
+
+	const QVector<DvbSharedEpgEntry> &entries = it->entries;
+
+	for (QVector<DvbSharedEpgEntry>::ConstIterator entryIt = qLowerBound(entries.constBegin(),
+	     entries.constEnd(), begin.addSecs(-it->maxDuration), DvbEpgEntryBeginLessThan());
+	     entryIt != entries.constEnd(); ++entryIt) {
+		const DvbSharedEpgEntry &entry = *entryIt;
+
+		if (entry->begin >= end) {
+			break;
+		}
+
+		if (entry->end > begin) {
+			result.append(entry);
+		}
+	}
+
+	return result;
 }
 
 QHash<DvbSharedChannel, int> DvbEpgModel::getEpgChannels() const
 {
-	return epgChannels;
+	QHash<DvbSharedChannel, int> result;
+
+	for (ConstIterator it = channelEntries.constBegin(); it != channelEntries.constEnd(); ++it) {
+		result.insert(it.key(), it->entries.size());
+	}
+
+	return result;
 }
 
 QList<DvbSharedEpgEntry> DvbEpgModel::getCurrentNext(const DvbSharedChannel &channel) const
 {
 	QList<DvbSharedEpgEntry> result;
-	DvbEpgEntry fakeEntry(channel);
+	ConstIterator it = channelEntries.constFind(channel);
 
-	for (ConstIterator it = entries.lowerBound(DvbEpgEntryId(&fakeEntry));
-	     it != entries.constEnd(); ++it) {
-		const DvbSharedEpgEntry &entry = *it;
+	if (it == channelEntries.constEnd()) {
+		return result;
+	}
 
-		if (entry->channel != channel) {
-			break;
+	QDateTime now = QDateTime::currentDateTime().toUTC();
+	const QVector<DvbSharedEpgEntry> &entries = it->entries;
+
+	for (QVector<DvbSharedEpgEntry>::ConstIterator entryIt = qLowerBound(entries.constBegin(),
+	     entries.constEnd(), now.addSecs(-it->maxDuration), DvbEpgEntryBeginLessThan());
+	     entryIt != entries.constEnd(); ++entryIt) {
+		const DvbSharedEpgEntry &entry = *entryIt;
+
+		if (entry->end <= now) {
+			continue;
 		}
 
 		result.append(entry);
@@ -220,6 +191,84 @@ QList<DvbSharedEpgEntry> DvbEpgModel::getCurrentNext(const DvbSharedChannel &cha
 	return result;
 }
 
+bool DvbEpgModel::findEntryCandidates(const QString &text,
+	QList<DvbSharedEpgEntry> &candidates) const
+{
+	return textIndex.findCandidates(text, candidates);
+}
+
+bool DvbEpgModel::updateEitSectionVersion(const DvbSharedChannel &channel, int section,
+	int version)
+{
+	QHash<int, int> &versions = eitSectionVersions[channel];
+	QHash<int, int>::Iterator it = versions.find(section);
+
+	if (it == versions.end()) {
+		// the known entries may be older, but don't decode everything once per session
+		versions.insert(section, version);
+		return false;
+	}
+
+	if (*it == version) {
+		return false;
+	}
+
+	*it = version;
+	return true;
+}
+
+bool DvbEpgModel::isNewEntry(const DvbEpgEntry &entry, bool checkText) const
+{
+	if (entry.begin.addSecs(QTime().secsTo(entry.duration)) <= currentDateTimeUtc) {
+		return false;
+	}
+
+	if ((entry.eventId >= 0) &&
+	    decodingEvents.contains(qMakePair(entry.channel.constData(), entry.eventId))) {
+		return false;
+	}
+
+	if (checkText) {
+		// addEntry() applies the changes
+		return true;
+	}
+
+	ConstIterator it = channelEntries.constFind(entry.channel);
+
+	if (it == channelEntries.constEnd()) {
+		return true;
+	}
+
+	if (entry.eventId >= 0) {
+		DvbSharedEpgEntry existingEntry = it->eventIds.value(entry.eventId);
+
+		if (existingEntry.isValid()) {
+			// the event may have been rescheduled
+			return ((existingEntry->begin != entry.begin) ||
+				(existingEntry->duration != entry.duration));
+		}
+	}
+
+	const QVector<DvbSharedEpgEntry> &entries = it->entries;
+
+	for (QVector<DvbSharedEpgEntry>::ConstIterator entryIt = qLowerBound(entries.constBegin(),
+	     entries.constEnd(), entry.begin, DvbEpgEntryBeginLessThan());
+	     entryIt != entries.constEnd(); ++entryIt) {
+		const DvbSharedEpgEntry &existingEntry = *entryIt;
+
+		if (existingEntry->begin != entry.begin) {
+			break;
+		}
+
+		if ((existingEntry->duration == entry.duration) &&
+		    ((existingEntry->eventId < 0) || (entry.eventId < 0))) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
 DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 {
 	if (!entry.validate()) {
@@ -233,44 +282,140 @@ DvbSharedEpgEntry DvbEpgModel::addEntry(const DvbEpgEntry &entry)
 	}
 
 	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
+	int duration = QTime().secsTo(entry.duration);
 
-	if (entry.begin.addSecs(QTime().secsTo(entry.duration)) > currentDateTimeUtc) {
-		DvbSharedEpgEntry existingEntry = entries.value(DvbEpgEntryId(&entry));
+	if (entry.begin.addSecs(duration) <= currentDateTimeUtc) {
+		return DvbSharedEpgEntry();
+	}
 
-		if (existingEntry.isValid()) {
-			if (existingEntry->details.isEmpty() && !entry.details.isEmpty()) {
-				// needed for atsc
-				emit entryAboutToBeUpdated(existingEntry);
-				const_cast<DvbEpgEntry *>(existingEntry.constData())->details =
-					entry.details;
-				emit entryUpdated(existingEntry);
+	Iterator it = channelEntries.find(entry.channel);
+	bool newChannel = (it == channelEntries.end());
+
+	if (!newChannel) {
+		int index = findEntry(*it, entry);
+
+		if (index >= 0) {
+			DvbSharedEpgEntry existingEntry = it->entries.at(index);
+
+			if (replayingRecords && liveEntries.contains(existingEntry.constData())) {
+				return existingEntry;
 			}
 
-			return existingEntry;
-		}
+			if ((existingEntry->begin == entry.begin) &&
+			    (existingEntry->duration == entry.duration)) {
+				bool changed = false;
+
+				// a new eit version may correct the text; empty details don't
+				// replace the existing ones (atsc sends them separately)
+				if ((existingEntry->title != entry.title) ||
+				    (existingEntry->subheading != entry.subheading) ||
+				    (!entry.details.isEmpty() &&
+				     (existingEntry->details != entry.details))) {
+					// the entry may still be in the batch
+					flushBatch();
+					emit entryAboutToBeUpdated(existingEntry);
+					textIndex.remove(existingEntry);
+					DvbEpgEntry *existingEntryData =
+						const_cast<DvbEpgEntry *>(existingEntry.constData());
+					existingEntryData->title = entry.title;
+					existingEntryData->subheading = entry.subheading;
+
+					if (!entry.details.isEmpty()) {
+						existingEntryData->details = entry.details;
+					}
+
+					textIndex.insert(existingEntry);
+					emit entryUpdated(existingEntry);
+					changed = true;
+				}
 
-		DvbSharedEpgEntry newEntry(new DvbEpgEntry(entry));
-		entries.insert(DvbEpgEntryId(newEntry), newEntry);
+				if ((existingEntry->eventId < 0) && (entry.eventId >= 0)) {
+					const_cast<DvbEpgEntry *>(existingEntry.constData())->eventId =
+						entry.eventId;
+					it->eventIds.insert(entry.eventId, existingEntry);
+					changed = true;
+				}
 
-		if (newEntry->recording.isValid()) {
-			recordings.insert(newEntry->recording, newEntry);
-		}
+				if (changed) {
+					// replaying an addition updates the existing entry
+					journalAddition(existingEntry);
+				}
 
-		if (++epgChannels[newEntry->channel] == 1) {
-			emit epgChannelAdded(newEntry->channel);
+				return existingEntry;
+			}
+
+			// the event has been rescheduled
+			journalRemoval(existingEntry);
+			removeEntry(it, index);
 		}
+	} else {
+		it = channelEntries.insert(entry.channel, DvbEpgChannelEntries());
+	}
+
+	DvbEpgEntry *newEntryData = new DvbEpgEntry(entry);
+	newEntryData->end = entry.begin.addSecs(duration);
+	DvbSharedEpgEntry newEntry(newEntryData);
+	++entryCount;
+
+	if (!replayingRecords && loading) {
+		liveEntries.insert(newEntryData);
+	}
+
+	it->entries.insert(qUpperBound(it->entries.begin(), it->entries.end(), newEntry->begin,
+		DvbEpgEntryBeginLessThan()), newEntry);
+
+	if (newEntry->eventId >= 0) {
+		it->eventIds.insert(newEntry->eventId, newEntry);
+	}
 
+	if (it->maxDuration < duration) {
+		it->maxDuration = duration;
+	}
+
+	expiryHeap.insert(newEntry);
+	textIndex.insert(newEntry);
+
+	if (newEntry->recording.isValid()) {
+		recordings.insert(newEntry->recording, newEntry);
+	}
+
+	if (newChannel) {
+		emit epgChannelAdded(newEntry->channel);
+	}
+
+	journalAddition(newEntry);
+
+	if (batchingEntries) {
+		addedEntries.append(newEntry);
+	} else {
 		emit entryAdded(newEntry);
-		return newEntry;
 	}
 
-	return DvbSharedEpgEntry();
+	return newEntry;
+}
+
+void DvbEpgModel::addEitEntries(const char *data, int size, const QVector<int> &eventIndexes,
+	const QVector<DvbEpgEntry> &entries)
+{
+	foreach (const DvbEpgEntry &entry, entries) {
+		if (entry.eventId >= 0) {
+			decodingEvents.insert(qMakePair(entry.channel.constData(), entry.eventId));
+		}
+	}
+
+	decoder->decode(data, size, eventIndexes, entries);
 }
 
 void DvbEpgModel::scheduleProgram(const DvbSharedEpgEntry &entry, int extraSecondsBefore,
-	int extraSecondsAfter, bool checkForRecursion, int priority)
+	int extraSecondsAfter, bool checkForRecursion, int priority, const QString &streams)
 {
-	if (!entry.isValid() || (entries.value(DvbEpgEntryId(entry)) != entry)) {
+	ConstIterator it;
+
+	if (entry.isValid()) {
+		it = channelEntries.constFind(entry->channel);
+	}
+
+	if (!entry.isValid() || (it == channelEntries.constEnd()) || (indexOf(*it, entry) < 0)) {
 		Log("DvbEpgModel::scheduleProgram: invalid entry");
 		return;
 	}
@@ -287,6 +432,7 @@ void DvbEpgModel::scheduleProgram(const DvbSharedEpgEntry &entry, int extraSecon
 	if (!entry->recording.isValid()) {
 		DvbRecording recording;
 		recording.priority = priority;
+		recording.streams = streams;
 		recording.name = entry->title;
 		recording.channel = entry->channel;
 		recording.begin = entry->begin.addSecs(-extraSecondsBefore);
@@ -308,6 +454,8 @@ void DvbEpgModel::scheduleProgram(const DvbSharedEpgEntry &entry, int extraSecon
 		const_cast<DvbEpgEntry *>(entry.constData())->recording = DvbSharedRecording();
 	}
 
+	journalRemoval(entry);
+	journalAddition(entry);
 	emit entryUpdated(entry);
 
 	if (oldRecording.isValid()) {
@@ -388,87 +536,604 @@ void DvbEpgModel::channelUpdated(const DvbSharedChannel &channel)
 	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
 
 	if (DvbChannelId(channel) != DvbChannelId(&updatingChannel)) {
-		DvbEpgEntry fakeEntry(channel);
-		Iterator it = entries.lowerBound(DvbEpgEntryId(&fakeEntry));
+		removeChannel(channel);
+	}
+}
+
+void DvbEpgModel::channelRemoved(const DvbSharedChannel &channel)
+{
+	if (hasPendingOperation) {
+		Log("DvbEpgModel::channelRemoved: illegal recursive call");
+		return;
+	}
+
+	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
+	removeChannel(channel);
+}
+
+void DvbEpgModel::recordingRemoved(const DvbSharedRecording &recording)
+{
+	if (hasPendingOperation) {
+		Log("DvbEpgModel::recordingRemoved: illegal recursive call");
+		return;
+	}
+
+	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
+	DvbSharedEpgEntry entry = recordings.take(recording);
+
+	if (entry.isValid()) {
+		emit entryAboutToBeUpdated(entry);
+		const_cast<DvbEpgEntry *>(entry.constData())->recording = DvbSharedRecording();
+		journalRemoval(entry);
+		journalAddition(entry);
+		emit entryUpdated(entry);
+	}
+}
+
+void DvbEpgModel::timerEvent(QTimerEvent *event)
+{
+	if (event->timerId() == journalTimerId) {
+		killTimer(journalTimerId);
+		journalTimerId = 0;
+		storage->flush();
+		return;
+	}
+
+	if (hasPendingOperation) {
+		Log("DvbEpgModel::timerEvent: illegal recursive call");
+		return;
+	}
+
+	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
+	currentDateTimeUtc = QDateTime::currentDateTime().toUTC();
+	QList<DvbSharedEpgEntry> expiredEntries;
+	QList<DvbSharedChannel> expiredChannels;
+	DvbSharedEpgEntry entry;
+
+	while (expiryHeap.takeExpired(currentDateTimeUtc, entry)) {
+		Iterator it = channelEntries.find(entry->channel);
+
+		if (it == channelEntries.end()) {
+			continue;
+		}
+
+		int index = indexOf(*it, entry);
+
+		if (index < 0) {
+			// the entry has already been removed
+			continue;
+		}
+
+		expiredEntries.append(takeEntry(it, index));
+
+		if (it->entries.isEmpty()) {
+			expiredChannels.append(it.key());
+			channelEntries.erase(it);
+		}
+	}
+
+	if (expiryHeap.size() > (2 * entryCount + 1024)) {
+		// drop the references to entries which have been removed otherwise
+		rebuildExpiryHeap();
+	}
+
+	if (!expiredEntries.isEmpty()) {
+		emit entriesRemoved(expiredEntries);
+	}
+
+	foreach (const DvbSharedChannel &channel, expiredChannels) {
+		emit epgChannelRemoved(channel);
+	}
+
+	if (!loading && storage->isCompactionNeeded(entryCount)) {
+		compactStorage();
+	}
+}
+
+void DvbEpgModel::customEvent(QEvent *event)
+{
+	if (event->type() == DvbEpgStorage::LoadingEvent) {
+		loadRecords();
+		return;
+	}
+
+	// merge the decoded entries in slices so that the gui stays responsive
+	DvbChannelModel *channelModel = manager->getChannelModel();
+	QElapsedTimer elapsedTimer;
+	elapsedTimer.start();
+	QVector<DvbEpgEntry> entries;
+	batchingEntries = true;
+
+	while (decoder->takeResult(entries)) {
+		if (entries.isEmpty()) {
+			continue;
+		}
+
+		foreach (const DvbEpgEntry &entry, entries) {
+			decodingEvents.remove(qMakePair(entry.channel.constData(), entry.eventId));
+		}
+
+		// the channel may have been removed in the meantime
+		const DvbSharedChannel &channel = entries.at(0).channel;
+
+		if (channelModel->findChannelById(*channel) == channel) {
+			foreach (const DvbEpgEntry &entry, entries) {
+				addEntry(entry);
+			}
+		}
+
+		if (elapsedTimer.elapsed() >= 10) {
+			QCoreApplication::postEvent(this, new QEvent(QEvent::User),
+				Qt::LowEventPriority);
+			break;
+		}
+	}
+
+	batchingEntries = false;
+	flushBatch();
+}
+
+void DvbEpgModel::loadRecords()
+{
+	if (!loading) {
+		return;
+	}
+
+	if (hasPendingOperation) {
+		// try again later
+		QCoreApplication::postEvent(this, new QEvent(QEvent::Type(DvbEpgStorage::LoadingEvent)),
+			Qt::LowEventPriority);
+		return;
+	}
+
+	// the records are decoded by the storage thread; they are merged in slices
+	// so that the gui stays responsive
+	QElapsedTimer elapsedTimer;
+	elapsedTimer.start();
+	QList<DvbEpgRecord> records;
+	replayingRecords = true;
+	batchingEntries = true;
+
+	while (storage->takeRecords(records)) {
+		foreach (const DvbEpgRecord &record, records) {
+			replayRecord(record);
+		}
+
+		if (elapsedTimer.elapsed() >= 10) {
+			QCoreApplication::postEvent(this,
+				new QEvent(QEvent::Type(DvbEpgStorage::LoadingEvent)),
+				Qt::LowEventPriority);
+			break;
+		}
+	}
+
+	replayingRecords = false;
+	batchingEntries = false;
+	flushBatch();
+
+	if (storage->isLoadingFinished()) {
+		loading = false;
+		loadingChannels.clear();
+		liveEntries.clear();
+	}
+}
+
+void DvbEpgModel::replayRecord(const DvbEpgRecord &record)
+{
+	QHash<QString, DvbSharedChannel>::ConstIterator channelIt =
+		loadingChannels.constFind(record.channelName);
+
+	if (channelIt == loadingChannels.constEnd()) {
+		channelIt = loadingChannels.insert(record.channelName,
+			manager->getChannelModel()->findChannelByName(record.channelName));
+	}
+
+	DvbEpgEntry entry(*channelIt);
+	entry.eventId = record.eventId;
+	entry.begin = record.begin;
+	entry.duration = record.duration;
+	entry.title = record.title;
+	entry.subheading = record.subheading;
+	entry.details = record.details;
+
+	if (!entry.validate()) {
+		// the channel doesn't exist anymore
+		return;
+	}
+
+	if (record.type == DvbEpgRecord::Add) {
+		if (record.recordingKey != 0) {
+			entry.recording = manager->getRecordingModel()->findRecordingByKey(
+				SqlKey(record.recordingKey));
+		}
+
+		addEntry(entry);
+		return;
+	}
+
+	// removals only contain the key of the entry
+	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
+	Iterator it = channelEntries.find(entry.channel);
+
+	if (it == channelEntries.end()) {
+		return;
+	}
+
+	int index = findEntry(*it, entry);
+
+	if ((index >= 0) && !liveEntries.contains(it->entries.at(index).constData())) {
+		removeEntry(it, index);
+
+		if (it->entries.isEmpty()) {
+			channelEntries.erase(it);
+			emit epgChannelRemoved(entry.channel);
+		}
+	}
+}
+
+void DvbEpgModel::journalAddition(const DvbSharedEpgEntry &entry)
+{
+	if (!replayingRecords) {
+		storage->append(DvbEpgRecord(DvbEpgRecord::Add, *entry));
+		startJournalTimer();
+	}
+}
+
+void DvbEpgModel::journalRemoval(const DvbSharedEpgEntry &entry)
+{
+	if (!replayingRecords) {
+		storage->append(DvbEpgRecord(DvbEpgRecord::Remove, *entry));
+		startJournalTimer();
+	}
+}
+
+void DvbEpgModel::startJournalTimer()
+{
+	// the journal is flushed shortly after a change (so that little is lost on a crash)
+	if (journalTimerId == 0) {
+		journalTimerId = startTimer(2000);
+	}
+}
+
+void DvbEpgModel::compactStorage()
+{
+	QList<DvbEpgRecord> records;
+	records.reserve(entryCount);
+
+	for (ConstIterator it = channelEntries.constBegin(); it != channelEntries.constEnd(); ++it) {
+		foreach (const DvbSharedEpgEntry &entry, it->entries) {
+			records.append(DvbEpgRecord(DvbEpgRecord::Add, *entry));
+		}
+	}
+
+	storage->compact(records);
+}
+
+int DvbEpgModel::findEntry(const DvbEpgChannelEntries &channelEntries, const DvbEpgEntry &entry)
+{
+	if (entry.eventId >= 0) {
+		DvbSharedEpgEntry existingEntry = channelEntries.eventIds.value(entry.eventId);
+
+		if (existingEntry.isValid()) {
+			return indexOf(channelEntries, existingEntry);
+		}
+	}
+
+	const QVector<DvbSharedEpgEntry> &entries = channelEntries.entries;
+
+	for (int i = (qLowerBound(entries.constBegin(), entries.constEnd(), entry.begin,
+	     DvbEpgEntryBeginLessThan()) - entries.constBegin()); i < entries.size(); ++i) {
+		const DvbSharedEpgEntry &existingEntry = entries.at(i);
+
+		if (existingEntry->begin != entry.begin) {
+			break;
+		}
+
+		if ((existingEntry->eventId >= 0) && (entry.eventId >= 0)) {
+			// different events
+			continue;
+		}
+
+		if ((existingEntry->duration == entry.duration) &&
+		    (existingEntry->title == entry.title) &&
+		    (existingEntry->subheading == entry.subheading) &&
+		    (existingEntry->details.isEmpty() || entry.details.isEmpty() ||
+		     (existingEntry->details == entry.details))) {
+			return i;
+		}
+	}
+
+	return -1;
+}
+
+int DvbEpgModel::indexOf(const DvbEpgChannelEntries &channelEntries,
+	const DvbSharedEpgEntry &entry)
+{
+	const QVector<DvbSharedEpgEntry> &entries = channelEntries.entries;
+
+	for (int i = (qLowerBound(entries.constBegin(), entries.constEnd(), entry->begin,
+	     DvbEpgEntryBeginLessThan()) - entries.constBegin()); i < entries.size(); ++i) {
+		const DvbSharedEpgEntry &existingEntry = entries.at(i);
+
+		if (existingEntry == entry) {
+			return i;
+		}
+
+		if (existingEntry->begin != entry->begin) {
+			break;
+		}
+	}
+
+	return -1;
+}
+
+void DvbEpgModel::removeEntry(Iterator it, int index)
+{
+	DvbSharedEpgEntry entry = takeEntry(it, index);
+
+	if (batchingEntries) {
+		removedEntries.append(entry);
+	} else {
+		emit entryRemoved(entry);
+	}
+}
+
+DvbSharedEpgEntry DvbEpgModel::takeEntry(Iterator it, int index)
+{
+	DvbSharedEpgEntry entry = it->entries.at(index);
+	it->entries.remove(index);
+	--entryCount;
+	liveEntries.remove(entry.constData());
+
+	if ((entry->eventId >= 0) && (it->eventIds.value(entry->eventId) == entry)) {
+		it->eventIds.remove(entry->eventId);
+	}
+
+	if (entry->recording.isValid()) {
+		recordings.remove(entry->recording);
+	}
+
+	textIndex.remove(entry);
+	return entry;
+}
+
+void DvbEpgModel::rebuildExpiryHeap()
+{
+	QVector<DvbSharedEpgEntry> currentEntries;
+	currentEntries.reserve(entryCount);
+
+	for (ConstIterator it = channelEntries.constBegin(); it != channelEntries.constEnd(); ++it) {
+		currentEntries += it->entries;
+	}
+
+	expiryHeap.rebuild(currentEntries);
+}
+
+void DvbEpgModel::removeChannel(const DvbSharedChannel &channel)
+{
+	eitSectionVersions.remove(channel);
+	Iterator it = channelEntries.find(channel);
+
+	if (it == channelEntries.end()) {
+		return;
+	}
+
+	QList<DvbSharedEpgEntry> entries;
+
+	while (!it->entries.isEmpty()) {
+		journalRemoval(it->entries.last());
+		entries.append(takeEntry(it, it->entries.size() - 1));
+	}
+
+	channelEntries.erase(it);
+	flushBatch();
+
+	if (!entries.isEmpty()) {
+		emit entriesRemoved(entries);
+	}
+
+	emit epgChannelRemoved(channel);
+}
+
+void DvbEpgModel::flushBatch()
+{
+	if (!addedEntries.isEmpty()) {
+		QList<DvbSharedEpgEntry> entries = addedEntries;
+		addedEntries.clear();
+		emit entriesAdded(entries);
+	}
+
+	if (!removedEntries.isEmpty()) {
+		QList<DvbSharedEpgEntry> entries = removedEntries;
+		removedEntries.clear();
+		emit entriesRemoved(entries);
+	}
+}
+
+void DvbEpgTextIndex::insert(const DvbSharedEpgEntry &entry)
+{
+	QSet<QString> words;
+	tokenize(entry->title, words);
+	tokenize(entry->subheading, words);
+	tokenize(entry->details, words);
+
+	foreach (const QString &word, words) {
+		postings[word].append(entry.constData());
+	}
+
+	postingCount += words.size();
+	entries.insert(entry.constData(), entry);
+}
+
+void DvbEpgTextIndex::remove(const DvbSharedEpgEntry &entry)
+{
+	if (entries.remove(entry.constData()) == 0) {
+		return;
+	}
+
+	QSet<QString> words;
+	tokenize(entry->title, words);
+	tokenize(entry->subheading, words);
+	tokenize(entry->details, words);
+	deadPostingCount += words.size();
+
+	if ((deadPostingCount > 4096) && ((2 * deadPostingCount) > postingCount)) {
+		rebuild();
+	}
+}
+
+bool DvbEpgTextIndex::findCandidates(const QString &text,
+	QList<DvbSharedEpgEntry> &candidates) const
+{
+	// a word of 'text' which is preceded by a separator is the beginning of a word in
+	// the entry too (and a complete word if it's also followed by a separator)
+
+	QString foldedText = text.toCaseFolded();
+	QSet<const DvbEpgEntry *> result;
+	bool hasResult = false;
+	QString firstWord;
+	bool firstWordComplete = false;
+	int begin = -1;
+
+	for (int i = 0; i <= foldedText.size(); ++i) {
+		if ((i < foldedText.size()) && foldedText.at(i).isLetterOrNumber()) {
+			if (begin < 0) {
+				begin = i;
+			}
+
+			continue;
+		}
+
+		if (begin < 0) {
+			continue;
+		}
+
+		QString word = foldedText.mid(begin, i - begin);
+		bool complete = (i < foldedText.size());
+
+		if (begin == 0) {
+			firstWord = word;
+			firstWordComplete = complete;
+			begin = -1;
+			continue;
+		}
+
+		begin = -1;
+		QSet<const DvbEpgEntry *> matches;
+
+		for (QMap<QString, QVector<const DvbEpgEntry *> >::ConstIterator it =
+		     postings.lowerBound(word); it != postings.constEnd(); ++it) {
+			if (!it.key().startsWith(word)) {
+				break;
+			}
+
+			if (!complete || (it.key().size() == word.size())) {
+				foreach (const DvbEpgEntry *entry, *it) {
+					matches.insert(entry);
+				}
+			}
+		}
 
-		while ((ConstIterator(it) != entries.constEnd()) && ((*it)->channel == channel)) {
-			it = removeEntry(it);
+		if (hasResult) {
+			result.intersect(matches);
+		} else {
+			result = matches;
+			hasResult = true;
 		}
-	}
-}
 
-void DvbEpgModel::channelRemoved(const DvbSharedChannel &channel)
-{
-	if (hasPendingOperation) {
-		Log("DvbEpgModel::channelRemoved: illegal recursive call");
-		return;
+		if (result.isEmpty()) {
+			break;
+		}
 	}
 
-	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
-	DvbEpgEntry fakeEntry(channel);
-	Iterator it = entries.lowerBound(DvbEpgEntryId(&fakeEntry));
+	if (!hasResult) {
+		if (firstWord.isEmpty()) {
+			return false;
+		}
 
-	while ((ConstIterator(it) != entries.constEnd()) && ((*it)->channel == channel)) {
-		it = removeEntry(it);
-	}
-}
+		// the first word may be the end (or a part) of a word in the entry;
+		// this is slower, but it's still only a scan over the distinct words
 
-void DvbEpgModel::recordingRemoved(const DvbSharedRecording &recording)
-{
-	if (hasPendingOperation) {
-		Log("DvbEpgModel::recordingRemoved: illegal recursive call");
-		return;
+		for (QMap<QString, QVector<const DvbEpgEntry *> >::ConstIterator it =
+		     postings.constBegin(); it != postings.constEnd(); ++it) {
+			if (firstWordComplete ? it.key().endsWith(firstWord) :
+			    it.key().contains(firstWord)) {
+				foreach (const DvbEpgEntry *entry, *it) {
+					result.insert(entry);
+				}
+			}
+		}
 	}
 
-	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
-	DvbSharedEpgEntry entry = recordings.take(recording);
+	foreach (const DvbEpgEntry *entry, result) {
+		// dead postings are skipped here
+		DvbSharedEpgEntry candidate = entries.value(entry);
 
-	if (entry.isValid()) {
-		emit entryAboutToBeUpdated(entry);
-		const_cast<DvbEpgEntry *>(entry.constData())->recording = DvbSharedRecording();
-		emit entryUpdated(entry);
+		if (candidate.isValid()) {
+			candidates.append(candidate);
+		}
 	}
+
+	return true;
 }
 
-void DvbEpgModel::timerEvent(QTimerEvent *event)
+void DvbEpgTextIndex::tokenize(const QString &text, QSet<QString> &words)
 {
-	Q_UNUSED(event)
+	QString foldedText = text.toCaseFolded();
+	int begin = -1;
 
-	if (hasPendingOperation) {
-		Log("DvbEpgModel::timerEvent: illegal recursive call");
-		return;
+	for (int i = 0; i <= foldedText.size(); ++i) {
+		if ((i < foldedText.size()) && foldedText.at(i).isLetterOrNumber()) {
+			if (begin < 0) {
+				begin = i;
+			}
+		} else if (begin >= 0) {
+			words.insert(foldedText.mid(begin, i - begin));
+			begin = -1;
+		}
 	}
+}
 
-	EnsureNoPendingOperation ensureNoPendingOperation(hasPendingOperation);
-	currentDateTimeUtc = QDateTime::currentDateTime().toUTC();
-	Iterator it = entries.begin();
-
-	while (ConstIterator(it) != entries.constEnd()) {
-		const DvbSharedEpgEntry &entry = *it;
-
-		if (entry->begin.addSecs(QTime().secsTo(entry->duration)) > currentDateTimeUtc) {
-			++it;
-		} else {
-			it = removeEntry(it);
-		}
+void DvbEpgTextIndex::rebuild()
+{
+	QHash<const DvbEpgEntry *, DvbSharedEpgEntry> oldEntries = entries;
+	postings.clear();
+	entries.clear();
+	postingCount = 0;
+	deadPostingCount = 0;
+
+	foreach (const DvbSharedEpgEntry &entry, oldEntries) {
+		insert(entry);
 	}
 }
 
-DvbEpgModel::Iterator DvbEpgModel::removeEntry(Iterator it)
+void DvbEpgExpiryHeap::insert(const DvbSharedEpgEntry &entry)
 {
-	const DvbSharedEpgEntry &entry = *it;
+	entries.append(entry);
+	std::push_heap(entries.begin(), entries.end(), endGreaterThan);
+}
 
-	if (entry->recording.isValid()) {
-		recordings.remove(entry->recording);
+bool DvbEpgExpiryHeap::takeExpired(const QDateTime &dateTime, DvbSharedEpgEntry &entry)
+{
+	if (entries.isEmpty() || (entries.first()->end > dateTime)) {
+		return false;
 	}
 
-	if (--epgChannels[entry->channel] == 0) {
-		epgChannels.remove(entry->channel);
-		emit epgChannelRemoved(entry->channel);
-	}
+	std::pop_heap(entries.begin(), entries.end(), endGreaterThan);
+	entry = entries.last();
+	entries.removeLast();
+	return true;
+}
 
-	emit entryRemoved(entry);
-	return entries.erase(it);
+void DvbEpgExpiryHeap::rebuild(const QVector<DvbSharedEpgEntry> &currentEntries)
+{
+	entries = currentEntries;
+	std::make_heap(entries.begin(), entries.end(), endGreaterThan);
+}
+
+bool DvbEpgExpiryHeap::endGreaterThan(const DvbSharedEpgEntry &x, const DvbSharedEpgEntry &y)
+{
+	return (x->end > y->end);
 }
 
 DvbEpgFilter::DvbEpgFilter(DvbManager *manager, DvbDevice *device_,
@@ -524,13 +1189,49 @@ void DvbEpgFilter::processSection(const char *data, int size)
 		return;
 	}
 
+	bool checkText = epgModel->updateEitSectionVersion(channel,
+		(tableId << 8) | eitSection.sectionNumber(), eitSection.versionNumber());
+	QVector<int> eventIndexes;
+	QVector<DvbEpgEntry> epgEntries;
+	int eventIndex = 0;
+
 	for (DvbEitSectionEntry entry = eitSection.entries(); entry.isValid(); entry.advance()) {
 		DvbEpgEntry epgEntry;
 		epgEntry.channel = channel;
+		epgEntry.eventId = entry.eventId();
 		epgEntry.begin = QDateTime(QDate::fromJulianDay(entry.startDate() + 2400001),
 			bcdToTime(entry.startTime()), Qt::UTC);
 		epgEntry.duration = bcdToTime(entry.duration());
 
+		// almost all sections are retransmissions; don't decode their text
+
+		if (epgModel->isNewEntry(epgEntry, checkText)) {
+			eventIndexes.append(eventIndex);
+			epgEntries.append(epgEntry);
+		}
+
+		++eventIndex;
+	}
+
+	if (!epgEntries.isEmpty()) {
+		epgModel->addEitEntries(data, size, eventIndexes, epgEntries);
+	}
+}
+
+void DvbEpgDecodeJob::run()
+{
+	DvbEitSection eitSection(section.constData(), section.size());
+	int eventIndex = 0;
+	int index = 0;
+
+	for (DvbEitSectionEntry entry = eitSection.entries();
+	     entry.isValid() && (index < eventIndexes.size()); entry.advance()) {
+		if (eventIndexes.at(index) != eventIndex++) {
+			continue;
+		}
+
+		DvbEpgEntry &epgEntry = entries[index++];
+
 		for (DvbDescriptor descriptor = entry.descriptors(); descriptor.isValid();
 		     descriptor.advance()) {
 			switch (descriptor.descriptorTag()) {
@@ -557,8 +1258,56 @@ void DvbEpgFilter::processSection(const char *data, int size)
 			    }
 			}
 		}
+	}
+
+	decoder->jobFinished(sequenceNumber, entries);
+}
+
+DvbEpgDecoder::DvbEpgDecoder(QObject *receiver_) : receiver(receiver_), nextSequenceNumber(0),
+	nextResult(0), eventPending(false)
+{
+}
+
+DvbEpgDecoder::~DvbEpgDecoder()
+{
+	threadPool.waitForDone();
+}
 
-		epgModel->addEntry(epgEntry);
+void DvbEpgDecoder::decode(const char *data, int size, const QVector<int> &eventIndexes,
+	const QVector<DvbEpgEntry> &entries)
+{
+	DvbEpgDecodeJob *job = new DvbEpgDecodeJob(this, nextSequenceNumber++);
+	job->section = QByteArray(data, size);
+	job->eventIndexes = eventIndexes;
+	job->entries = entries;
+	threadPool.start(job);
+}
+
+bool DvbEpgDecoder::takeResult(QVector<DvbEpgEntry> &entries)
+{
+	QMutexLocker locker(&mutex);
+	QMap<qint64, QVector<DvbEpgEntry> >::Iterator it = results.find(nextResult);
+
+	if (it == results.end()) {
+		eventPending = false;
+		return false;
+	}
+
+	entries = *it;
+	results.erase(it);
+	++nextResult;
+	return true;
+}
+
+void DvbEpgDecoder::jobFinished(qint64 sequenceNumber, const QVector<DvbEpgEntry> &entries)
+{
+	QMutexLocker locker(&mutex);
+	results.insert(sequenceNumber, entries);
+
+	if (!eventPending && (sequenceNumber == nextResult)) {
+		eventPending = true;
+		QCoreApplication::postEvent(receiver, new QEvent(QEvent::User),
+			Qt::LowEventPriority);
 	}
 }
 
@@ -759,3 +1508,446 @@ void AtscEpgFilter::processEttSection(const char *data, int size)
 		}
 	}
 }
+
+DvbEpgRecord::DvbEpgRecord(Type type_, const DvbEpgEntry &entry) : type(type_),
+	channelName(entry.channel->name), eventId(entry.eventId), begin(entry.begin),
+	duration(entry.duration), title(entry.title), subheading(entry.subheading),
+	details(entry.details), recordingKey(0)
+{
+	if (entry.recording.isValid()) {
+		recordingKey = entry.recording->sqlKey;
+	}
+}
+
+static const int epgSnapshotVersion = 0x2c57a94e;
+static const int epgJournalV1Version = 0x5e1d0b37;
+static const int epgJournalVersion = 0x5e1d0b38;
+
+void DvbEpgCompactionThread::start(const QString &fileName_,
+	const QStringList &obsoleteFileNames_, const QList<DvbEpgRecord> &records_)
+{
+	fileName = fileName_;
+	obsoleteFileNames = obsoleteFileNames_;
+	records = records_;
+	QThread::start(QThread::LowPriority);
+}
+
+void DvbEpgCompactionThread::run()
+{
+	QSaveFile file(fileName);
+
+	if (!file.open(QIODevice::WriteOnly)) {
+		Log("DvbEpgCompactionThread::run: cannot open") << fileName;
+		records.clear();
+		return;
+	}
+
+	QStringList channelNames;
+	QHash<QString, int> channelIndexes;
+
+	foreach (const DvbEpgRecord &record, records) {
+		if (!channelIndexes.contains(record.channelName)) {
+			channelIndexes.insert(record.channelName, channelNames.size());
+			channelNames.append(record.channelName);
+		}
+	}
+
+	QDataStream stream(&file);
+	stream.setVersion(QDataStream::Qt_4_4);
+	stream << epgSnapshotVersion;
+	stream << channelNames;
+
+	foreach (const DvbEpgRecord &record, records) {
+		stream << qint32(channelIndexes.value(record.channelName));
+		stream << qint32(record.eventId);
+		stream << record.begin;
+		stream << record.duration;
+		stream << record.title;
+		stream << record.subheading;
+		stream << record.details;
+		stream << record.recordingKey;
+	}
+
+	records.clear();
+
+	if ((stream.status() != QDataStream::Ok) || !file.commit()) {
+		Log("DvbEpgCompactionThread::run: cannot write") << fileName;
+		return;
+	}
+
+	foreach (const QString &obsoleteFileName, obsoleteFileNames) {
+		QFile::remove(obsoleteFileName);
+	}
+}
+
+void DvbEpgLoadingThread::run()
+{
+	storage->loadRecords();
+}
+
+DvbEpgStorage::DvbEpgStorage() : journalNumber(0), readFormat(Snapshot),
+	journalRecordCount(0), readJournalRecordCount(0), hasLegacySnapshot(false),
+	loadingThread(this), loadingReceiver(NULL), loadingFinished(false),
+	loadingEventPending(false), stopLoading(false)
+{
+	dataDirectory = QStandardPaths::writableLocation(QStandardPaths::DataLocation);
+	snapshotName = dataDirectory + QLatin1String("/epgdata.dvb");
+	QDir().mkpath(dataDirectory);
+
+	if (QFile::exists(snapshotName)) {
+		pendingFiles.append(snapshotName);
+	}
+
+	// the journals are named epgjournal-<number>.dvb
+	QMap<int, QString> journals;
+
+	foreach (const QString &fileName, QDir(dataDirectory).entryList(
+		 QStringList(QLatin1String("epgjournal-*.dvb")), QDir::Files)) {
+		bool ok;
+		int number = fileName.mid(11, fileName.size() - 15).toInt(&ok);
+
+		if (ok) {
+			journals.insert(number, dataDirectory + QLatin1Char('/') + fileName);
+			journalNumber = qMax(journalNumber, number);
+		}
+	}
+
+	journalNames = journals.values();
+	pendingFiles.append(journalNames);
+
+	// the new journal only contains the changes of this session
+	++journalNumber;
+	openJournal();
+}
+
+DvbEpgStorage::~DvbEpgStorage()
+{
+	{
+		QMutexLocker locker(&loadingMutex);
+		stopLoading = true;
+		loadingCondition.wakeAll();
+	}
+
+	loadingThread.wait();
+	compactionThread.wait();
+	closeFile();
+
+	if (journalFile.isOpen()) {
+		if (journalFile.size() <= qint64(sizeof(qint32))) {
+			journalFile.remove();
+		} else {
+			journalFile.close();
+		}
+	}
+}
+
+void DvbEpgStorage::startLoading(QObject *receiver)
+{
+	loadingReceiver = receiver;
+	loadingThread.start(QThread::LowPriority);
+}
+
+bool DvbEpgStorage::takeRecords(QList<DvbEpgRecord> &records)
+{
+	QMutexLocker locker(&loadingMutex);
+
+	if (loadedRecords.isEmpty()) {
+		loadingEventPending = false;
+		return false;
+	}
+
+	records = loadedRecords.takeFirst();
+	loadingCondition.wakeAll();
+	return true;
+}
+
+bool DvbEpgStorage::isLoadingFinished()
+{
+	{
+		QMutexLocker locker(&loadingMutex);
+
+		if (!loadingFinished || !loadedRecords.isEmpty()) {
+			return false;
+		}
+	}
+
+	loadingThread.wait();
+	journalRecordCount += readJournalRecordCount;
+	readJournalRecordCount = 0;
+	return true;
+}
+
+void DvbEpgStorage::loadRecords()
+{
+	bool finished = false;
+
+	while (!finished) {
+		QList<DvbEpgRecord> records;
+		finished = !readRecords(records, 1000);
+		QMutexLocker locker(&loadingMutex);
+
+		// limits the memory used by records which haven't been taken yet
+		while (!stopLoading && (loadedRecords.size() >= 4)) {
+			loadingCondition.wait(&loadingMutex);
+		}
+
+		if (stopLoading) {
+			break;
+		}
+
+		if (!records.isEmpty()) {
+			loadedRecords.append(records);
+		}
+
+		loadingFinished = finished;
+
+		if (!loadingEventPending) {
+			loadingEventPending = true;
+			QCoreApplication::postEvent(loadingReceiver,
+				new QEvent(QEvent::Type(LoadingEvent)), Qt::LowEventPriority);
+		}
+	}
+
+	closeFile();
+}
+
+bool DvbEpgStorage::readRecords(QList<DvbEpgRecord> &records, int maxCount)
+{
+	while (records.size() < maxCount) {
+		if (!readFile.isOpen() && !openNextFile()) {
+			return false;
+		}
+
+		if (readStream.atEnd()) {
+			closeFile();
+			continue;
+		}
+
+		DvbEpgRecord record;
+
+		switch (readFormat) {
+		case SnapshotV1:
+		case SnapshotV2:
+			readStream >> record.channelName;
+			readStream >> record.begin;
+			readStream >> record.duration;
+			readStream >> record.title;
+			readStream >> record.subheading;
+			readStream >> record.details;
+
+			if (readFormat == SnapshotV2) {
+				readStream >> record.recordingKey;
+			}
+
+			break;
+		case Snapshot: {
+			qint32 channelIndex;
+			qint32 eventId;
+			readStream >> channelIndex;
+			readStream >> eventId;
+			readStream >> record.begin;
+			readStream >> record.duration;
+			readStream >> record.title;
+			readStream >> record.subheading;
+			readStream >> record.details;
+			readStream >> record.recordingKey;
+			record.channelName = channelNames.value(channelIndex);
+			record.eventId = eventId;
+			break;
+		    }
+		case JournalV1:
+		case Journal: {
+			quint8 type;
+			qint32 eventId;
+			readStream >> type;
+			readStream >> record.channelName;
+			readStream >> eventId;
+			readStream >> record.begin;
+			readStream >> record.duration;
+			record.type = ((type == DvbEpgRecord::Remove) ? DvbEpgRecord::Remove :
+				DvbEpgRecord::Add);
+			record.eventId = eventId;
+
+			if ((readFormat == JournalV1) || (record.type == DvbEpgRecord::Add)) {
+				readStream >> record.title;
+				readStream >> record.subheading;
+				readStream >> record.details;
+				readStream >> record.recordingKey;
+			} else if (record.eventId < 0) {
+				readStream >> record.title;
+				readStream >> record.subheading;
+			}
+
+			++readJournalRecordCount;
+			break;
+		    }
+		}
+
+		if (readStream.status() != QDataStream::Ok) {
+			// a journal may be truncated if kaffeine wasn't shut down properly
+			Log("DvbEpgStorage::readRecords: corrupt data") << readFile.fileName();
+			closeFile();
+			continue;
+		}
+
+		record.begin = record.begin.toUTC();
+		records.append(record);
+	}
+
+	return true;
+}
+
+void DvbEpgStorage::append(const DvbEpgRecord &record)
+{
+	if (!journalFile.isOpen()) {
+		return;
+	}
+
+	journalStream << quint8(record.type);
+	journalStream << record.channelName;
+	journalStream << qint32(record.eventId);
+	journalStream << record.begin;
+	journalStream << record.duration;
+
+	if (record.type == DvbEpgRecord::Add) {
+		journalStream << record.title;
+		journalStream << record.subheading;
+		journalStream << record.details;
+		journalStream << record.recordingKey;
+	} else if (record.eventId < 0) {
+		// the entry can only be found by its title (see DvbEpgModel::findEntry())
+		journalStream << record.title;
+		journalStream << record.subheading;
+	}
+
+	++journalRecordCount;
+}
+
+void DvbEpgStorage::flush()
+{
+	if (journalFile.isOpen()) {
+		journalFile.flush();
+	}
+}
+
+bool DvbEpgStorage::isCompactionNeeded(int entryCount) const
+{
+	if (compactionThread.isRunning()) {
+		return false;
+	}
+
+	return (hasLegacySnapshot || (journalNames.size() > 16) ||
+		(journalRecordCount > qMax(entryCount, 4096)));
+}
+
+void DvbEpgStorage::compact(const QList<DvbEpgRecord> &records)
+{
+	if (compactionThread.isRunning()) {
+		Log("DvbEpgStorage::compact: compaction already running");
+		return;
+	}
+
+	// the new snapshot contains all changes up to now
+	QStringList obsoleteFileNames = journalNames;
+
+	if (journalFile.isOpen()) {
+		journalFile.close();
+		obsoleteFileNames.append(journalFile.fileName());
+	}
+
+	journalNames.clear();
+	journalRecordCount = 0;
+	hasLegacySnapshot = false;
+	++journalNumber;
+	openJournal();
+	compactionThread.start(snapshotName, obsoleteFileNames, records);
+}
+
+void DvbEpgStorage::openJournal()
+{
+	journalFile.setFileName(dataDirectory + QLatin1String("/epgjournal-") +
+		QString::number(journalNumber) + QLatin1String(".dvb"));
+
+	if (!journalFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		Log("DvbEpgStorage::openJournal: cannot open") << journalFile.fileName();
+		return;
+	}
+
+	journalStream.setDevice(&journalFile);
+	journalStream.setVersion(QDataStream::Qt_4_4);
+	journalStream << epgJournalVersion;
+}
+
+bool DvbEpgStorage::openNextFile()
+{
+	while (!pendingFiles.isEmpty()) {
+		readFile.setFileName(pendingFiles.takeFirst());
+
+		if (!readFile.open(QIODevice::ReadOnly)) {
+			Log("DvbEpgStorage::openNextFile: cannot open") << readFile.fileName();
+			continue;
+		}
+
+		qint64 size = readFile.size();
+		uchar *data = NULL;
+
+		if ((size > 0) && (size <= 0x7fffffff)) {
+			data = readFile.map(0, size);
+		}
+
+		if (data == NULL) {
+			Log("DvbEpgStorage::openNextFile: cannot map") << readFile.fileName();
+			readFile.close();
+			continue;
+		}
+
+		readData = QByteArray::fromRawData(reinterpret_cast<const char *>(data), int(size));
+		readBuffer.setBuffer(&readData);
+		readBuffer.open(QIODevice::ReadOnly);
+		readStream.setDevice(&readBuffer);
+		readStream.setVersion(QDataStream::Qt_4_4);
+		readStream.resetStatus();
+		int version;
+		readStream >> version;
+
+		if (readFile.fileName() != snapshotName) {
+			if (version == epgJournalVersion) {
+				readFormat = Journal;
+				return true;
+			} else if (version == epgJournalV1Version) {
+				readFormat = JournalV1;
+				return true;
+			}
+		} else if (version == epgSnapshotVersion) {
+			readFormat = Snapshot;
+			readStream >> channelNames;
+
+			if (readStream.status() == QDataStream::Ok) {
+				return true;
+			}
+		} else if (version == 0x1ce0eca7) {
+			readFormat = SnapshotV1;
+			hasLegacySnapshot = true;
+			return true;
+		} else if (version == 0x79cffd36) {
+			readFormat = SnapshotV2;
+			hasLegacySnapshot = true;
+			return true;
+		}
+
+		Log("DvbEpgStorage::openNextFile: wrong version") << readFile.fileName();
+		closeFile();
+	}
+
+	return false;
+}
+
+void DvbEpgStorage::closeFile()
+{
+	readStream.setDevice(NULL);
+	readBuffer.close();
+	readData.clear();
+	channelNames.clear();
+	// also unmaps the data
+	readFile.close();
+}
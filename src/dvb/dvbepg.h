@@ -21,25 +21,33 @@
 #ifndef DVBEPG_H
 #define DVBEPG_H
 
+#include <QHash>
+#include <QSet>
+#include <QVector>
 #include "dvbrecording.h"
 
 class AtscEpgFilter;
 class DvbDevice;
+class DvbEpgDecoder;
 class DvbEpgFilter;
+class DvbEpgRecord;
+class DvbEpgStorage;
 
 class DvbEpgEntry : public SharedData
 {
 public:
-	DvbEpgEntry() { }
-	explicit DvbEpgEntry(const DvbSharedChannel &channel_) : channel(channel_) { }
+	DvbEpgEntry() : eventId(-1) { }
+	explicit DvbEpgEntry(const DvbSharedChannel &channel_) : channel(channel_), eventId(-1) { }
 	~DvbEpgEntry() { }
 
 	// checks that all variables are ok
 	bool validate() const;
 
 	DvbSharedChannel channel;
+	int eventId; // -1 = unknown
 	QDateTime begin; // UTC
 	QTime duration;
+	QDateTime end; // UTC, read-only (set by DvbEpgModel)
 	QString title;
 	QString subheading;
 	QString details;
@@ -49,40 +57,132 @@ public:
 typedef ExplicitlySharedDataPointer<const DvbEpgEntry> DvbSharedEpgEntry;
 Q_DECLARE_TYPEINFO(DvbSharedEpgEntry, Q_MOVABLE_TYPE);
 
-class DvbEpgEntryId
+class DvbEpgEntryBeginLessThan
 {
 public:
-	explicit DvbEpgEntryId(const DvbEpgEntry *entry_) : entry(entry_) { }
-	explicit DvbEpgEntryId(const DvbSharedEpgEntry &entry_) : entry(entry_.constData()) { }
-	~DvbEpgEntryId() { }
+	DvbEpgEntryBeginLessThan() { }
+	~DvbEpgEntryBeginLessThan() { }
 
-	// compares entries, 'recording' is ignored
-	// if one 'details' is empty, 'details' is ignored
+	bool operator()(const DvbSharedEpgEntry &x, const DvbSharedEpgEntry &y) const
+	{
+		return (x->begin < y->begin);
+	}
 
-	bool operator<(const DvbEpgEntryId &other) const;
+	bool operator()(const DvbSharedEpgEntry &x, const QDateTime &y) const
+	{
+		return (x->begin < y);
+	}
+
+	bool operator()(const QDateTime &x, const DvbSharedEpgEntry &y) const
+	{
+		return (x < y->begin);
+	}
+};
+
+// the epg entries of a single channel
+
+class DvbEpgChannelEntries
+{
+public:
+	DvbEpgChannelEntries() : maxDuration(0) { }
+	~DvbEpgChannelEntries() { }
+
+	QVector<DvbSharedEpgEntry> entries; // sorted by 'begin'
+	QHash<int, DvbSharedEpgEntry> eventIds;
+	int maxDuration; // seconds; upper bound for the duration of all entries
+};
+
+// inverted index over the (case folded) words of title, subheading and details; the details
+// contribute most of the word list entries (roughly one pointer per distinct word of each
+// description), so the index costs about as much memory as the text of a typical epg;
+// removed entries are only dropped from the word lists from time to time
+
+class DvbEpgTextIndex
+{
+public:
+	DvbEpgTextIndex() : postingCount(0), deadPostingCount(0) { }
+	~DvbEpgTextIndex() { }
+
+	void insert(const DvbSharedEpgEntry &entry);
+	void remove(const DvbSharedEpgEntry &entry);
+
+	// returns false if 'text' can't be looked up (it doesn't contain a word);
+	// otherwise 'candidates' contains at least all entries whose title, subheading or
+	// details contain 'text' (case insensitive) and has to be checked by the caller
+	bool findCandidates(const QString &text, QList<DvbSharedEpgEntry> &candidates) const;
 
 private:
-	const DvbEpgEntry *entry;
+	static void tokenize(const QString &text, QSet<QString> &words);
+	void rebuild();
+
+	QMap<QString, QVector<const DvbEpgEntry *> > postings; // sorted for prefix search
+	QHash<const DvbEpgEntry *, DvbSharedEpgEntry> entries;
+	int postingCount;
+	int deadPostingCount;
+};
+
+// min-heap of epg entries ordered by 'end'; removed entries stay in the heap until they
+// expire or the heap is rebuilt
+
+class DvbEpgExpiryHeap
+{
+public:
+	DvbEpgExpiryHeap() { }
+	~DvbEpgExpiryHeap() { }
+
+	int size() const
+	{
+		return entries.size();
+	}
+
+	void insert(const DvbSharedEpgEntry &entry);
+	// returns false if there's no entry whose end is <= 'dateTime'
+	bool takeExpired(const QDateTime &dateTime, DvbSharedEpgEntry &entry);
+	void rebuild(const QVector<DvbSharedEpgEntry> &currentEntries);
+
+private:
+	static bool endGreaterThan(const DvbSharedEpgEntry &x, const DvbSharedEpgEntry &y);
+
+	QVector<DvbSharedEpgEntry> entries;
 };
 
 class DvbEpgModel : public QObject
 {
 	Q_OBJECT
-	typedef QMap<DvbEpgEntryId, DvbSharedEpgEntry>::Iterator Iterator;
-	typedef QMap<DvbEpgEntryId, DvbSharedEpgEntry>::ConstIterator ConstIterator;
+	typedef QHash<DvbSharedChannel, DvbEpgChannelEntries>::Iterator Iterator;
+	typedef QHash<DvbSharedChannel, DvbEpgChannelEntries>::ConstIterator ConstIterator;
 public:
 	DvbEpgModel(DvbManager *manager_, QObject *parent);
 	~DvbEpgModel();
 
-	QMap<DvbEpgEntryId, DvbSharedEpgEntry> getEntries() const;
+	QList<DvbSharedEpgEntry> getEntries() const;
+	QList<DvbSharedEpgEntry> getEntries(const DvbSharedChannel &channel) const;
+	// returns the entries of 'channel' which overlap [begin, end) sorted by begin
+	QList<DvbSharedEpgEntry> getEntries(const DvbSharedChannel &channel,
+		const QDateTime &begin, const QDateTime &end) const;
 	QMap<DvbSharedRecording, DvbSharedEpgEntry> getRecordings() const;
 	void setRecordings(const QMap<DvbSharedRecording, DvbSharedEpgEntry> map);
 	QHash<DvbSharedChannel, int> getEpgChannels() const;
 	QList<DvbSharedEpgEntry> getCurrentNext(const DvbSharedChannel &channel) const;
+	// see DvbEpgTextIndex::findCandidates()
+	bool findEntryCandidates(const QString &text, QList<DvbSharedEpgEntry> &candidates) const;
+
+	// 'section' = (table id << 8) | section number; returns true if the eit section has been
+	// seen with another version before (the text of its events may have been corrected)
+	bool updateEitSectionVersion(const DvbSharedChannel &channel, int section, int version);
+	// only looks at 'channel', 'eventId', 'begin' and 'duration'; returns false if the
+	// entry has already ended, is being decoded or is already known (unless 'checkText'
+	// is true), so that its text needn't be decoded
+	bool isNewEntry(const DvbEpgEntry &entry, bool checkText) const;
 
 	DvbSharedEpgEntry addEntry(const DvbEpgEntry &entry);
+	// decodes the text of the selected events of an eit section in the background
+	// and adds the entries afterwards ('entries' contains everything except the text)
+	void addEitEntries(const char *data, int size, const QVector<int> &eventIndexes,
+		const QVector<DvbEpgEntry> &entries);
 	void scheduleProgram(const DvbSharedEpgEntry &entry, int extraSecondsBefore,
-		int extraSecondsAfter, bool checkForRecursion=false, int priority=10);
+		int extraSecondsAfter, bool checkForRecursion=false, int priority=10,
+		const QString &streams=QString());
 
 	void startEventFilter(DvbDevice *device, const DvbSharedChannel &channel);
 	void stopEventFilter(DvbDevice *device, const DvbSharedChannel &channel);
@@ -93,6 +193,9 @@ signals:
 	void entryAboutToBeUpdated(const DvbSharedEpgEntry &entry);
 	void entryUpdated(const DvbSharedEpgEntry &entry);
 	void entryRemoved(const DvbSharedEpgEntry &entry);
+	// bulk changes (decoded eit data, loading, expiry, ...) are reported in batches
+	void entriesAdded(const QList<DvbSharedEpgEntry> &entries);
+	void entriesRemoved(const QList<DvbSharedEpgEntry> &entries);
 	void epgChannelAdded(const DvbSharedChannel &channel);
 	void epgChannelRemoved(const DvbSharedChannel &channel);
 
@@ -104,14 +207,49 @@ private slots:
 
 private:
 	void timerEvent(QTimerEvent *event);
+	void customEvent(QEvent *event);
+	void loadRecords();
+	void replayRecord(const DvbEpgRecord &record);
+	void journalAddition(const DvbSharedEpgEntry &entry);
+	void journalRemoval(const DvbSharedEpgEntry &entry);
+	void startJournalTimer();
+	void compactStorage();
 
-	Iterator removeEntry(Iterator it);
+	// returns -1 if there's no such entry
+	static int findEntry(const DvbEpgChannelEntries &channelEntries,
+		const DvbEpgEntry &entry);
+	static int indexOf(const DvbEpgChannelEntries &channelEntries,
+		const DvbSharedEpgEntry &entry);
+	void removeEntry(Iterator it, int index);
+	// like removeEntry(), but doesn't emit entryRemoved()
+	DvbSharedEpgEntry takeEntry(Iterator it, int index);
+	void rebuildExpiryHeap();
+	// while 'batchingEntries' is true, additions and removals are collected
+	void flushBatch();
+	void removeChannel(const DvbSharedChannel &channel);
 
 	DvbManager *manager;
 	QDateTime currentDateTimeUtc;
-	QMap<DvbEpgEntryId, DvbSharedEpgEntry> entries;
+	QHash<DvbSharedChannel, DvbEpgChannelEntries> channelEntries;
+	// the version numbers of the eit sections (see updateEitSectionVersion())
+	QHash<DvbSharedChannel, QHash<int, int> > eitSectionVersions;
 	QMap<DvbSharedRecording, DvbSharedEpgEntry> recordings;
-	QHash<DvbSharedChannel, int> epgChannels;
+	DvbEpgExpiryHeap expiryHeap;
+	DvbEpgTextIndex textIndex;
+	DvbEpgDecoder *decoder;
+	DvbEpgStorage *storage;
+	QHash<QString, DvbSharedChannel> loadingChannels; // channel cache while loading
+	QList<DvbSharedEpgEntry> addedEntries;
+	QList<DvbSharedEpgEntry> removedEntries;
+	bool batchingEntries;
+	bool loading; // the stored records are being loaded
+	bool replayingRecords;
+	int journalTimerId; // 0 = journal flushed
+	// events which are being decoded (channel and event id); retransmissions are skipped
+	QSet<QPair<const DvbChannel *, int> > decodingEvents;
+	// received while loading; replayed records are older and mustn't replace them
+	QSet<const DvbEpgEntry *> liveEntries;
+	int entryCount;
 	QList<QExplicitlySharedDataPointer<DvbEpgFilter> > dvbEpgFilters;
 	QList<QExplicitlySharedDataPointer<AtscEpgFilter> > atscEpgFilters;
 	DvbChannel updatingChannel;
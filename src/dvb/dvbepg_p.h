@@ -21,6 +21,15 @@
 #ifndef DVBEPG_P_H
 #define DVBEPG_P_H
 
+#include <QBuffer>
+#include <QDataStream>
+#include <QEvent>
+#include <QFile>
+#include <QMutex>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <QWaitCondition>
 #include "dvbbackenddevice.h"
 #include "dvbepg.h"
 
@@ -34,16 +43,65 @@ public:
 	QString source;
 	DvbTransponder transponder;
 
-private:
-	Q_DISABLE_COPY(DvbEpgFilter)
 	static QTime bcdToTime(int bcd);
 
+private:
+	Q_DISABLE_COPY(DvbEpgFilter)
 	void processSection(const char *data, int size);
 
 	DvbChannelModel *channelModel;
 	DvbEpgModel *epgModel;
 };
 
+class DvbEpgDecoder;
+
+class DvbEpgDecodeJob : public QRunnable
+{
+public:
+	DvbEpgDecodeJob(DvbEpgDecoder *decoder_, qint64 sequenceNumber_) :
+		decoder(decoder_), sequenceNumber(sequenceNumber_) { }
+	~DvbEpgDecodeJob() { }
+
+	QByteArray section;
+	QVector<int> eventIndexes; // the events of the section which have to be decoded
+	QVector<DvbEpgEntry> entries; // same order as 'eventIndexes'; the text is missing
+
+private:
+	Q_DISABLE_COPY(DvbEpgDecodeJob)
+	void run();
+
+	DvbEpgDecoder *decoder;
+	qint64 sequenceNumber;
+};
+
+// decodes the text of eit events on a thread pool; the results are handed back
+// (by posting a QEvent::User to the receiver) in the order of the sections
+
+class DvbEpgDecoder
+{
+public:
+	explicit DvbEpgDecoder(QObject *receiver_);
+	~DvbEpgDecoder();
+
+	void decode(const char *data, int size, const QVector<int> &eventIndexes,
+		const QVector<DvbEpgEntry> &entries);
+	// returns false if the next result isn't available yet
+	bool takeResult(QVector<DvbEpgEntry> &entries);
+
+	void jobFinished(qint64 sequenceNumber, const QVector<DvbEpgEntry> &entries);
+
+private:
+	Q_DISABLE_COPY(DvbEpgDecoder)
+
+	QObject *receiver;
+	QThreadPool threadPool;
+	qint64 nextSequenceNumber;
+	QMutex mutex;
+	QMap<qint64, QVector<DvbEpgEntry> > results; // protected by 'mutex'
+	qint64 nextResult; // protected by 'mutex'
+	bool eventPending; // protected by 'mutex'
+};
+
 class AtscEpgMgtFilter : public DvbSectionFilter
 {
 public:
@@ -112,4 +170,143 @@ private:
 	QMap<quint32, DvbSharedEpgEntry> epgEntries;
 };
 
+// an epg entry as it is stored on disk
+
+class DvbEpgRecord
+{
+public:
+	enum Type
+	{
+		Add = 0,
+		Remove = 1
+	};
+
+	DvbEpgRecord() : type(Add), eventId(-1), recordingKey(0) { }
+	DvbEpgRecord(Type type_, const DvbEpgEntry &entry);
+	~DvbEpgRecord() { }
+
+	Type type;
+	QString channelName;
+	int eventId;
+	QDateTime begin; // UTC
+	QTime duration;
+	QString title;
+	QString subheading;
+	QString details;
+	quint32 recordingKey; // 0 = no recording
+};
+
+class DvbEpgCompactionThread : public QThread
+{
+public:
+	DvbEpgCompactionThread() { }
+	~DvbEpgCompactionThread()
+	{
+		wait();
+	}
+
+	// writes a new snapshot and removes the journals which it supersedes
+	void start(const QString &fileName_, const QStringList &obsoleteFileNames_,
+		const QList<DvbEpgRecord> &records_);
+
+private:
+	void run();
+
+	QString fileName;
+	QStringList obsoleteFileNames;
+	QList<DvbEpgRecord> records;
+};
+
+class DvbEpgStorage;
+
+class DvbEpgLoadingThread : public QThread
+{
+public:
+	explicit DvbEpgLoadingThread(DvbEpgStorage *storage_) : storage(storage_) { }
+	~DvbEpgLoadingThread()
+	{
+		wait();
+	}
+
+private:
+	void run();
+
+	DvbEpgStorage *storage;
+};
+
+// the epg data consists of a snapshot and a journal with the changes since then;
+// the files are mapped and decoded in a separate thread (so that neither startup nor
+// the gui is delayed) and the snapshot is rewritten in the background once the journal
+// becomes too large; removals are journaled as the key of the entry only
+
+class DvbEpgStorage
+{
+	friend class DvbEpgLoadingThread;
+public:
+	DvbEpgStorage();
+	~DvbEpgStorage();
+
+	enum {
+		LoadingEvent = QEvent::User + 1
+	};
+
+	// 'receiver' gets a LoadingEvent when records can be taken
+	void startLoading(QObject *receiver);
+	// returns false if no records are available at the moment
+	bool takeRecords(QList<DvbEpgRecord> &records);
+	// returns true once all records have been read and taken
+	bool isLoadingFinished();
+
+	void append(const DvbEpgRecord &record);
+	void flush();
+
+	bool isCompactionNeeded(int entryCount) const;
+	void compact(const QList<DvbEpgRecord> &records);
+
+private:
+	Q_DISABLE_COPY(DvbEpgStorage)
+
+	enum Format
+	{
+		SnapshotV1, // kaffeine 1.x (no recording keys)
+		SnapshotV2, // kaffeine 1.x
+		Snapshot,
+		JournalV1, // removals contain the whole entry
+		Journal
+	};
+
+	void loadRecords(); // runs in 'loadingThread'
+	// returns false if there are no more records
+	bool readRecords(QList<DvbEpgRecord> &records, int maxCount);
+	void openJournal();
+	bool openNextFile();
+	void closeFile();
+
+	QString dataDirectory;
+	QString snapshotName;
+	QStringList journalNames; // the journals of previous sessions in order
+	int journalNumber;
+	QStringList pendingFiles; // to be read
+	QFile readFile;
+	QByteArray readData;
+	QBuffer readBuffer;
+	QDataStream readStream;
+	Format readFormat;
+	QStringList channelNames;
+	QFile journalFile;
+	QDataStream journalStream;
+	int journalRecordCount;
+	int readJournalRecordCount; // only used by 'loadingThread'
+	bool hasLegacySnapshot;
+	DvbEpgCompactionThread compactionThread;
+	DvbEpgLoadingThread loadingThread;
+	QObject *loadingReceiver;
+	QMutex loadingMutex;
+	QWaitCondition loadingCondition;
+	QList<QList<DvbEpgRecord> > loadedRecords; // protected by 'loadingMutex'
+	bool loadingFinished; // protected by 'loadingMutex'
+	bool loadingEventPending; // protected by 'loadingMutex'
+	bool stopLoading; // protected by 'loadingMutex'
+};
+
 #endif /* DVBEPG_P_H */
@@ -147,7 +147,7 @@ void DvbEpgDialog::entryActivated(const QModelIndex &index)
 	}
 
 	QDateTime begin = entry->begin.toLocalTime();
-	QTime end = entry->begin.addSecs(QTime().secsTo(entry->duration)).toLocalTime().time();
+	QTime end = entry->end.toLocalTime().time();
 	text += i18nc("@info tv show start, end", "<font color=#800000>%1 - %2</font><br><br>",
 		QLocale().toString(begin), QLocale().toString(end));
 	text += entry->details;
@@ -312,6 +312,10 @@ void DvbEpgTableModel::setEpgModel(DvbEpgModel *epgModel_)
 		this, SLOT(entryUpdated(DvbSharedEpgEntry)));
 	connect(epgModel, SIGNAL(entryRemoved(DvbSharedEpgEntry)),
 		this, SLOT(entryRemoved(DvbSharedEpgEntry)));
+	connect(epgModel, SIGNAL(entriesAdded(QList<DvbSharedEpgEntry>)),
+		this, SLOT(entriesAdded(QList<DvbSharedEpgEntry>)));
+	connect(epgModel, SIGNAL(entriesRemoved(QList<DvbSharedEpgEntry>)),
+		this, SLOT(entriesRemoved(QList<DvbSharedEpgEntry>)));
 }
 
 void DvbEpgTableModel::setChannelFilter(const DvbSharedChannel &channel)
@@ -319,7 +323,7 @@ void DvbEpgTableModel::setChannelFilter(const DvbSharedChannel &channel)
 	helper.channelFilter = channel;
 	helper.contentFilter.setPattern(QString());
 	helper.filterType = DvbEpgTableModelHelper::ChannelFilter;
-	reset(epgModel->getEntries());
+	reset(epgModel->getEntries(channel));
 }
 
 QVariant DvbEpgTableModel::data(const QModelIndex &index, int role) const
@@ -387,7 +391,7 @@ void DvbEpgTableModel::setContentFilter(const QString &pattern)
 	} else {
 		// use channel filter so that content won't be unnecessarily filtered
 		helper.filterType = DvbEpgTableModelHelper::ChannelFilter;
-		reset(QMap<DvbEpgEntryId, DvbSharedEpgEntry>());
+		reset(QList<DvbSharedEpgEntry>());
 	}
 }
 
@@ -411,12 +415,29 @@ void DvbEpgTableModel::entryRemoved(const DvbSharedEpgEntry &entry)
 	remove(entry);
 }
 
+void DvbEpgTableModel::entriesAdded(const QList<DvbSharedEpgEntry> &entries)
+{
+	insertItems(entries);
+}
+
+void DvbEpgTableModel::entriesRemoved(const QList<DvbSharedEpgEntry> &entries)
+{
+	removeItems(entries);
+}
+
 void DvbEpgTableModel::customEvent(QEvent *event)
 {
 	Q_UNUSED(event)
 	contentFilterEventPending = false;
 
 	if (helper.filterType == DvbEpgTableModelHelper::ContentFilter) {
-		reset(epgModel->getEntries());
+		QList<DvbSharedEpgEntry> candidates;
+
+		if (!epgModel->findEntryCandidates(helper.contentFilter.pattern(), candidates)) {
+			reset(epgModel->getEntries());
+			return;
+		}
+
+		reset(candidates);
 	}
 }
@@ -135,6 +135,8 @@ private slots:
 	void entryAboutToBeUpdated(const DvbSharedEpgEntry &entry);
 	void entryUpdated(const DvbSharedEpgEntry &entry);
 	void entryRemoved(const DvbSharedEpgEntry &entry);
+	void entriesAdded(const QList<DvbSharedEpgEntry> &entries);
+	void entriesRemoved(const QList<DvbSharedEpgEntry> &entries);
 
 private:
 	void customEvent(QEvent *event);
@@ -21,19 +21,12 @@
 #include "dvbliveview.h"
 #include "dvbliveview_p.h"
 
-#include <QDir>
 #include <QPainter>
 #include <QSet>
-#include <QSocketNotifier>
 #include <QStandardPaths>
 #include <QLocale>
 #include <KLocalizedString>
 #include <KMessageBox>
-#include <errno.h>
-#include <fcntl.h>
-#include <sys/stat.h> // bsd compatibility
-#include <sys/types.h> // bsd compatibility
-#include <unistd.h>
 #include "../log.h"
 #include "dvbdevice.h"
 #include "dvbmanager.h"
@@ -171,6 +164,14 @@ void DvbLiveView::replay()
 
 void DvbLiveView::playbackFinished()
 {
+	if (!internal->timeshift) {
+		// the data goes to the time shift buffer while it's active (leave time shift)
+		internal->timeShiftBuffer->stop();
+		// start again with a decodable picture
+		insertPatPmt();
+		internal->restartStream();
+	}
+
 	mediaWidget->play(internal);
 }
 
@@ -187,14 +188,49 @@ DvbDevice *DvbLiveView::getDevice() const
 void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 {
 	DvbDevice *newDevice = NULL;
+	QByteArray pmtSectionData = channel_->pmtSectionData;
+	QByteArray gop;
+
+	for (int i = 0; i < standbys.size(); ++i) {
+		DvbLiveViewStandby *standby = standbys.at(i);
+
+		if ((standby->channel.constData() == channel_.constData()) &&
+		    (standby->getDevice() != NULL)) {
+			// already tuned; the pmt is up to date
+			newDevice = standby->takeDevice();
 
-	if ((channel.constData() != NULL) && (channel->source == channel_->source) &&
+			if (!standby->pmtSectionData.isEmpty()) {
+				pmtSectionData = standby->pmtSectionData;
+			}
+
+			gop = standby->gopCache.getData();
+
+			delete standbys.takeAt(i);
+			break;
+		}
+	}
+
+	if ((newDevice == NULL) && (channel.constData() != NULL) &&
+	    (channel->source == channel_->source) &&
 	    (channel->transponder.corresponds(channel_->transponder))) {
 		newDevice = manager->requestDevice(channel->source, channel->transponder,
 			DvbManager::Shared);
 	}
 
-	playbackStatusChanged(MediaWidget::Idle);
+	if (manager->isFastZapEnabled() && (device != NULL) &&
+	    (channel.constData() != channel_.constData())) {
+		// the current channel is likely a neighbour of the new one
+		DvbDevice *standbyDevice = manager->requestDevice(channel->source,
+			channel->transponder, DvbManager::Shared);
+
+		if (standbyDevice != NULL) {
+			standbys.append(new DvbLiveViewStandby(manager, channel, standbyDevice,
+				internal->pmtSectionData, this));
+		}
+	}
+
+	// an active time shift buffer is kept (it's reused if time shift is always on)
+	reset();
 	channel = channel_;
 	device = newDevice;
 
@@ -203,6 +239,13 @@ void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 			DvbManager::Shared);
 	}
 
+	if ((device == NULL) && !standbys.isEmpty()) {
+		// the standby channels mustn't block the current one
+		clearStandbys();
+		device = manager->requestDevice(channel->source, channel->transponder,
+			DvbManager::Shared);
+	}
+
 	if (device == NULL) {
 		channel = DvbSharedChannel();
 		mediaWidget->stop();
@@ -219,7 +262,16 @@ void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 	}
 
 	internal->channelName = channel->name;
-	internal->resetPipe();
+	internal->lowLatency = manager->isLowLatencyEnabled();
+	internal->resetStream();
+
+	if (manager->isTimeShiftAlwaysOn()) {
+		startTimeShift();
+		internal->timeshift = true;
+	} else {
+		internal->timeShiftBuffer->stop();
+	}
+
 	mediaWidget->play(internal);
 
 	internal->pmtFilter.setProgramNumber(channel->serviceId);
@@ -230,13 +282,65 @@ void DvbLiveView::playChannel(const DvbSharedChannel &channel_)
 	videoPid = -1;
 	audioPid = channel->audioPid;
 	subtitlePid = -1;
-	pmtSectionChanged(channel->pmtSectionData);
+	pmtSectionChanged(pmtSectionData);
+	// the player doesn't have to wait for the next random access point
+	internal->writePackets(gop);
 	patPmtTimer.start(500);
 
-	internal->buffer.reserve(87 * 188);
 	QTimer::singleShot(2000, this, SLOT(showOsd()));
 }
 
+void DvbLiveView::setStandbyChannels(const QList<DvbSharedChannel> &standbyChannels)
+{
+	// release the devices which aren't needed anymore first
+	for (int i = 0; i < standbys.size(); ++i) {
+		DvbLiveViewStandby *standby = standbys.at(i);
+		bool keep = false;
+
+		foreach (const DvbSharedChannel &standbyChannel, standbyChannels) {
+			if (standbyChannel.constData() == standby->channel.constData()) {
+				keep = (standby->getDevice() != NULL);
+				break;
+			}
+		}
+
+		if (!keep) {
+			standby->releaseDevice();
+			delete standbys.takeAt(i);
+			--i;
+		}
+	}
+
+	foreach (const DvbSharedChannel &standbyChannel, standbyChannels) {
+		if (!standbyChannel.isValid() ||
+		    (standbyChannel.constData() == channel.constData())) {
+			continue;
+		}
+
+		bool found = false;
+
+		foreach (const DvbLiveViewStandby *standby, standbys) {
+			if (standby->channel.constData() == standbyChannel.constData()) {
+				found = true;
+				break;
+			}
+		}
+
+		if (found) {
+			continue;
+		}
+
+		// only succeeds if the transponder is already tuned or a device is idle
+		DvbDevice *standbyDevice = manager->requestDevice(standbyChannel->source,
+			standbyChannel->transponder, DvbManager::Shared);
+
+		if (standbyDevice != NULL) {
+			standbys.append(new DvbLiveViewStandby(manager, standbyChannel, standbyDevice,
+				standbyChannel->pmtSectionData, this));
+		}
+	}
+}
+
 void DvbLiveView::toggleOsd()
 {
 	if (channel.constData() == NULL) {
@@ -304,7 +408,7 @@ void DvbLiveView::pmtSectionChanged(const QByteArray &pmtSectionData)
 		device->startDescrambling(internal->pmtSectionData, this);
 	}
 
-	if (internal->timeShiftFile.isOpen()) {
+	if (internal->timeShiftBuffer->isActive()) {
 		return;
 	}
 
@@ -359,6 +463,12 @@ void DvbLiveView::deviceStateChanged()
 		device = manager->requestDevice(channel->source, channel->transponder,
 			DvbManager::Shared);
 
+		if ((device == NULL) && !standbys.isEmpty()) {
+			clearStandbys();
+			device = manager->requestDevice(channel->source, channel->transponder,
+				DvbManager::Shared);
+		}
+
 		if (device != NULL) {
 			startDevice();
 		} else {
@@ -402,58 +512,23 @@ void DvbLiveView::playbackStatusChanged(MediaWidget::PlaybackStatus playbackStat
 {
 	switch (playbackStatus) {
 	case MediaWidget::Idle:
-		if (device != NULL) {
-			stopDevice();
-			manager->releaseDevice(device, DvbManager::Shared);
-			device = NULL;
-		}
-
-		channel = DvbSharedChannel();
-		pids.clear();
-		patPmtTimer.stop();
-		osdTimer.stop();
-
-		internal->pmtSectionData.clear();
-		internal->patGenerator = DvbSectionGenerator();
-		internal->pmtGenerator = DvbSectionGenerator();
-		internal->buffer.clear();
-		internal->timeShiftFile.close();
-		internal->dvbOsd.init(DvbOsd::Off, QString(), QList<DvbSharedEpgEntry>());
-		osdWidget->hideObject();
+		reset();
+		clearStandbys();
+		internal->timeShiftBuffer->stop();
 		break;
 	case MediaWidget::Playing:
-		if (internal->timeShiftFile.isOpen()) {
-			// FIXME
+		if (internal->timeShiftBuffer->isActive() && !internal->timeshift) {
+			internal->timeshift = true;
 			mediaWidget->play(internal);
 		}
 
 		break;
 	case MediaWidget::Paused:
-		if (internal->timeShiftFile.isOpen()) {
+		if (internal->timeShiftBuffer->isActive()) {
 			break;
 		}
 
-		internal->timeShiftFile.setFileName(manager->getTimeShiftFolder() + QLatin1String("/TimeShift-") +
-			QDateTime::currentDateTime().toString(QLatin1String("yyyyMMddThhmmss")) +
-			QLatin1String(".m2t"));
-
-		if (internal->timeShiftFile.exists() ||
-		    !internal->timeShiftFile.open(QIODevice::WriteOnly)) {
-			Log("DvbLiveView::playbackStatusChanged: cannot open file") <<
-				internal->timeShiftFile.fileName();
-			internal->timeShiftFile.setFileName(QDir::homePath() + QLatin1String("/TimeShift-") +
-				QDateTime::currentDateTime().toString(QLatin1String("yyyyMMddThhmmss")) +
-				QLatin1String(".m2t"));
-
-			if (internal->timeShiftFile.exists() ||
-			    !internal->timeShiftFile.open(QIODevice::WriteOnly)) {
-				Log("DvbLiveView::playbackStatusChanged: cannot open file") <<
-					internal->timeShiftFile.fileName();
-				mediaWidget->stop();
-				break;
-			}
-		}
-
+		startTimeShift();
 		updatePids();
 
 		// don't allow changes after starting time shift
@@ -512,13 +587,65 @@ void DvbLiveView::stopDevice()
 	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
 }
 
+void DvbLiveView::reset()
+{
+	if (device != NULL) {
+		stopDevice();
+		manager->releaseDevice(device, DvbManager::Shared);
+		device = NULL;
+	}
+
+	channel = DvbSharedChannel();
+	pids.clear();
+	patPmtTimer.stop();
+	osdTimer.stop();
+
+	internal->pmtSectionData.clear();
+	internal->patGenerator = DvbSectionGenerator();
+	internal->pmtGenerator = DvbSectionGenerator();
+	internal->buffer.clear();
+	internal->timeshift = false;
+	internal->dvbOsd.init(DvbOsd::Off, QString(), QList<DvbSharedEpgEntry>());
+	osdWidget->hideObject();
+}
+
+void DvbLiveView::clearStandbys()
+{
+	foreach (DvbLiveViewStandby *standby, standbys) {
+		standby->releaseDevice();
+		delete standby;
+	}
+
+	standbys.clear();
+}
+
+void DvbLiveView::startTimeShift()
+{
+	if (internal->timeShiftBuffer->isActive()) {
+		return;
+	}
+
+	QString fileName = manager->getTimeShiftFolder() + QLatin1String("/TimeShift-") +
+		QDateTime::currentDateTime().toString(QLatin1String("yyyyMMddThhmmss")) +
+		QLatin1String(".m2t");
+	internal->timeShiftBuffer->start(fileName,
+		qint64(manager->getTimeShiftMemorySize()) << 20,
+		qint64(manager->getTimeShiftFileSize()) << 20);
+}
+
 void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 {
 	DvbPmtSection pmtSection(internal->pmtSectionData);
 	DvbPmtParser pmtParser(pmtSection);
 	QSet<int> newPids;
 	bool updatePatPmt = forcePatPmtUpdate;
-	bool isTimeShifting = internal->timeShiftFile.isOpen();
+	bool isTimeShifting = internal->timeShiftBuffer->isActive();
+
+	if (pmtSection.isValid()) {
+		internal->timeShiftBuffer->setIndexPids(videoPid, pmtSection.pcrPid());
+	}
+
+	internal->gopCache.setVideoPid(videoPid);
 
 	if (videoPid != -1) {
 		newPids.insert(videoPid);
@@ -571,111 +698,168 @@ void DvbLiveView::updatePids(bool forcePatPmtUpdate)
 	}
 }
 
-DvbLiveViewInternal::DvbLiveViewInternal(QObject *parent) : QObject(parent), mediaWidget(NULL),
-	readFd(-1), writeFd(-1)
+DvbLiveViewStandby::DvbLiveViewStandby(DvbManager *manager_, const DvbSharedChannel &channel_,
+	DvbDevice *device_, const QByteArray &pmtSectionData_, QObject *parent) : QObject(parent),
+	channel(channel_), manager(manager_), device(device_), videoPid(-1)
 {
-	QString fileName = QStandardPaths::writableLocation(QStandardPaths::DataLocation) + "/" + QLatin1String("dvbpipe.m2t");
-	QFile::remove(fileName);
-	url = QUrl::fromLocalFile(fileName);
+	pmtFilter.setProgramNumber(channel->serviceId);
+	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
+		this, SLOT(pmtSectionChanged(QByteArray)));
+	device->addSectionFilter(channel->pmtPid, &pmtFilter);
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+	pmtSectionChanged(pmtSectionData_);
+}
 
-	if (mkfifo(QFile::encodeName(fileName).constData(), 0600) != 0) {
-		Log("DvbLiveViewInternal::DvbLiveViewInternal: mkfifo failed");
-		return;
+DvbLiveViewStandby::~DvbLiveViewStandby()
+{
+	// the device isn't touched here (it may already be deleted during shutdown)
+}
+
+DvbDevice *DvbLiveViewStandby::takeDevice()
+{
+	DvbDevice *takenDevice = device;
+
+	if (device != NULL) {
+		stopDevice();
 	}
 
-	readFd = open(QFile::encodeName(fileName).constData(), O_RDONLY | O_NONBLOCK);
+	return takenDevice;
+}
 
-	if (readFd < 0) {
-		Log("DvbLiveViewInternal::DvbLiveViewInternal: open failed");
-		return;
+void DvbLiveViewStandby::releaseDevice()
+{
+	if (device != NULL) {
+		DvbDevice *releasedDevice = device;
+		stopDevice();
+		manager->releaseDevice(releasedDevice, DvbManager::Shared);
 	}
+}
+
+void DvbLiveViewStandby::pmtSectionChanged(const QByteArray &pmtSectionData_)
+{
+	pmtSectionData = pmtSectionData_;
+	DvbPmtSection pmtSection(pmtSectionData);
+	int newVideoPid = -1;
 
-	writeFd = open(QFile::encodeName(fileName).constData(), O_WRONLY | O_NONBLOCK);
+	if (pmtSection.isValid()) {
+		newVideoPid = DvbPmtParser(pmtSection).videoPid;
+	}
 
-	if (writeFd < 0) {
-		Log("DvbLiveViewInternal::DvbLiveViewInternal: open failed");
+	if ((device == NULL) || (videoPid == newVideoPid)) {
 		return;
 	}
 
-	notifier = new QSocketNotifier(writeFd, QSocketNotifier::Write, this);
-	notifier->setEnabled(false);
-	connect(notifier, SIGNAL(activated(int)), this, SLOT(writeToPipe()));
+	if (videoPid != -1) {
+		device->removePidFilter(videoPid, this);
+	}
+
+	videoPid = newVideoPid;
+	gopCache.setVideoPid(videoPid);
+
+	if (videoPid != -1) {
+		device->addPidFilter(videoPid, this);
+	}
 }
 
-DvbLiveViewInternal::~DvbLiveViewInternal()
+void DvbLiveViewStandby::deviceStateChanged()
 {
-	if (writeFd >= 0) {
-		close(writeFd);
+	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
+		// taken by a recording; the reference is gone
+		stopDevice();
 	}
+}
 
-	if (readFd >= 0) {
-		close(readFd);
-	}
+void DvbLiveViewStandby::processData(const char data[188])
+{
+	gopCache.processPacket(data);
 }
 
-void DvbLiveViewInternal::resetPipe()
+void DvbLiveViewStandby::stopDevice()
 {
-	if (!buffers.isEmpty()) {
-		buffer = buffers.at(0);
-		buffers.clear();
+	if (videoPid != -1) {
+		device->removePidFilter(videoPid, this);
+		videoPid = -1;
 	}
 
-	if (readFd >= 0) {
-		if (buffer.isEmpty()) {
-			buffer.resize(87 * 188);
-		}
+	device->removeSectionFilter(channel->pmtPid, &pmtFilter);
+	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+	device = NULL;
+}
 
-		while (read(readFd, buffer.data(), buffer.size()) > 0) {
-		}
+DvbLiveViewInternal::DvbLiveViewInternal(QObject *parent) : QObject(parent), mediaWidget(NULL),
+	timeShiftBuffer(new DvbTimeShiftBuffer()), timeshift(false), lowLatency(false),
+	streamBuffer(new MediaStreamBuffer())
+{
+	batch.reserve(MaxBatchSize);
+}
+
+DvbLiveViewInternal::~DvbLiveViewInternal()
+{
+	qint64 bytesDropped = streamBuffer->getBytesDropped();
+
+	if (bytesDropped != 0) {
+		Log("DvbLiveViewInternal::~DvbLiveViewInternal: the player was too slow; bytes dropped:") <<
+			bytesDropped;
 	}
+}
 
+void DvbLiveViewInternal::resetStream()
+{
+	streamBuffer->flush();
+	timeShiftBuffer->clear();
 	buffer.clear();
+	batch.resize(0);
+	gopCache.clear();
 }
 
-void DvbLiveViewInternal::writeToPipe()
+void DvbLiveViewInternal::restartStream()
 {
-	while (!buffers.isEmpty()) {
-		const QByteArray &currentBuffer = buffers.at(0);
-		int bytesWritten = int(write(writeFd, currentBuffer.constData(), currentBuffer.size()));
+	// the cache ends with the last packet which has been passed on, so the timestamps
+	// continue seamlessly with the next packet; the cache isn't fed again
+	streamBuffer->flush();
+	batch.resize(0);
+	buffer.append(gopCache.getData());
+	streamBuffer->write(buffer.constData(), buffer.size());
+	buffer.clear();
+}
 
-		if ((bytesWritten < 0) && (errno == EINTR)) {
-			continue;
-		}
+void DvbLiveViewInternal::writePackets(const QByteArray &packets)
+{
+	for (int i = 0; (i + 188) <= packets.size(); i += 188) {
+		processData(packets.constData() + i);
+	}
 
-		if (bytesWritten == currentBuffer.size()) {
-			buffers.removeFirst();
-			continue;
-		}
+	processBatchEnd();
+}
 
-		if (bytesWritten > 0) {
-			buffers.first().remove(0, bytesWritten);
-		}
+void DvbLiveViewInternal::processData(const char data[188])
+{
+	gopCache.processPacket(data);
 
-		break;
+	if (!buffer.isEmpty()) {
+		batch.append(buffer);
+		buffer.clear();
 	}
 
-	if (!buffers.isEmpty()) {
-		notifier->setEnabled(true);
+	batch.append(data, 188);
+
+	if (batch.size() >= MaxBatchSize) {
+		processBatchEnd();
 	}
 }
 
-void DvbLiveViewInternal::processData(const char data[188])
+void DvbLiveViewInternal::processBatchEnd()
 {
-	buffer.append(data, 188);
-
-	if (buffer.size() < (87 * 188)) {
+	if (batch.isEmpty()) {
 		return;
 	}
 
-	if (!timeShiftFile.isOpen()) {
-		if (writeFd >= 0) {
-			buffers.append(buffer);
-			writeToPipe();
-		}
+	if (timeShiftBuffer->isActive()) {
+		timeShiftBuffer->write(batch.constData(), batch.size());
 	} else {
-		timeShiftFile.write(buffer); // FIXME avoid buffer reallocation
+		streamBuffer->write(batch.constData(), batch.size());
 	}
 
-	buffer.clear();
-	buffer.reserve(87 * 188);
+	// keeps the capacity
+	batch.resize(0);
 }
@@ -27,6 +27,7 @@
 
 class DvbDevice;
 class DvbLiveViewInternal;
+class DvbLiveViewStandby;
 class DvbManager;
 
 class DvbLiveView : public QObject
@@ -40,6 +41,9 @@ public:
 	DvbDevice *getDevice() const;
 
 	void playChannel(const DvbSharedChannel &channel_);
+	// keeps these channels tuned on otherwise idle devices (fast zap); the channels are
+	// released again if a recording needs the device
+	void setStandbyChannels(const QList<DvbSharedChannel> &standbyChannels);
 
 public slots:
 	void toggleOsd();
@@ -64,12 +68,17 @@ private slots:
 private:
 	void startDevice();
 	void stopDevice();
+	// like stopping the playback, but the time shift buffer is kept
+	void reset();
+	void startTimeShift();
+	void clearStandbys();
 	void updatePids(bool forcePatPmtUpdate = false);
 
 	DvbManager *manager;
 	MediaWidget *mediaWidget;
 	OsdWidget *osdWidget;
 	DvbLiveViewInternal *internal;
+	QList<DvbLiveViewStandby *> standbys;
 
 	DvbSharedChannel channel;
 	DvbDevice *device;
@@ -21,13 +21,15 @@
 #ifndef DVBLIVEVIEW_P_H
 #define DVBLIVEVIEW_P_H
 
-#include <QFile>
+#include "../mediastreambuffer.h"
 #include "../mediawidget.h"
 #include "../osdwidget.h"
 #include "dvbepg.h"
 #include "dvbsi.h"
+#include "dvbtimeshiftbuffer.h"
 
-class QSocketNotifier;
+class DvbDevice;
+class DvbManager;
 
 class DvbOsd : public OsdObject
 {
@@ -54,6 +56,43 @@ private:
 	DvbEpgEntry secondEntry;
 };
 
+// keeps a channel tuned and its pmt up to date, so that switching to it is fast
+class DvbLiveViewStandby : public QObject, public DvbPidFilter
+{
+	Q_OBJECT
+public:
+	DvbLiveViewStandby(DvbManager *manager_, const DvbSharedChannel &channel_,
+		DvbDevice *device_, const QByteArray &pmtSectionData_, QObject *parent);
+	~DvbLiveViewStandby();
+
+	// NULL if the device has been taken by a recording
+	DvbDevice *getDevice() const
+	{
+		return device;
+	}
+
+	// the caller becomes responsible for releasing the device
+	DvbDevice *takeDevice();
+	void releaseDevice();
+
+	DvbSharedChannel channel;
+	QByteArray pmtSectionData; // the most recent pmt (may be empty)
+	TsGopCache gopCache; // only the video pid
+
+private slots:
+	void pmtSectionChanged(const QByteArray &pmtSectionData_);
+	void deviceStateChanged();
+
+private:
+	void processData(const char data[188]);
+	void stopDevice();
+
+	DvbManager *manager;
+	DvbDevice *device;
+	DvbPmtFilter pmtFilter;
+	int videoPid;
+};
+
 class DvbLiveViewInternal : public QObject, public DvbPidFilter, public MediaSource
 {
 	Q_OBJECT
@@ -61,7 +100,13 @@ public:
 	explicit DvbLiveViewInternal(QObject *parent);
 	~DvbLiveViewInternal();
 
-	void resetPipe();
+	// discards the data which hasn't been played yet
+	void resetStream();
+	// discards the data which hasn't been played yet and starts the stream buffer (again)
+	// with the pending pat / pmt and the cached group of pictures
+	void restartStream();
+	// passes complete packets (e.g. a cached group of pictures) like received data
+	void writePackets(const QByteArray &packets);
 
 	MediaWidget *mediaWidget;
 	QString channelName;
@@ -69,8 +114,10 @@ public:
 	QByteArray pmtSectionData;
 	DvbSectionGenerator patGenerator;
 	DvbSectionGenerator pmtGenerator;
-	QByteArray buffer;
-	QFile timeShiftFile;
+	QByteArray buffer; // pending pat / pmt
+	QByteArray batch; // packets which are passed on after the current batch
+	TsGopCache gopCache; // a player which (re)starts gets this first
+	QSharedPointer<DvbTimeShiftBuffer> timeShiftBuffer; // shared with the player
 	DvbOsd dvbOsd;
 
 	bool overrideAudioStreams() const { return !audioStreams.isEmpty(); }
@@ -98,11 +145,30 @@ public:
 
 	Type getType() const { return Dvb; }
 
-	QUrl getUrl() const { return url; }
+	// the time shift buffer is played after resuming (or always if it's always on)
+	QSharedPointer<MediaStream> getStream() const
+	{
+		if (timeshift) {
+			return timeShiftBuffer;
+		}
+
+		return streamBuffer;
+	}
+
+	bool hideCurrentTotalTime() const { return true; }
+
+	bool canSkipStream() const { return timeshift; }
 
-	bool hideCurrentTotalTime() const { return !timeshift; }
+	// the time shift buffer is played with a delay anyway
+	bool preferLowLatency() const { return (lowLatency && !timeshift); }
 
-	bool timeshift;
+	int skipStream(int time)
+	{
+		return timeShiftBuffer->skip(time);
+	}
+
+	bool timeshift; // the player reads the time shift buffer
+	bool lowLatency;
 	QStringList audioStreams;
 	QStringList subtitles;
 	int currentAudioStream;
@@ -117,17 +183,16 @@ signals:
 	void previous();
 	void next();
 
-private slots:
-	void writeToPipe();
-
 private:
+	enum {
+		MaxBatchSize = (348 * 188) // the batch is passed on earlier if it gets larger
+	};
+
 	void processData(const char data[188]);
+	void processBatchEnd();
 
-	QUrl url;
-	int readFd;
-	int writeFd;
-	QSocketNotifier *notifier;
-	QList<QByteArray> buffers;
+	// shared with the player (it may still read while the live view is destroyed)
+	QSharedPointer<MediaStreamBuffer> streamBuffer;
 };
 
 #endif /* DVBLIVEVIEW_P_H */
@@ -33,6 +33,7 @@
 #include "dvbepg.h"
 #include "dvbliveview.h"
 #include "dvbsi.h"
+#include "dvbstreamserver.h"
 #include "../configuration.h"
 
 DvbManager::DvbManager(MediaWidget *mediaWidget_, QWidget *parent_) : QObject(parent_),
@@ -41,7 +42,10 @@ DvbManager::DvbManager(MediaWidget *mediaWidget_, QWidget *parent_) : QObject(pa
 	channelModel = DvbChannelModel::createSqlModel(this);
 	recordingModel = new DvbRecordingModel(this, this);
 	epgModel = new DvbEpgModel(this, this);
+	recordingModel->setEpgModel(epgModel);
 	liveView = new DvbLiveView(this, this);
+	streamServer = new DvbStreamServer(this, this);
+	streamServer->setPort(getStreamingPort());
 
 	readDeviceConfigs();
 	updateSourceMapping();
@@ -59,6 +63,7 @@ DvbManager::~DvbManager()
 
 	delete epgModel;
 	delete recordingModel;
+	delete streamServer;
 
 	foreach (const DvbDeviceConfig &deviceConfig, deviceConfigs) {
 		delete deviceConfig.device;
@@ -347,6 +352,84 @@ int DvbManager::getEndMargin() const
 	return Configuration::instance()->config()->group("DVB").readEntry("EndMargin", 600);
 }
 
+int DvbManager::getPreTuneTime() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("PreTuneTime", 30);
+}
+
+int DvbManager::getWriteSyncPolicy() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("WriteSyncPolicy", 0);
+}
+
+bool DvbManager::isDirectIoEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("DirectIo", false);
+}
+
+int DvbManager::getSegmentSize() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("SegmentSize", 0);
+}
+
+int DvbManager::getSegmentDuration() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("SegmentDuration", 0);
+}
+
+int DvbManager::getSegmentRetention() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("SegmentRetention", 0);
+}
+
+bool DvbManager::isSegmentManifestEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("SegmentManifest", false);
+}
+
+bool DvbManager::isMuxRecordingEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("MuxRecording", false);
+}
+
+bool DvbManager::isMuxExtractionEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("MuxExtraction", true);
+}
+
+int DvbManager::getTimeShiftMemorySize() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("TimeShiftMemorySize",
+		64);
+}
+
+int DvbManager::getTimeShiftFileSize() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("TimeShiftFileSize",
+		2048);
+}
+
+bool DvbManager::isTimeShiftAlwaysOn() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("TimeShiftAlwaysOn",
+		false);
+}
+
+bool DvbManager::isFastZapEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("FastZap", false);
+}
+
+bool DvbManager::isLowLatencyEnabled() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("LowLatencyLive", false);
+}
+
+int DvbManager::getStreamingPort() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("StreamingPort", 0);
+}
+
 QString DvbManager::getNamingFormat() const
 {
 	return Configuration::instance()->config()->group("DVB").readEntry("NamingFormat", "%title");
@@ -367,6 +450,16 @@ QList<int> DvbManager::getRecordingRegexPriorityList() const
 	return Configuration::instance()->config()->group("DVB").readEntry("RecordingRegexPriorityList", QList<int>());
 }
 
+QStringList DvbManager::getRecordingRegexStreamsList() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("RecordingRegexStreamsList", QStringList());
+}
+
+QString DvbManager::getStreamSelection() const
+{
+	return Configuration::instance()->config()->group("DVB").readEntry("StreamSelection", "all");
+}
+
 QString DvbManager::getActionAfterRecording() const
 {
 	return Configuration::instance()->config()->group("DVB").readEntry("ActionAfterRecording", "");
@@ -407,6 +500,109 @@ void DvbManager::setEndMargin(int endMargin)
 	Configuration::instance()->config()->group("DVB").writeEntry("EndMargin", endMargin);
 }
 
+void DvbManager::setPreTuneTime(int preTuneTime)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("PreTuneTime", preTuneTime);
+}
+
+void DvbManager::setWriteSyncPolicy(int writeSyncPolicy)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("WriteSyncPolicy", writeSyncPolicy);
+}
+
+void DvbManager::setDirectIoEnabled(bool directIo)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("DirectIo", directIo);
+}
+
+void DvbManager::setSegmentSize(int segmentSize)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("SegmentSize", segmentSize);
+}
+
+void DvbManager::setSegmentDuration(int segmentDuration)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("SegmentDuration",
+		segmentDuration);
+}
+
+void DvbManager::setSegmentRetention(int segmentRetention)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("SegmentRetention",
+		segmentRetention);
+}
+
+void DvbManager::setSegmentManifestEnabled(bool segmentManifest)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("SegmentManifest",
+		segmentManifest);
+}
+
+void DvbManager::setMuxRecordingEnabled(bool muxRecording)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("MuxRecording", muxRecording);
+}
+
+void DvbManager::setMuxExtractionEnabled(bool muxExtraction)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("MuxExtraction",
+		muxExtraction);
+}
+
+void DvbManager::setTimeShiftMemorySize(int timeShiftMemorySize)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("TimeShiftMemorySize",
+		timeShiftMemorySize);
+}
+
+void DvbManager::setTimeShiftFileSize(int timeShiftFileSize)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("TimeShiftFileSize",
+		timeShiftFileSize);
+}
+
+void DvbManager::setTimeShiftAlwaysOn(bool timeShiftAlwaysOn)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("TimeShiftAlwaysOn",
+		timeShiftAlwaysOn);
+}
+
+void DvbManager::setFastZapEnabled(bool fastZap)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("FastZap", fastZap);
+}
+
+void DvbManager::setLowLatencyEnabled(bool lowLatency)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("LowLatencyLive", lowLatency);
+}
+
+void DvbManager::setStreamingPort(int streamingPort)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("StreamingPort",
+		streamingPort);
+	streamServer->setPort(streamingPort);
+}
+
+qint64 DvbManager::getChannelBitrate(const QString &channelName) const
+{
+	// unknown channels are assumed to be hd channels (about 8 MBit/s)
+	return Configuration::instance()->config()->group("DVB Bitrates").readEntry(channelName,
+		Q_INT64_C(1000000));
+}
+
+void DvbManager::updateChannelBitrate(const QString &channelName, qint64 bitrate)
+{
+	KConfigGroup group = Configuration::instance()->config()->group("DVB Bitrates");
+
+	if (group.hasKey(channelName)) {
+		// smooth out differences between programs
+		bitrate = ((3 * group.readEntry(channelName, bitrate) + bitrate) / 4);
+	}
+
+	group.writeEntry(channelName, bitrate);
+}
+
 void DvbManager::setNamingFormat(QString namingFormat)
 {
 	Configuration::instance()->config()->group("DVB").writeEntry("NamingFormat", namingFormat);
@@ -427,6 +623,16 @@ void DvbManager::setRecordingRegexPriorityList(const QList<int> regexList)
 	Configuration::instance()->config()->group("DVB").writeEntry("RecordingRegexPriorityList", regexList);
 }
 
+void DvbManager::setRecordingRegexStreamsList(const QStringList &streamsList)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("RecordingRegexStreamsList", streamsList);
+}
+
+void DvbManager::setStreamSelection(const QString &streams)
+{
+	Configuration::instance()->config()->group("DVB").writeEntry("StreamSelection", streams);
+}
+
 bool DvbManager::addRecordingRegex(QString regex)
 {
 	QStringList regexList = getRecordingRegexList();
@@ -905,7 +1111,7 @@ bool DvbManager::readScanSources(DvbScanData &data, const char *tag, Transmissio
 
 DvbDeviceConfig::DvbDeviceConfig(const QString &deviceId_, const QString &frontendName_,
 	DvbDevice *device_) : deviceId(deviceId_), frontendName(frontendName_), device(device_),
-	useCount(0), prioritizedUseCount(0)
+	useCount(0), prioritizedUseCount(0), numberOfTuners(1)
 {
 }
 
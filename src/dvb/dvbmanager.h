@@ -39,6 +39,7 @@ class DvbEpgModel;
 class DvbLiveView;
 class DvbRecordingModel;
 class DvbScanData;
+class DvbStreamServer;
 class MediaWidget;
 
 class DvbManager : public QObject
@@ -102,6 +103,11 @@ public:
 		return recordingModel;
 	}
 
+	DvbStreamServer *getStreamServer() const
+	{
+		return streamServer;
+	}
+
 	void setChannelView(QTreeView *channelView_)
 	{
 		channelView = channelView_;
@@ -127,9 +133,31 @@ public:
 	QString getRecordingRegex() const;
 	QStringList getRecordingRegexList() const;
 	QList<int> getRecordingRegexPriorityList() const;
+	QStringList getRecordingRegexStreamsList() const; // see DvbStreamSelection
+	QString getStreamSelection() const; // default for recordings; see DvbStreamSelection
 	QString getActionAfterRecording() const;
 	int getBeginMargin() const; // seconds
 	int getEndMargin() const; // seconds
+	int getPreTuneTime() const; // seconds
+	int getWriteSyncPolicy() const; // see DvbTsWriter::SyncPolicy
+	bool isDirectIoEnabled() const;
+	int getSegmentSize() const; // MiB; 0 = no size limit
+	int getSegmentDuration() const; // minutes; 0 = no duration limit
+	int getSegmentRetention() const; // number of segments to keep; 0 = keep all
+	bool isSegmentManifestEnabled() const;
+	// overlapping recordings on a transponder are written into one file
+	bool isMuxRecordingEnabled() const;
+	// the recordings are extracted from the transponder recording afterwards
+	bool isMuxExtractionEnabled() const;
+	int getTimeShiftMemorySize() const; // MiB
+	int getTimeShiftFileSize() const; // MiB; 0 = only memory is used
+	// the live view always keeps a time shift buffer (instead of starting it on pause)
+	bool isTimeShiftAlwaysOn() const;
+	// the neighbouring channels are kept tuned on idle devices
+	bool isFastZapEnabled() const;
+	// live tv is played with as little caching as possible (adapted to stalls)
+	bool isLowLatencyEnabled() const;
+	int getStreamingPort() const; // 0 = the stream server is disabled
 	bool override6937Charset() const;
 	bool createInfoFile() const;
 	bool isScanWhenIdle() const;
@@ -139,6 +167,8 @@ public:
 	void setRecordingRegex(const QString regex);
 	void setRecordingRegexList(const QStringList regexList);
 	void setRecordingRegexPriorityList(const QList<int> regexList);
+	void setRecordingRegexStreamsList(const QStringList &streamsList);
+	void setStreamSelection(const QString &streams);
 	bool removeRecordingRegex(QString regex);
 	bool addRecordingRegex(QString regex);
 	bool removeRecordingRegexPriority(int priority);
@@ -146,6 +176,24 @@ public:
 	void setActionAfterRecording(const QString actionAfterRecording);
 	void setBeginMargin(int beginMargin); // seconds
 	void setEndMargin(int endMargin); // seconds
+	void setPreTuneTime(int preTuneTime); // seconds
+	void setWriteSyncPolicy(int writeSyncPolicy);
+	void setDirectIoEnabled(bool directIo);
+	void setSegmentSize(int segmentSize); // MiB
+	void setSegmentDuration(int segmentDuration); // minutes
+	void setSegmentRetention(int segmentRetention);
+	void setSegmentManifestEnabled(bool segmentManifest);
+	void setMuxRecordingEnabled(bool muxRecording);
+	void setMuxExtractionEnabled(bool muxExtraction);
+	void setTimeShiftMemorySize(int timeShiftMemorySize); // MiB
+	void setTimeShiftFileSize(int timeShiftFileSize); // MiB
+	void setTimeShiftAlwaysOn(bool timeShiftAlwaysOn);
+	void setFastZapEnabled(bool fastZap);
+	void setLowLatencyEnabled(bool lowLatency);
+	void setStreamingPort(int streamingPort);
+	// learned from previous recordings of the channel (bytes per second)
+	qint64 getChannelBitrate(const QString &channelName) const;
+	void updateChannelBitrate(const QString &channelName, qint64 bitrate);
 	void setOverride6937Charset(bool override);
 	void setCreateInfoFile(bool createInfoFile);
 	void setScanWhenIdle(bool scanWhenIdle);
@@ -180,6 +228,7 @@ private:
 	DvbEpgModel *epgModel;
 	DvbLiveView *liveView;
 	DvbRecordingModel *recordingModel;
+	DvbStreamServer *streamServer;
 
 	QList<DvbDeviceConfig> deviceConfigs;
 	bool dvbDumpEnabled;
@@ -0,0 +1,191 @@
+/*
+ * dvbmultiview.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbmultiview.h"
+#include "dvbmultiview_p.h"
+
+#include <QBoxLayout>
+#include <QCheckBox>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QGridLayout>
+#include <QLabel>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include "../abstractmediawidget.h"
+#include "../backend-vlc/vlcmediawidget.h"
+#include "dvbchannel.h"
+#include "dvbmanager.h"
+
+DvbMultiViewDialog::DvbMultiViewDialog(DvbManager *manager_, QWidget *parent) :
+	QDialog(parent), manager(manager_)
+{
+	setWindowTitle(i18nc("@title:window", "Multi View"));
+
+	QBoxLayout *mainLayout = new QVBoxLayout(this);
+	QBoxLayout *boxLayout = new QHBoxLayout();
+	boxLayout->addWidget(new QLabel(i18nc("@label:listbox", "Views:")));
+
+	QComboBox *viewCountBox = new QComboBox(this);
+	viewCountBox->addItem(i18nc("multi view", "1"), 1);
+	viewCountBox->addItem(i18nc("multi view", "2 (side by side)"), 2);
+	viewCountBox->addItem(i18nc("multi view", "4 (2 x 2)"), 4);
+	viewCountBox->addItem(i18nc("multi view", "9 (3 x 3)"), 9);
+	viewCountBox->setCurrentIndex(2);
+	connect(viewCountBox, SIGNAL(currentIndexChanged(int)), this, SLOT(viewCountChanged(int)));
+	boxLayout->addWidget(viewCountBox);
+	boxLayout->addStretch();
+	mainLayout->addLayout(boxLayout);
+
+	gridLayout = new QGridLayout();
+	mainLayout->addLayout(gridLayout, 1);
+
+	QDialogButtonBox *buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
+	connect(buttonBox, SIGNAL(rejected()), this, SLOT(reject()));
+	mainLayout->addWidget(buttonBox);
+
+	viewCountChanged(viewCountBox->currentIndex());
+	resize(800, 600);
+}
+
+DvbMultiViewDialog::~DvbMultiViewDialog()
+{
+}
+
+void DvbMultiViewDialog::viewCountChanged(int index)
+{
+	QComboBox *viewCountBox = qobject_cast<QComboBox *>(sender());
+	int viewCount = 4;
+
+	if (viewCountBox != NULL) {
+		viewCount = viewCountBox->itemData(index).toInt();
+	}
+
+	while (players.size() > viewCount) {
+		delete players.takeLast();
+	}
+
+	while (players.size() < viewCount) {
+		players.append(new DvbMultiViewPlayer(manager, this));
+	}
+
+	int columnCount = ((viewCount <= 4) ? qMin(viewCount, 2) : 3);
+
+	for (int i = 0; i < players.size(); ++i) {
+		gridLayout->addWidget(players.at(i), i / columnCount, i % columnCount);
+	}
+}
+
+DvbMultiViewPlayer::DvbMultiViewPlayer(DvbManager *manager_, QWidget *parent) : QWidget(parent),
+	manager(manager_), server(manager_->getStreamServer()),
+	streamBuffer(new MediaStreamBuffer()), active(false)
+{
+	QBoxLayout *mainLayout = new QVBoxLayout(this);
+	mainLayout->setMargin(0);
+	QBoxLayout *boxLayout = new QHBoxLayout();
+
+	channelBox = new QComboBox(this);
+	channelBox->addItem(QString());
+
+	foreach (const DvbSharedChannel &channel, manager->getChannelModel()->getChannels()) {
+		channelBox->addItem(QString(QLatin1String("%1 - %2")).arg(channel->number).arg(
+			channel->name), channel->number);
+	}
+
+	connect(channelBox, SIGNAL(activated(int)), this, SLOT(channelActivated(int)));
+	boxLayout->addWidget(channelBox, 1);
+
+	audioBox = new QCheckBox(i18nc("multi view", "Audio"), this);
+	connect(audioBox, SIGNAL(toggled(bool)), this, SLOT(audioToggled(bool)));
+	boxLayout->addWidget(audioBox);
+	mainLayout->addLayout(boxLayout);
+
+	backend = VlcMediaWidget::createVlcMediaWidget(this);
+
+	if (backend == NULL) {
+		backend = new DummyMediaWidget(this);
+	}
+
+	// only the views which are explicitly selected are audible
+	backend->setMuted(true);
+	mainLayout->addWidget(backend, 1);
+}
+
+DvbMultiViewPlayer::~DvbMultiViewPlayer()
+{
+	stop();
+}
+
+void DvbMultiViewPlayer::writePackets(const char *data, int size, bool randomAccess)
+{
+	Q_UNUSED(randomAccess)
+	streamBuffer->write(data, size);
+}
+
+void DvbMultiViewPlayer::serviceStopped()
+{
+	channelBox->setCurrentIndex(0);
+	QMetaObject::invokeMethod(this, "stop", Qt::QueuedConnection);
+}
+
+bool DvbMultiViewPlayer::preferLowLatency() const
+{
+	return manager->isLowLatencyEnabled();
+}
+
+void DvbMultiViewPlayer::channelActivated(int index)
+{
+	stop();
+	DvbSharedChannel channel = manager->getChannelModel()->findChannelByNumber(
+		channelBox->itemData(index).toInt());
+
+	if ((index <= 0) || !channel.isValid() || server.isNull()) {
+		return;
+	}
+
+	if (!server->addClient(channel, this)) {
+		channelBox->setCurrentIndex(0);
+		KMessageBox::information(this, i18nc("@info", "No device found."));
+		return;
+	}
+
+	active = true;
+	backend->play(*this);
+}
+
+void DvbMultiViewPlayer::audioToggled(bool audio)
+{
+	backend->setMuted(!audio);
+}
+
+void DvbMultiViewPlayer::stop()
+{
+	if (!active) {
+		return;
+	}
+
+	active = false;
+	backend->stop();
+	streamBuffer->flush();
+
+	if (!server.isNull()) {
+		server->removeClient(this);
+	}
+}
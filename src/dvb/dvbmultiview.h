@@ -0,0 +1,49 @@
+/*
+ * dvbmultiview.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBMULTIVIEW_H
+#define DVBMULTIVIEW_H
+
+#include <QDialog>
+
+class QGridLayout;
+class DvbManager;
+class DvbMultiViewPlayer;
+
+// several live views side by side (picture in picture or mosaic); each view has its own
+// player and stream buffer and is a client of the stream server (see DvbStreamServer)
+
+class DvbMultiViewDialog : public QDialog
+{
+	Q_OBJECT
+public:
+	DvbMultiViewDialog(DvbManager *manager_, QWidget *parent);
+	~DvbMultiViewDialog();
+
+private slots:
+	void viewCountChanged(int index);
+
+private:
+	DvbManager *manager;
+	QGridLayout *gridLayout;
+	QList<DvbMultiViewPlayer *> players;
+};
+
+#endif /* DVBMULTIVIEW_H */
@@ -0,0 +1,71 @@
+/*
+ * dvbmultiview_p.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBMULTIVIEW_P_H
+#define DVBMULTIVIEW_P_H
+
+#include <QPointer>
+#include <QWidget>
+#include "../mediastreambuffer.h"
+#include "../mediawidget.h"
+#include "dvbstreamserver.h"
+
+class QCheckBox;
+class QComboBox;
+class AbstractMediaWidget;
+class DvbManager;
+
+class DvbMultiViewPlayer : public QWidget, public DvbStreamClient, public MediaSource
+{
+	Q_OBJECT
+public:
+	DvbMultiViewPlayer(DvbManager *manager_, QWidget *parent);
+	~DvbMultiViewPlayer();
+
+	void writePackets(const char *data, int size, bool randomAccess);
+	void serviceStopped();
+
+	Type getType() const { return Dvb; }
+
+	QSharedPointer<MediaStream> getStream() const
+	{
+		return streamBuffer;
+	}
+
+	bool hideCurrentTotalTime() const { return true; }
+	bool preferLowLatency() const;
+
+private slots:
+	void channelActivated(int index);
+	void audioToggled(bool audio);
+	void stop();
+
+private:
+	DvbManager *manager;
+	QPointer<DvbStreamServer> server; // may be deleted first during shutdown
+	QComboBox *channelBox;
+	QCheckBox *audioBox;
+	AbstractMediaWidget *backend;
+	// shared with the player (it may still read while this view is destroyed)
+	QSharedPointer<MediaStreamBuffer> streamBuffer;
+	bool active;
+};
+
+#endif /* DVBMULTIVIEW_P_H */
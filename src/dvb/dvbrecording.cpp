@@ -22,14 +22,21 @@
 #include "dvbrecording_p.h"
 
 #include <QDir>
+#include <QFile>
+#include <QFileInfo>
 #include <QMap>
 #include <QProcess>
 #include <QSet>
+#include <QStorageInfo>
 #include <QCoreApplication>
 #include <QEventLoop>
 #include <QVariant>
 #include <QStandardPaths>
 #include <QDataStream>
+#include <KIO/Global>
+#include <KLocalizedString>
+#include <KMessageBox>
+#include <algorithm>
 #include "../ensurenopendingoperation.h"
 #include "../log.h"
 #include "dvbdevice.h"
@@ -38,6 +45,111 @@
 #include "dvbtab.h"
 #include "dvbliveview.h"
 
+DvbStreamSelection::DvbStreamSelection(const QString &string) : dropAudioDescription(false),
+	dropTeletext(false)
+{
+	foreach (const QString &token, string.split(QLatin1Char(' '), QString::SkipEmptyParts)) {
+		if (token.startsWith(QLatin1String("audio:"))) {
+			audioLanguages = token.mid(6).toLower().split(QLatin1Char(','),
+				QString::SkipEmptyParts);
+		} else if (token.startsWith(QLatin1String("sub:"))) {
+			subtitleLanguage = token.mid(4).toLower();
+		} else if (token == QLatin1String("noad")) {
+			dropAudioDescription = true;
+		} else if (token == QLatin1String("notext")) {
+			dropTeletext = true;
+		} else if (token != QLatin1String("all")) {
+			Log("DvbStreamSelection::DvbStreamSelection: unknown token") << token;
+		}
+	}
+}
+
+QString DvbStreamSelection::toString() const
+{
+	QStringList tokens;
+
+	if (!audioLanguages.isEmpty()) {
+		tokens.append(QLatin1String("audio:") + audioLanguages.join(QLatin1String(",")));
+	}
+
+	if (dropAudioDescription) {
+		tokens.append(QLatin1String("noad"));
+	}
+
+	if (dropTeletext) {
+		tokens.append(QLatin1String("notext"));
+	}
+
+	if (!subtitleLanguage.isEmpty()) {
+		tokens.append(QLatin1String("sub:") + subtitleLanguage);
+	}
+
+	if (tokens.isEmpty()) {
+		return QLatin1String("all");
+	}
+
+	return tokens.join(QLatin1String(" "));
+}
+
+QList<int> DvbStreamSelection::selectPids(const DvbPmtParser &pmtParser) const
+{
+	QList<int> pids;
+
+	if (pmtParser.videoPid != -1) {
+		pids.append(pmtParser.videoPid);
+	}
+
+	QList<int> audioPids;
+
+	for (int i = 0; i < pmtParser.audioPids.size(); ++i) {
+		int pid = pmtParser.audioPids.at(i).first;
+
+		if (!dropAudioDescription || !pmtParser.audioDescriptionPids.contains(pid)) {
+			audioPids.append(pid);
+		}
+	}
+
+	if (!audioLanguages.isEmpty()) {
+		QList<int> preferredPids;
+
+		for (int i = 0; i < pmtParser.audioPids.size(); ++i) {
+			const QPair<int, QString> &audioPid = pmtParser.audioPids.at(i);
+
+			if (audioPids.contains(audioPid.first) &&
+			    audioLanguages.contains(audioPid.second.toLower())) {
+				preferredPids.append(audioPid.first);
+			}
+		}
+
+		// never record a service without sound
+		if (!preferredPids.isEmpty()) {
+			audioPids = preferredPids;
+		}
+	}
+
+	if (audioPids.isEmpty() && !pmtParser.audioPids.isEmpty()) {
+		// there are only audio description streams
+		audioPids.append(pmtParser.audioPids.at(0).first);
+	}
+
+	pids += audioPids;
+
+	for (int i = 0; i < pmtParser.subtitlePids.size(); ++i) {
+		const QPair<int, QString> &subtitlePid = pmtParser.subtitlePids.at(i);
+
+		if (subtitleLanguage.isEmpty() ||
+		    (subtitlePid.second.toLower() == subtitleLanguage)) {
+			pids.append(subtitlePid.first);
+		}
+	}
+
+	if ((pmtParser.teletextPid != -1) && !dropTeletext) {
+		pids.append(pmtParser.teletextPid);
+	}
+
+	return pids;
+}
+
 bool DvbRecording::validate()
 {
 	if (!name.isEmpty() && channel.isValid() && begin.isValid() &&
@@ -54,18 +166,38 @@ bool DvbRecording::validate()
 	return false;
 }
 
+static bool hasSqlChanges(const DvbRecording &x, const DvbRecording &y)
+{
+	return ((x.name != y.name) || (x.channel != y.channel) || (x.begin != y.begin) ||
+		(x.duration != y.duration) || (x.repeat != y.repeat) ||
+		(x.subheading != y.subheading) || (x.details != y.details) ||
+		(x.beginEPG != y.beginEPG) || (x.endEPG != y.endEPG) ||
+		(x.durationEPG != y.durationEPG) || (x.priority != y.priority) ||
+		(x.disabled != y.disabled) || (x.streams != y.streams));
+}
+
+static bool deadlineGreaterThan(const DvbRecordingDeadline &x, const DvbRecordingDeadline &y)
+{
+	return (x.dateTime > y.dateTime);
+}
+
 DvbRecordingModel::DvbRecordingModel(DvbManager *manager_, QObject *parent) : QObject(parent),
 	manager(manager_), hasPendingOperation(false)
 {
+	autoRecorder = new DvbAutoRecorder(manager, this);
+
+	// the status of the recordings is checked exactly when needed; the device is
+	// requested in advance, so that the recording can start on time
+
+	deadlineTimer.setSingleShot(true);
+	deadlineTimer.setTimerType(Qt::PreciseTimer);
+	connect(&deadlineTimer, SIGNAL(timeout()), this, SLOT(processDeadlines()));
+
 	sqlInit(QLatin1String("RecordingSchedule"),
 		QStringList() << QLatin1String("Name") << QLatin1String("Channel") << QLatin1String("Begin") <<
 		QLatin1String("Duration") << QLatin1String("Repeat") << QLatin1String("Subheading") << QLatin1String("Details")
-		<< QLatin1String("beginEPG") << QLatin1String("endEPG") << QLatin1String("durationEPG") << QLatin1String("Priority") << QLatin1String("Disabled"));
-
-	// we regularly recheck the status of the recordings
-	// this way we can keep retrying if the device was busy / tuning failed
-
-	startTimer(5000);
+		<< QLatin1String("beginEPG") << QLatin1String("endEPG") << QLatin1String("durationEPG") << QLatin1String("Priority") << QLatin1String("Disabled")
+		<< QLatin1String("Streams"));
 
 	// compatibility code
 
@@ -133,6 +265,11 @@ DvbRecordingModel::~DvbRecordingModel()
 		Log("DvbRecordingModel::~DvbRecordingModel: illegal recursive call");
 	}
 
+	foreach (DvbMuxExtractor *extractor, muxExtractors) {
+		extractor->cancel();
+	}
+
+	qDeleteAll(muxExtractors);
 	sqlFlush();
 }
 
@@ -196,7 +333,18 @@ DvbSharedRecording DvbRecordingModel::addRecording(DvbRecording &recording, bool
 	DvbSharedRecording newRecording(new DvbRecording(recording));
 	recordings.insert(*newRecording, newRecording);
 	sqlInsert(*newRecording);
+	scheduleDeadline(*newRecording);
 	emit recordingAdded(newRecording);
+
+	qint64 neededSpace;
+	qint64 availableSpace;
+	DvbSharedRecording shortfall = findSpaceShortfall(neededSpace, availableSpace);
+
+	if (shortfall.isValid()) {
+		Log("DvbRecordingModel::addRecording: not enough disk space for") << shortfall->name <<
+			neededSpace << availableSpace;
+	}
+
 	return newRecording;
 }
 
@@ -221,14 +369,22 @@ void DvbRecordingModel::updateRecording(DvbSharedRecording recording,
 	if (!updateStatus(modifiedRecording)) {
 		recordings.remove(*recording);
 		recordingFiles.remove(*recording);
+		currentDeadlines.remove(*recording);
 		sqlRemove(*recording);
 		emit recordingRemoved(recording);
 		return;
 	}
 
+	// status changes don't have to be written to the database
+	bool sqlChanged = hasSqlChanges(*recording, modifiedRecording);
 	emit recordingAboutToBeUpdated(recording);
 	*const_cast<DvbRecording *>(recording.constData()) = modifiedRecording;
-	sqlUpdate(*recording);
+
+	if (sqlChanged) {
+		sqlUpdate(*recording);
+	}
+
+	scheduleDeadline(*recording);
 	emit recordingUpdated(recording);
 }
 
@@ -248,32 +404,17 @@ void DvbRecordingModel::removeRecording(DvbSharedRecording recording)
 
 	recordings.remove(*recording);
 	recordingFiles.remove(*recording);
+	currentDeadlines.remove(*recording);
 	sqlRemove(*recording);
 	emit recordingRemoved(recording);
 	executeActionAfterRecording(*recording);
 	findNewRecordings();
-	removeDuplicates();
-	disableConflicts();
-}
-
-
-void DvbRecordingModel::disableLessImportant(DvbSharedRecording &recording1, DvbSharedRecording &recording2)
-{
-	if (recording1->priority < recording2->priority) {
-		DvbRecording rec1 = *(recording1.constData());
-		rec1.disabled = true;
-		Log("DvbRecordingModel::disableLessImportant disabled") << recording1->name;
-	}
-	if (recording2->priority < recording1->priority) {
-		DvbRecording rec2 = *(recording1.constData());
-		rec2.disabled = true;
-		Log("DvbRecordingModel::disableLessImportant disabled") << recording2->name;
-	}
 }
 
 void DvbRecordingModel::addToUnwantedRecordings(DvbSharedRecording recording)
 {
 	unwantedRecordings.append(recording);
+	autoRecorder->invalidateIndex();
 	Log("DvbRecordingModel::addToUnwantedRecordings executed") << recording->name;
 }
 
@@ -293,259 +434,329 @@ void DvbRecordingModel::executeActionAfterRecording(DvbRecording recording)
 
 }
 
+void DvbRecordingModel::executeActionAfterClosing(const QString &fileName,
+	const DvbRecording &recording)
+{
+	closingRecordingFiles.insert(fileName, recording);
+}
+
+void DvbRecordingModel::recordingFileClosed(const QString &fileName)
+{
+	QMap<QString, DvbRecording>::Iterator it = closingRecordingFiles.find(fileName);
+
+	if (it != closingRecordingFiles.end()) {
+		DvbRecording recording = *it;
+		closingRecordingFiles.erase(it);
+		executeActionAfterRecording(recording);
+	}
+}
+
 void DvbRecordingModel::removeDuplicates()
 {
-	QList<DvbSharedRecording> recordingList = QList<DvbSharedRecording>();
 	DvbEpgModel *epgModel = manager->getEpgModel();
 	QMap<DvbSharedRecording, DvbSharedEpgEntry> recordingMap = epgModel->getRecordings();
-	foreach(DvbSharedRecording key, recordings.values())
-	{
-		recordingList.append(key);
-	}
-	int i = 0;
-	foreach(DvbSharedRecording rec1, recordingList)
-	{
-		int j = 0;
-		DvbRecording loopEntry1 = *rec1;
-		foreach(DvbSharedRecording rec2, recordingList)
-		{
-			DvbRecording loopEntry2 = *rec2;
-			if (i < j) {
-				if (loopEntry1.begin == loopEntry2.begin
-					&& loopEntry1.duration == loopEntry2.duration
-					&& loopEntry1.channel->name == loopEntry2.channel->name
-					&& loopEntry1.name == loopEntry2.name) {
-					recordings.remove(recordings.key(rec1));
-					recordingMap.remove(rec1);
-					Log("DvbRecordingModel::removeDuplicates removed.") << loopEntry1.name;
-				}
-			}
-			j = j + 1;
+	QHash<QString, DvbSharedRecording> uniqueRecordings;
+	QList<DvbSharedRecording> duplicates;
+
+	// the last one of equal recordings is kept
+	foreach (const DvbSharedRecording &recording, recordings) {
+		QString key = recording->channel->name + QLatin1Char('\n') +
+			QString::number(recording->begin.toMSecsSinceEpoch()) + QLatin1Char('\n') +
+			QString::number(QTime().msecsTo(recording->duration)) + QLatin1Char('\n') +
+			recording->name;
+		DvbSharedRecording &uniqueRecording = uniqueRecordings[key];
+
+		if (uniqueRecording.isValid()) {
+			duplicates.append(uniqueRecording);
 		}
-		i = i + 1;
+
+		uniqueRecording = recording;
+	}
+
+	if (duplicates.isEmpty()) {
+		return;
 	}
-	epgModel->setRecordings(recordingMap);
 
-	Log("DvbRecordingModel::removeDuplicates executed.");
+	foreach (const DvbSharedRecording &recording, duplicates) {
+		recordings.remove(*recording);
+		recordingMap.remove(recording);
+		Log("DvbRecordingModel::removeDuplicates removed.") << recording->name;
+	}
+
+	epgModel->setRecordings(recordingMap);
+	autoRecorder->invalidateIndex();
 }
 
-bool DvbRecordingModel::existsSimilarRecording(DvbEpgEntry recording)
+static bool schedulingLessThan(const DvbSharedRecording &x, const DvbSharedRecording &y)
 {
-	bool found = false;
+	// running recordings can't be disabled anymore
+	bool xRecording = (x->status == DvbRecording::Recording);
+	bool yRecording = (y->status == DvbRecording::Recording);
 
-	DvbEpgEntry entry = recording;
-	DvbEpgModel *epgModel = manager->getEpgModel();
-	QMap<DvbSharedRecording, DvbSharedEpgEntry> recordingMap = epgModel->getRecordings();
-	foreach(DvbSharedRecording key, recordingMap.keys())
-	{
-		DvbEpgEntry loopEntry = *(recordingMap.value(key));
-		int loopLength = 60 * 60 * loopEntry.duration.hour() + 60 * loopEntry.duration.minute() + loopEntry.duration.second();
-		int length = 60 * 60 * entry.duration.hour() + 60 * entry.duration.minute() + entry.duration.second();
-		QDateTime end = entry.begin.addSecs(length);
-		QDateTime loopEnd = loopEntry.begin.addSecs(loopLength);
-
-		if (QString::compare(entry.channel->name, loopEntry.channel->name) == 0) {
-			// Is included in an existing recording
-			if (entry.begin <= loopEntry.begin && end >= loopEnd) {
-				found = true;
-				break;
-			// Includes an existing recording
-			} else if (entry.begin >= loopEntry.begin && end <= loopEnd) {
-				found = true;
-				break;
-			}
-		}
+	if (xRecording != yRecording) {
+		return xRecording;
 	}
 
-	QList<DvbSharedRecording> unwantedRecordingsList = manager->getRecordingModel()->getUnwantedRecordings();
-
-	foreach(DvbSharedRecording unwanted, unwantedRecordingsList)
-	{
-		DvbRecording loopEntry = *unwanted;
-		if (QString::compare(entry.begin.toString(), ((loopEntry.begin.addSecs(manager->getBeginMargin()))).toString()) == 0
-				&& QString::compare(entry.channel->name, loopEntry.channel->name) == 0
-				&& QString::compare((entry.duration).toString(),
-						loopEntry.duration.addSecs(- manager->getBeginMargin() - manager->getEndMargin()).toString()) == 0) {
-			Log("DvbRecordingModel::existsSimilarRecording Found from unwanteds ") << loopEntry.name;
-			found = true;
-			break;
-		}
+	if (x->priority != y->priority) {
+		return (x->priority > y->priority);
 	}
 
-	return found;
+	return (x->begin < y->begin);
 }
 
 void DvbRecordingModel::disableConflicts()
 {
-	int maxSize = 1; // manager->getDeviceConfigs().size();
-	// foreach(DvbDeviceConfig config, manager->getDeviceConfigs())
-	// {
-	//	maxSize = maxSize + config.numberOfTuners;
-	// }
+	DvbRecordingScheduler scheduler(manager->getDeviceConfigs());
 
-	QList<DvbSharedRecording> recordingList = QList<DvbSharedRecording>();
-	foreach(DvbSharedRecording rec, recordings.values())
-	{
-		if (!(rec->disabled)) {
-			recordingList.append(rec);
-		}
+	if (!scheduler.hasTuners()) {
+		return;
 	}
 
-	foreach(DvbSharedRecording rec1, recordingList)
-	{
-		QList<DvbSharedRecording> conflictList = QList<DvbSharedRecording>();
-		conflictList.append(rec1);
+	QDateTime currentDateTime = QDateTime::currentDateTime().toUTC();
+	QList<DvbSharedRecording> recordingList;
 
-		foreach(DvbSharedRecording rec2, recordingList)
-		{
-			if (isInConflictWithAll(rec2, conflictList)) {
-				conflictList.append(rec2);
-				Log("DvbRecordingModel::disableConflicts:") << rec1->name << rec1->begin.toString() <<
-						" and " << rec2->name << rec2->begin.toString();
+	foreach (const DvbSharedRecording &recording, recordings) {
+		if (!recording->disabled && (recording->end > currentDateTime)) {
+			recordingList.append(recording);
+		}
+	}
 
-			}
+	// recordings are added by priority; a recording is only disabled if there's no
+	// assignment of it and all more important recordings to the tuners
+	std::sort(recordingList.begin(), recordingList.end(), schedulingLessThan);
 
-		}
-		if (conflictList.size() > maxSize) {
-			disableLeastImportants(conflictList);
+	foreach (const DvbSharedRecording &recording, recordingList) {
+		if (!scheduler.add(recording)) {
+			DvbRecording modifiedRecording = *recording;
+			modifiedRecording.disabled = true;
+			updateRecording(recording, modifiedRecording);
+			Log("DvbRecordingModel::disableConflicts: disabled") << recording->name <<
+				recording->begin.toString();
 		}
 	}
-
 }
 
-
 bool DvbRecordingModel::areInConflict(DvbSharedRecording recording1, DvbSharedRecording recording2)
 {
-	int length1 = 60 * 60 * recording1->duration.hour() + 60 * recording1->duration.minute() + recording1->duration.second();
-	QDateTime end1 = recording1->begin.addSecs(length1);
-	int length2 = 60 * 60 * recording2->duration.hour() + 60 * recording2->duration.minute() + recording2->duration.second();
-	QDateTime end2 = recording2->begin.addSecs(length2);
-	if (!recording1->disabled && !recording1->disabled) {
-		if (recording1->channel->transportStreamId != recording2->channel->transportStreamId) {
-			if (recording2->begin > recording1->begin && recording2->begin < end1) {
-				return true;
-			}
-			if (recording1->begin > recording2->begin && recording1->begin < end2) {
-				return true;
-			}
+	if (!recording1->disabled && !recording2->disabled) {
+		if ((recording1->channel->source != recording2->channel->source) ||
+		    !recording1->channel->transponder.corresponds(recording2->channel->transponder)) {
+			return ((recording1->begin < recording2->end) &&
+				(recording2->begin < recording1->end));
 		}
 	}
+
 	return false;
 }
-bool DvbRecordingModel::isInConflictWithAll(DvbSharedRecording rec, QList<DvbSharedRecording> recList)
-{
 
-	foreach(DvbSharedRecording listRec, recList)
-	{
-		if (!areInConflict(rec, listRec)) {
-			return false;
+bool DvbRecordingModel::hasOverlappingRecordings(const DvbRecording &recording) const
+{
+	foreach (const DvbSharedRecording &otherRecording, recordings) {
+		if ((*otherRecording != recording) && !otherRecording->disabled &&
+		    (otherRecording->channel->source == recording.channel->source) &&
+		    otherRecording->channel->transponder.corresponds(
+		    recording.channel->transponder) &&
+		    (otherRecording->begin < recording.end) &&
+		    (recording.begin < otherRecording->end)) {
+			return true;
 		}
 	}
 
-	return true;
+	return false;
 }
 
-int DvbRecordingModel::getNumberOfLeastImportants(QList<DvbSharedRecording> recList)
+DvbMuxRecording *DvbRecordingModel::acquireMuxRecording(const DvbSharedChannel &channel)
 {
-	DvbSharedRecording leastImportantShared = getLeastImportant(recList);
-	int leastImportance = leastImportantShared->priority;
-	int count = 0;
-	foreach(DvbSharedRecording listRecShared, recList)
-	{
-		if (listRecShared->priority == leastImportance) {
-			count = count + 1;
+	DvbMuxRecording *muxRecording = NULL;
+
+	foreach (DvbMuxRecording *existingMuxRecording, muxRecordings) {
+		const DvbSharedChannel &muxChannel = existingMuxRecording->getChannel();
+
+		if ((muxChannel->source == channel->source) &&
+		    muxChannel->transponder.corresponds(channel->transponder)) {
+			muxRecording = existingMuxRecording;
+			break;
+		}
+	}
+
+	if (muxRecording == NULL) {
+		muxRecording = new DvbMuxRecording(manager);
+
+		if (!muxRecording->open(channel)) {
+			delete muxRecording;
+			return NULL;
 		}
+
+		muxRecordings.append(muxRecording);
 	}
 
-	return count;
+	muxRecording->addRecording(channel->pmtPid);
+	return muxRecording;
 }
 
-DvbSharedRecording DvbRecordingModel::getLeastImportant(QList<DvbSharedRecording> recList)
+void DvbRecordingModel::releaseMuxRecording(DvbMuxRecording *muxRecording,
+	const DvbMuxRecordingJob &job)
 {
-	DvbSharedRecording leastImportant = recList.value(0);
-	foreach(DvbSharedRecording listRec, recList)
-	{
-		Log("DvbRecordingModel::getLeastImportant: name and priority") << listRec->name << listRec->priority;
-		if (listRec->priority < leastImportant->priority) {
-			leastImportant = listRec;
-		}
+	if (muxRecording->removeRecording(job)) {
+		muxRecordings.removeOne(muxRecording);
+		muxRecording->close();
 	}
+}
 
-	Log("DvbRecordingModel::getLeastImportant:") << leastImportant->name;
-	return leastImportant;
+void DvbRecordingModel::extractMuxRecording(const QString &muxFileName,
+	const QList<DvbMuxRecordingJob> &jobs)
+{
+	DvbMuxExtractor *extractor = new DvbMuxExtractor(muxFileName, jobs);
+	connect(extractor, SIGNAL(finished()), this, SLOT(muxExtractorFinished()));
+	muxExtractors.append(extractor);
+	extractor->start();
 }
 
-void DvbRecordingModel::disableLeastImportants(QList<DvbSharedRecording> recList)
+void DvbRecordingModel::muxExtractorFinished()
 {
-	int numberOfLeastImportants = getNumberOfLeastImportants(recList);
-	if (numberOfLeastImportants < recList.size()) {
-		DvbSharedRecording leastImportantShared = getLeastImportant(recList);
-		int leastImportance = leastImportantShared->priority;
+	DvbMuxExtractor *extractor = static_cast<DvbMuxExtractor *>(sender());
 
-		foreach(DvbSharedRecording listRecShared, recList)
-		{
-			DvbRecording listRec = *(listRecShared.constData());
-			if (listRecShared->priority == leastImportance) {
-				listRec.disabled = true;
-				updateRecording(listRecShared, listRec);
-				Log("DvbRecordingModel::disableLeastImportants disabled:") << listRec.name << listRec.begin.toString();
-			}
+	if (!muxExtractors.removeOne(extractor)) {
+		return;
+	}
+
+	// the recordings refer to the transponder recording until they have been extracted
+	QString muxFileName = QFileInfo(extractor->getMuxFileName()).fileName();
+
+	foreach (const DvbMuxRecordingJob &job, extractor->getExtractedJobs()) {
+		DvbSharedRecording recording = recordings.value(job.recordingKey);
+
+		if (recording.isValid() && (recording->filename == muxFileName)) {
+			DvbRecording modifiedRecording = *recording;
+			modifiedRecording.filename = QFileInfo(job.fileName).fileName();
+			updateRecording(recording, modifiedRecording);
 		}
 	}
 
+	delete extractor;
 }
 
-void DvbRecordingModel::findNewRecordings()
+void DvbRecordingModel::setEpgModel(DvbEpgModel *epgModel)
 {
-	DvbEpgModel *epgModel = manager->getEpgModel();
-	QMap<DvbEpgEntryId, DvbSharedEpgEntry> epgMap = epgModel->getEntries();
-	foreach(DvbEpgEntryId key, epgMap.keys())
-	{
-		DvbEpgEntry entry = *(epgMap.value(key));
-		QString title = entry.title;
-		QStringList regexList = manager->getRecordingRegexList();
-		int i = 0;
-		foreach(QString regex, regexList) {
-			QRegExp recordingRegex = QRegExp(regex);
-			if (!recordingRegex.isEmpty())
-				{
-				if (recordingRegex.indexIn(title) != -1)
-				{
-					if (!DvbRecordingModel::existsSimilarRecording(*epgMap.value(key)))
-					{
-					int priority = manager->getRecordingRegexPriorityList().value(i);
-					epgModel->scheduleProgram(epgMap.value(key), manager->getBeginMargin(),
-							manager->getEndMargin(), false, priority);
-					Log("DvbRecordingModel::findNewRecordings: scheduled") << title;
-					}
-				}
-			}
-			i = i + 1;
-		}
-	}
+	autoRecorder->setEpgModel(epgModel);
+}
 
-	Log("DvbRecordingModel::findNewRecordings executed.");
+void DvbRecordingModel::findNewRecordings()
+{
+	autoRecorder->checkAllEntries();
 }
 
-void DvbRecordingModel::timerEvent(QTimerEvent *event)
+void DvbRecordingModel::processDeadlines()
 {
-	Q_UNUSED(event)
 	QDateTime currentDateTime = QDateTime::currentDateTime().toUTC();
+	QList<DvbSharedRecording> dueRecordings;
 
-	foreach (const DvbSharedRecording &recording, recordings) {
+	while (!deadlines.isEmpty() && (deadlines.first().dateTime <= currentDateTime)) {
+		std::pop_heap(deadlines.begin(), deadlines.end(), deadlineGreaterThan);
+		DvbRecordingDeadline deadline = deadlines.last();
+		deadlines.removeLast();
+
+		if (currentDeadlines.value(deadline.sqlKey) != deadline.dateTime) {
+			continue;
+		}
+
+		currentDeadlines.remove(deadline.sqlKey);
+		DvbSharedRecording recording = recordings.value(deadline.sqlKey);
+
+		if (recording.isValid()) {
+			dueRecordings.append(recording);
+		}
+	}
+
+	// finished recordings release their devices first
+
+	foreach (const DvbSharedRecording &recording, dueRecordings) {
 		if (recording->end <= currentDateTime) {
 			DvbRecording modifiedRecording = *recording;
 			updateRecording(recording, modifiedRecording);
 		}
 	}
 
-	foreach (const DvbSharedRecording &recording, recordings) {
-		if ((recording->status != DvbRecording::Recording) &&
-		    (recording->begin <= currentDateTime)) {
+	foreach (const DvbSharedRecording &recording, dueRecordings) {
+		if ((recordings.value(*recording) == recording) &&
+		    (recording->end > currentDateTime)) {
 			DvbRecording modifiedRecording = *recording;
 			updateRecording(recording, modifiedRecording);
 		}
 	}
+
+	updateDeadlineTimer();
+}
+
+QDateTime DvbRecordingModel::getNextDeadline(const DvbRecording &recording,
+	const QDateTime &currentDateTime) const
+{
+	if ((recording.status == DvbRecording::Recording) || recording.disabled ||
+	    (recording.end <= currentDateTime)) {
+		return recording.end;
+	}
+
+	if (recording.begin > currentDateTime) {
+		QDateTime preTuneDateTime = recording.begin.addSecs(-manager->getPreTuneTime());
+
+		if (preTuneDateTime > currentDateTime) {
+			return preTuneDateTime;
+		}
+
+		// keep retrying if the device was busy / tuning failed
+		QDateTime retryDateTime = currentDateTime.addSecs(5);
+		QExplicitlySharedDataPointer<DvbRecordingFile> recordingFile =
+			recordingFiles.value(recording);
+
+		if ((retryDateTime < recording.begin) &&
+		    ((recordingFile.constData() == NULL) || !recordingFile->isPrepared())) {
+			return retryDateTime;
+		}
+
+		return recording.begin;
+	}
+
+	// keep retrying if the device was busy / tuning failed
+	return currentDateTime.addSecs(5);
+}
+
+void DvbRecordingModel::scheduleDeadline(const DvbRecording &recording)
+{
+	QDateTime dateTime = getNextDeadline(recording, QDateTime::currentDateTime().toUTC());
+
+	if (currentDeadlines.value(recording) == dateTime) {
+		return;
+	}
+
+	currentDeadlines.insert(recording, dateTime);
+	deadlines.append(DvbRecordingDeadline(dateTime, recording));
+	std::push_heap(deadlines.begin(), deadlines.end(), deadlineGreaterThan);
+
+	// outdated deadlines are dropped from time to time
+	if (deadlines.size() > (2 * currentDeadlines.size() + 64)) {
+		deadlines.clear();
+
+		for (QMap<SqlKey, QDateTime>::ConstIterator it = currentDeadlines.constBegin();
+		     it != currentDeadlines.constEnd(); ++it) {
+			deadlines.append(DvbRecordingDeadline(it.value(), it.key()));
+		}
+
+		std::make_heap(deadlines.begin(), deadlines.end(), deadlineGreaterThan);
+	}
+
+	updateDeadlineTimer();
+}
+
+void DvbRecordingModel::updateDeadlineTimer()
+{
+	if (deadlines.isEmpty()) {
+		deadlineTimer.stop();
+		return;
+	}
+
+	// the system clock may change (or the computer may be suspended) --> check regularly
+	qint64 msecs = QDateTime::currentDateTime().toUTC().msecsTo(deadlines.first().dateTime);
+	deadlineTimer.start(static_cast<int>(qBound(Q_INT64_C(0), msecs, Q_INT64_C(60000))));
 }
 
 void DvbRecordingModel::bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const
@@ -569,6 +780,7 @@ void DvbRecordingModel::bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int inde
 	query.bindValue(index++, recording->durationEPG.toString(Qt::ISODate));
 	query.bindValue(index++, recording->priority);
 	query.bindValue(index++, recording->disabled);
+	query.bindValue(index++, recording->streams);
 }
 
 bool DvbRecordingModel::insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query, int index)
@@ -591,10 +803,12 @@ bool DvbRecordingModel::insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query
 	recording->durationEPG = QTime::fromString(query.value(index++).toString(), Qt::ISODate);
 	recording->priority = query.value(index++).toInt();
 	recording->disabled = query.value(index++).toBool();
+	recording->streams = query.value(index++).toString();
 
 	if (recording->validate()) {
 		recording->setSqlKey(sqlKey);
 		recordings.insert(*newRecording, newRecording);
+		scheduleDeadline(*newRecording);
 		return true;
 	}
 
@@ -631,6 +845,70 @@ int DvbRecordingModel::getSecondsUntilNextRecording() const
 	return timeUntil;
 }
 
+qint64 DvbRecordingModel::estimateSize(const DvbRecording &recording) const
+{
+	QDateTime begin = qMax(recording.begin, QDateTime::currentDateTime().toUTC());
+
+	if (!recording.channel.isValid() || (recording.end <= begin)) {
+		return 0;
+	}
+
+	return (manager->getChannelBitrate(recording.channel->name) * begin.secsTo(recording.end));
+}
+
+qint64 DvbRecordingModel::getAvailableSpace() const
+{
+	QStorageInfo storageInfo(manager->getRecordingFolder());
+
+	if (!storageInfo.isValid()) {
+		// DvbRecordingFile::start() falls back to the home folder
+		storageInfo.setPath(QDir::homePath());
+	}
+
+	if (!storageInfo.isValid() || !storageInfo.isReady()) {
+		return -1;
+	}
+
+	return storageInfo.bytesAvailable();
+}
+
+static bool beginLessThan(const DvbSharedRecording &x, const DvbSharedRecording &y)
+{
+	return (x->begin < y->begin);
+}
+
+DvbSharedRecording DvbRecordingModel::findSpaceShortfall(qint64 &neededSpace,
+	qint64 &availableSpace) const
+{
+	neededSpace = 0;
+	availableSpace = getAvailableSpace();
+
+	if (availableSpace < 0) {
+		return DvbSharedRecording();
+	}
+
+	QDateTime currentDateTime = QDateTime::currentDateTime().toUTC();
+	QList<DvbSharedRecording> recordingList;
+
+	foreach (const DvbSharedRecording &recording, recordings) {
+		if (!recording->disabled && (recording->end > currentDateTime)) {
+			recordingList.append(recording);
+		}
+	}
+
+	std::sort(recordingList.begin(), recordingList.end(), beginLessThan);
+
+	foreach (const DvbSharedRecording &recording, recordingList) {
+		neededSpace += estimateSize(*recording);
+
+		if (neededSpace > availableSpace) {
+			return recording;
+		}
+	}
+
+	return DvbSharedRecording();
+}
+
 bool DvbRecordingModel::isScanWhenIdle() const
 {
 	return manager->isScanWhenIdle();
@@ -736,18 +1014,804 @@ bool DvbRecordingModel::updateStatus(DvbRecording &recording)
 		}
 	} else {
 		recording.status = DvbRecording::Inactive;
-		recordingFiles.remove(recording);
+
+		if (!recording.disabled &&
+		    (recording.begin.addSecs(-manager->getPreTuneTime()) <= currentDateTime)) {
+			QExplicitlySharedDataPointer<DvbRecordingFile> recordingFile =
+				recordingFiles.value(recording);
+
+			if (recordingFile.constData() == NULL) {
+				recordingFile = new DvbRecordingFile(manager);
+				recordingFiles.insert(recording, recordingFile);
+			}
+
+			recordingFile->prepare(recording);
+		} else {
+			recordingFiles.remove(recording);
+		}
 	}
 
 	return true;
 }
 
-DvbRecordingFile::DvbRecordingFile(DvbManager *manager_) : manager(manager_), device(NULL),
-	pmtValid(false)
+bool DvbRecordingTuner::isAvailable(const DvbSharedRecording &recording, bool &shared) const
 {
-	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
+	const DvbSharedChannel &channel = recording->channel;
+	shared = false;
+
+	if (!sources.contains(channel->source)) {
+		return false;
+	}
+
+	// recordings which begin before 'earliestBegin' end before 'recording' begins
+	QDateTime earliestBegin = recording->begin.addSecs(-maxDuration);
+
+	for (QMultiMap<QDateTime, DvbSharedRecording>::ConstIterator it =
+	     recordings.lowerBound(earliestBegin);
+	     (it != recordings.constEnd()) && (it.key() < recording->end); ++it) {
+		const DvbSharedRecording &otherRecording = *it;
+
+		if (recording->begin < otherRecording->end) {
+			if ((otherRecording->channel->source != channel->source) ||
+			    !otherRecording->channel->transponder.corresponds(channel->transponder)) {
+				return false;
+			}
+
+			shared = true;
+		}
+	}
+
+	return true;
+}
+
+QMultiMap<QDateTime, DvbSharedRecording>::Iterator DvbRecordingTuner::insert(
+	const DvbSharedRecording &recording)
+{
+	maxDuration = qMax(maxDuration, recording->begin.secsTo(recording->end));
+	return recordings.insert(recording->begin, recording);
+}
+
+void DvbRecordingTuner::remove(const QDateTime &begin, const QDateTime &end)
+{
+	QMultiMap<QDateTime, DvbSharedRecording>::Iterator it = recordings.lowerBound(begin);
+
+	while ((it != recordings.end()) && (it.key() < end)) {
+		it = recordings.erase(it);
+	}
+}
+
+DvbRecordingScheduler::DvbRecordingScheduler(const QList<DvbDeviceConfig> &deviceConfigs)
+{
+	foreach (const DvbDeviceConfig &deviceConfig, deviceConfigs) {
+		DvbRecordingTuner tuner;
+
+		foreach (const DvbConfig &config, deviceConfig.configs) {
+			tuner.sources.append(config->name);
+		}
+
+		if (tuner.sources.isEmpty()) {
+			continue;
+		}
+
+		for (int i = qMax(deviceConfig.numberOfTuners, 1); i > 0; --i) {
+			tuners.append(tuner);
+		}
+	}
+}
+
+DvbRecordingScheduler::~DvbRecordingScheduler()
+{
+}
+
+bool DvbRecordingScheduler::add(const DvbSharedRecording &recording)
+{
+	int index = findTuner(recording);
+
+	if (index >= 0) {
+		tuners[index].insert(recording);
+		return true;
+	}
+
+	// the recording may still fit if the recordings added so far are redistributed;
+	// only the recordings which (transitively) overlap the new one are affected; they
+	// are found in one sweep over all recordings ordered by begin
+	QList<DvbSharedRecording> recordings;
+	recordings.append(recording);
+
+	foreach (const DvbRecordingTuner &tuner, tuners) {
+		recordings.append(tuner.recordings.values());
+	}
+
+	std::sort(recordings.begin(), recordings.end(), beginLessThan);
+	QList<DvbSharedRecording> pending; // sorted by begin
+	QDateTime end;
+	bool containsRecording = false;
+
+	foreach (const DvbSharedRecording &otherRecording, recordings) {
+		if (!pending.isEmpty() && (otherRecording->begin >= end)) {
+			if (containsRecording) {
+				break;
+			}
+
+			pending.clear();
+		}
+
+		if (pending.isEmpty() || (end < otherRecording->end)) {
+			end = otherRecording->end;
+		}
+
+		pending.append(otherRecording);
+
+		if (otherRecording == recording) {
+			containsRecording = true;
+		}
+	}
+
+	// every recording which begins inside of the overlapping range is part of it
+	QList<DvbRecordingTuner> oldTuners = tuners;
+
+	for (int i = 0; i < tuners.size(); ++i) {
+		tuners[i].remove(pending.first()->begin, end);
+	}
+
+	int steps = MaxSearchSteps;
+
+	if (assign(pending, 0, steps)) {
+		return true;
+	}
+
+	if (steps >= 0) {
+		tuners = oldTuners;
+		return false;
+	}
+
+	// an aborted search doesn't prove a conflict; assign the recordings greedily instead
+	Log("DvbRecordingScheduler::add: search aborted for") << recording->name;
+
+	foreach (const DvbSharedRecording &pendingRecording, pending) {
+		int tunerIndex = findTuner(pendingRecording);
+
+		if (tunerIndex < 0) {
+			// keep the previous assignment; the new recording isn't disabled
+			tuners = oldTuners;
+			return true;
+		}
+
+		tuners[tunerIndex].insert(pendingRecording);
+	}
+
+	return true;
+}
+
+int DvbRecordingScheduler::findTuner(const DvbSharedRecording &recording) const
+{
+	int bestIndex = -1;
+	bool bestShared = false;
+
+	for (int i = 0; i < tuners.size(); ++i) {
+		const DvbRecordingTuner &tuner = tuners.at(i);
+		bool shared;
+
+		if (!tuner.isAvailable(recording, shared)) {
+			continue;
+		}
+
+		// prefer sharing a tuner, then tuners which can receive less sources
+		if ((bestIndex < 0) || (shared && !bestShared) || ((shared == bestShared) &&
+		    (tuner.sources.size() < tuners.at(bestIndex).sources.size()))) {
+			bestIndex = i;
+			bestShared = shared;
+		}
+	}
+
+	return bestIndex;
+}
+
+bool DvbRecordingScheduler::assign(const QList<DvbSharedRecording> &pending, int index,
+	int &steps)
+{
+	if (index >= pending.size()) {
+		return true;
+	}
+
+	if (--steps < 0) {
+		return false;
+	}
+
+	const DvbSharedRecording &recording = pending.at(index);
+	QList<QStringList> triedSources;
+
+	for (int i = 0; i < tuners.size(); ++i) {
+		bool shared;
+
+		if (!tuners.at(i).isAvailable(recording, shared)) {
+			continue;
+		}
+
+		if (tuners.at(i).recordings.isEmpty()) {
+			// idle tuners which can receive the same sources are interchangeable
+			if (triedSources.contains(tuners.at(i).sources)) {
+				continue;
+			}
+
+			triedSources.append(tuners.at(i).sources);
+		}
+
+		QMultiMap<QDateTime, DvbSharedRecording>::Iterator it = tuners[i].insert(recording);
+
+		if (assign(pending, index + 1, steps)) {
+			return true;
+		}
+
+		tuners[i].recordings.erase(it);
+
+		if (steps < 0) {
+			return false;
+		}
+	}
+
+	return false;
+}
+
+DvbAutoRecorder::DvbAutoRecorder(DvbManager *manager_, QObject *parent) : QObject(parent),
+	manager(manager_), epgModel(NULL), rulesValid(false), checkAll(false), indexValid(false)
+{
+	checkTimer.setSingleShot(true);
+	connect(&checkTimer, SIGNAL(timeout()), this, SLOT(checkEntries()));
+}
+
+DvbAutoRecorder::~DvbAutoRecorder()
+{
+}
+
+void DvbAutoRecorder::setEpgModel(DvbEpgModel *epgModel_)
+{
+	epgModel = epgModel_;
+	connect(epgModel, SIGNAL(entryAdded(DvbSharedEpgEntry)),
+		this, SLOT(entryAdded(DvbSharedEpgEntry)));
+	connect(epgModel, SIGNAL(entriesAdded(QList<DvbSharedEpgEntry>)),
+		this, SLOT(entriesAdded(QList<DvbSharedEpgEntry>)));
+	connect(epgModel, SIGNAL(entryUpdated(DvbSharedEpgEntry)),
+		this, SLOT(entryUpdated(DvbSharedEpgEntry)));
+	connect(epgModel, SIGNAL(entryRemoved(DvbSharedEpgEntry)),
+		this, SLOT(entryRemoved(DvbSharedEpgEntry)));
+	connect(epgModel, SIGNAL(entriesRemoved(QList<DvbSharedEpgEntry>)),
+		this, SLOT(entriesRemoved(QList<DvbSharedEpgEntry>)));
+}
+
+void DvbAutoRecorder::checkAllEntries()
+{
+	rulesValid = false;
+	checkAll = true;
+	pendingEntries.clear();
+	checkTimer.start(0);
+}
+
+void DvbAutoRecorder::invalidateIndex()
+{
+	indexValid = false;
+}
+
+bool DvbAutoRecorder::existsSimilarRecording(const DvbEpgEntry &entry)
+{
+	updateIndex();
+	const QString &channelName = entry.channel->name;
+
+	for (QMultiHash<QString, DvbSharedEpgEntry>::ConstIterator it =
+	     scheduledEntries.constFind(channelName);
+	     (it != scheduledEntries.constEnd()) && (it.key() == channelName); ++it) {
+		const DvbSharedEpgEntry &scheduledEntry = *it;
+
+		// is included in an existing recording or includes an existing recording
+		if (((entry.begin <= scheduledEntry->begin) && (entry.end >= scheduledEntry->end)) ||
+		    ((entry.begin >= scheduledEntry->begin) && (entry.end <= scheduledEntry->end))) {
+			return true;
+		}
+	}
+
+	if (unwantedKeys.contains(unwantedKey(channelName, entry.begin,
+	    QTime().secsTo(entry.duration)))) {
+		Log("DvbAutoRecorder::existsSimilarRecording: found from unwanteds") << entry.title;
+		return true;
+	}
+
+	return false;
+}
+
+void DvbAutoRecorder::entryAdded(const DvbSharedEpgEntry &entry)
+{
+	if (!checkAll) {
+		pendingEntries.append(entry);
+		checkTimer.start(0);
+	}
+}
+
+void DvbAutoRecorder::entriesAdded(const QList<DvbSharedEpgEntry> &entries)
+{
+	if (!checkAll) {
+		pendingEntries += entries;
+		checkTimer.start(0);
+	}
+}
+
+void DvbAutoRecorder::entryUpdated(const DvbSharedEpgEntry &entry)
+{
+	// the recording of the entry may have changed
+	indexValid = false;
+	entryAdded(entry);
+}
+
+void DvbAutoRecorder::entryRemoved(const DvbSharedEpgEntry &entry)
+{
+	if (entry->recording.isValid()) {
+		indexValid = false;
+	}
+}
+
+void DvbAutoRecorder::entriesRemoved(const QList<DvbSharedEpgEntry> &entries)
+{
+	foreach (const DvbSharedEpgEntry &entry, entries) {
+		if (entry->recording.isValid()) {
+			indexValid = false;
+			break;
+		}
+	}
+}
+
+void DvbAutoRecorder::checkEntries()
+{
+	if (epgModel == NULL) {
+		return;
+	}
+
+	if (!rulesValid) {
+		compileRules();
+	}
+
+	bool scheduled = false;
+
+	if (checkAll) {
+		checkAll = false;
+		QList<DvbSharedEpgEntry> allEntries;
+		bool hasAllEntries = false;
+
+		foreach (const DvbAutoRecordingRule &rule, rules) {
+			QList<DvbSharedEpgEntry> entries;
+
+			// plain text can be looked up in the epg text index
+			if (!rule.isPlainText || !epgModel->findEntryCandidates(rule.pattern, entries)) {
+				if (!hasAllEntries) {
+					allEntries = epgModel->getEntries();
+					hasAllEntries = true;
+				}
+
+				entries = allEntries;
+			}
+
+			foreach (const DvbSharedEpgEntry &entry, entries) {
+				checkEntry(rule, entry);
+			}
+		}
+
+		// a full check is also requested after recordings have been changed
+		scheduled = true;
+	} else {
+		QList<DvbSharedEpgEntry> entries = pendingEntries;
+		pendingEntries.clear();
+		QDateTime currentDateTime = QDateTime::currentDateTime().toUTC();
+
+		foreach (const DvbSharedEpgEntry &entry, entries) {
+			if (entry->end <= currentDateTime) {
+				continue;
+			}
+
+			foreach (const DvbAutoRecordingRule &rule, rules) {
+				if (checkEntry(rule, entry)) {
+					scheduled = true;
+					break;
+				}
+			}
+		}
+	}
+
+	if (scheduled) {
+		DvbRecordingModel *recordingModel = manager->getRecordingModel();
+		recordingModel->removeDuplicates();
+		recordingModel->disableConflicts();
+	}
+}
+
+void DvbAutoRecorder::compileRules()
+{
+	QStringList regexList = manager->getRecordingRegexList();
+	QList<int> priorityList = manager->getRecordingRegexPriorityList();
+	QStringList streamsList = manager->getRecordingRegexStreamsList();
+	rules.clear();
+
+	for (int i = 0; i < regexList.size(); ++i) {
+		DvbAutoRecordingRule rule;
+		rule.pattern = regexList.at(i);
+		rule.regex = QRegExp(rule.pattern);
+
+		if (rule.regex.isEmpty()) {
+			continue;
+		}
+
+		rule.priority = priorityList.value(i);
+		rule.streams = streamsList.value(i);
+		rule.isPlainText = (QRegExp::escape(rule.pattern) == rule.pattern);
+		rules.append(rule);
+	}
+
+	rulesValid = true;
+}
+
+bool DvbAutoRecorder::checkEntry(const DvbAutoRecordingRule &rule,
+	const DvbSharedEpgEntry &entry)
+{
+	if (entry->recording.isValid() || (rule.regex.indexIn(entry->title) == -1) ||
+	    existsSimilarRecording(*entry)) {
+		return false;
+	}
+
+	epgModel->scheduleProgram(entry, manager->getBeginMargin(), manager->getEndMargin(),
+		false, rule.priority, rule.streams);
+	Log("DvbAutoRecorder::checkEntry: scheduled") << entry->title;
+	return true;
+}
+
+void DvbAutoRecorder::updateIndex()
+{
+	if (indexValid) {
+		return;
+	}
+
+	scheduledEntries.clear();
+	unwantedKeys.clear();
+
+	foreach (const DvbSharedEpgEntry &entry, epgModel->getRecordings()) {
+		scheduledEntries.insert(entry->channel->name, entry);
+	}
+
+	int beginMargin = manager->getBeginMargin();
+	int endMargin = manager->getEndMargin();
+
+	foreach (const DvbSharedRecording &recording,
+		 manager->getRecordingModel()->getUnwantedRecordings()) {
+		unwantedKeys.insert(unwantedKey(recording->channel->name,
+			recording->begin.addSecs(beginMargin),
+			QTime().secsTo(recording->duration) - beginMargin - endMargin));
+	}
+
+	indexValid = true;
+}
+
+QString DvbAutoRecorder::unwantedKey(const QString &channelName, const QDateTime &begin,
+	int duration)
+{
+	// seconds precision
+	return channelName + QLatin1Char('\n') +
+		QString::number(begin.toMSecsSinceEpoch() / 1000) + QLatin1Char('\n') +
+		QString::number(duration);
+}
+
+DvbMuxRecording::DvbMuxRecording(DvbManager *manager_) : manager(manager_), device(NULL),
+	recordingCount(0)
+{
+	file.connectClosed(this, SLOT(fileClosed(QString)));
+}
+
+DvbMuxRecording::~DvbMuxRecording()
+{
+	releaseDevice();
+}
+
+bool DvbMuxRecording::open(const DvbSharedChannel &channel_)
+{
+	channel = channel_;
+	device = manager->requestDevice(channel->source, channel->transponder,
+		DvbManager::Prioritized);
+
+	if (device == NULL) {
+		Log("DvbMuxRecording::open: cannot find a suitable device");
+		return false;
+	}
+
+	file.setPreallocationSize(Q_INT64_C(256) << 20);
+	file.setSyncPolicy(DvbTsWriter::SyncPolicy(manager->getWriteSyncPolicy()));
+	file.setDirectIo(manager->isDirectIoEnabled());
+
+	QString path = manager->getRecordingFolder() + QLatin1Char('/') +
+		QString(QLatin1String("Transponder %1 %2 %3")).arg(channel->source,
+		QString::number(channel->transportStreamId),
+		QDateTime::currentDateTime().toString(QLatin1String("yyyy-MM-dd hh-mm-ss"))).
+		replace(QLatin1Char('/'), QLatin1Char('_'));
+
+	for (int attempt = 0; attempt < 100; ++attempt) {
+		QString fileName = path;
+
+		if (attempt != 0) {
+			fileName += QLatin1Char('-') + QString::number(attempt);
+		}
+
+		fileName += QLatin1String(".m2t");
+
+		if (QFile::exists(fileName)) {
+			continue;
+		}
+
+		if (!file.open(fileName)) {
+			Log("DvbMuxRecording::open: cannot open file") << fileName;
+		}
+
+		break;
+	}
+
+	if (!file.isOpen()) {
+		manager->releaseDevice(device, DvbManager::Prioritized);
+		device = NULL;
+		return false;
+	}
+
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+	// the pmts are added by the recordings
+	addPid(0);
+	return true;
+}
+
+void DvbMuxRecording::close()
+{
+	releaseDevice();
+
+	if (!file.isOpen()) {
+		deleteLater();
+		return;
+	}
+
+	file.close();
+}
+
+void DvbMuxRecording::releaseDevice()
+{
+	if (device != NULL) {
+		for (QMap<int, int>::ConstIterator it = pids.constBegin(); it != pids.constEnd();
+		     ++it) {
+			device->removePidFilter(it.key(), this);
+		}
+
+		disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+		manager->releaseDevice(device, DvbManager::Prioritized);
+		device = NULL;
+	}
+
+	pids.clear();
+}
+
+void DvbMuxRecording::addPid(int pid)
+{
+	int &count = pids[pid];
+	++count;
+
+	if ((count == 1) && (device != NULL)) {
+		device->addPidFilter(pid, this);
+	}
+}
+
+void DvbMuxRecording::removePid(int pid)
+{
+	QMap<int, int>::iterator it = pids.find(pid);
+
+	if (it == pids.end()) {
+		return;
+	}
+
+	if (--(*it) == 0) {
+		pids.erase(it);
+
+		if (device != NULL) {
+			device->removePidFilter(pid, this);
+		}
+	}
+}
+
+void DvbMuxRecording::addRecording(int pmtPid)
+{
+	++recordingCount;
+	addPid(pmtPid);
+}
+
+bool DvbMuxRecording::removeRecording(const DvbMuxRecordingJob &job)
+{
+	removePid(job.pmtPid);
+
+	if (job.endOffset > job.beginOffset) {
+		jobs.append(job);
+	}
+
+	--recordingCount;
+	return (recordingCount == 0);
+}
+
+void DvbMuxRecording::deviceStateChanged()
+{
+	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
+		for (QMap<int, int>::ConstIterator it = pids.constBegin(); it != pids.constEnd();
+		     ++it) {
+			device->removePidFilter(it.key(), this);
+		}
+
+		disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+		device = manager->requestDevice(channel->source, channel->transponder,
+			DvbManager::Prioritized);
+
+		if (device != NULL) {
+			connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+
+			for (QMap<int, int>::ConstIterator it = pids.constBegin();
+			     it != pids.constEnd(); ++it) {
+				device->addPidFilter(it.key(), this);
+			}
+		} else {
+			// the recordings are stopped as well
+			Log("DvbMuxRecording::deviceStateChanged: cannot find a suitable device");
+		}
+	}
+}
+
+void DvbMuxRecording::fileClosed(const QString &muxFileName)
+{
+	if (manager->isMuxExtractionEnabled() && !jobs.isEmpty()) {
+		manager->getRecordingModel()->extractMuxRecording(muxFileName, jobs);
+	}
+
+	jobs.clear();
+	deleteLater();
+}
+
+void DvbMuxRecording::processData(const char data[188])
+{
+	file.write(data, 188);
+}
+
+DvbMuxExtractor::DvbMuxExtractor(const QString &muxFileName_,
+	const QList<DvbMuxRecordingJob> &jobs_) : muxFileName(muxFileName_), jobs(jobs_)
+{
+}
+
+DvbMuxExtractor::~DvbMuxExtractor()
+{
+	wait();
+}
+
+void DvbMuxExtractor::cancel()
+{
+	cancelled.store(1);
+}
+
+void DvbMuxExtractor::run()
+{
+	QFile muxFile(muxFileName);
+
+	if (!muxFile.open(QIODevice::ReadOnly)) {
+		Log("DvbMuxExtractor::run: cannot open file") << muxFileName;
+		return;
+	}
+
+	bool success = true;
+
+	for (int i = 0; i < jobs.size(); ++i) {
+		DvbMuxRecordingJob job = jobs.at(i);
+
+		if (extract(muxFile, job)) {
+			extractedJobs.append(job);
+		} else {
+			success = false;
+		}
+	}
+
+	muxFile.close();
+
+	if (success && !QFile::remove(muxFileName)) {
+		Log("DvbMuxExtractor::run: cannot remove file") << muxFileName;
+	}
+}
+
+bool DvbMuxExtractor::extract(QFile &muxFile, DvbMuxRecordingJob &job)
+{
+	QString fileName = job.fileName;
+
+	// another recording may have chosen the same name in the meantime
+	for (int attempt = 1; QFile::exists(fileName) && (attempt < 100); ++attempt) {
+		fileName = job.fileName;
+		fileName.insert(fileName.size() - 4, QLatin1Char('-') + QString::number(attempt));
+	}
+
+	QFile file(fileName);
+	TsIndexWriter index;
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		Log("DvbMuxExtractor::extract: cannot extract") << fileName;
+		return false;
+	}
+
+	if (!muxFile.seek(job.beginOffset)) {
+		Log("DvbMuxExtractor::extract: cannot extract") << fileName;
+		removeOutput(file, index);
+		return false;
+	}
+
+	index.setPids(job.videoPid, job.pcrPid);
+	index.open(fileName);
+	DvbSectionGenerator patGenerator = job.patGenerator;
+	DvbSectionGenerator pmtGenerator = job.pmtGenerator;
+	qint64 remainingSize = (job.endOffset - job.beginOffset);
+	int packetCount = PatPmtInterval;
+	QByteArray output;
+
+	while (remainingSize > 0) {
+		if (cancelled.load() != 0) {
+			removeOutput(file, index);
+			return false;
+		}
+
+		QByteArray input = muxFile.read(qMin(remainingSize, qint64(BufferSize)));
+
+		if (input.isEmpty()) {
+			Log("DvbMuxExtractor::extract: unexpected end of file") << muxFileName;
+			removeOutput(file, index);
+			return false;
+		}
+
+		remainingSize -= input.size();
+		output.clear();
+
+		for (int i = 0; (i + 188) <= input.size(); i += 188) {
+			const char *packet = (input.constData() + i);
+			int pid = (((quint8(packet[1]) & 0x1f) << 8) | quint8(packet[2]));
+
+			// pat and pmt are replaced by the ones of the recording
+			if ((pid == 0) || (pid == job.pmtPid) || !job.pids.contains(pid)) {
+				continue;
+			}
+
+			if (packetCount >= PatPmtInterval) {
+				output.append(patGenerator.generatePackets());
+				output.append(pmtGenerator.generatePackets());
+				packetCount = 0;
+			}
+
+			output.append(packet, 188);
+			++packetCount;
+		}
+
+		index.processData(output.constData(), output.size(), file.pos());
+
+		if (file.write(output) != output.size()) {
+			Log("DvbMuxExtractor::extract: cannot write to") << fileName;
+			removeOutput(file, index);
+			return false;
+		}
+	}
+
+	job.fileName = fileName;
+	return true;
+}
+
+void DvbMuxExtractor::removeOutput(QFile &file, TsIndexWriter &index)
+{
+	index.close();
+	file.remove();
+	QFile::remove(TsIndex::indexFileName(file.fileName()));
+}
+
+DvbRecordingFile::DvbRecordingFile(DvbManager *manager_) : manager(manager_), muxRecording(NULL),
+	segmentSize(0), segmentDuration(0), segmentRetention(0), segmentManifest(false), segmentNumber(0),
+	segmentBytes(0), spaceWarningShown(false), device(NULL), pmtValid(false)
+{
+	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
 		this, SLOT(pmtSectionChanged(QByteArray)));
 	connect(&patPmtTimer, SIGNAL(timeout()), this, SLOT(insertPatPmt()));
+	file.connectClosed(manager->getRecordingModel(), SLOT(recordingFileClosed(QString)));
 }
 
 DvbRecordingFile::~DvbRecordingFile()
@@ -761,48 +1825,104 @@ bool DvbRecordingFile::start(DvbRecording &recording)
 		return false;
 	}
 
-	if (!file.isOpen()) {
+	if (!isRecording() && manager->isMuxRecordingEnabled() &&
+	    manager->getRecordingModel()->hasOverlappingRecordings(recording) &&
+	    !startMuxRecording(recording)) {
+		return false;
+	}
+
+	if (!isRecording()) {
 		QString folder = manager->getRecordingFolder();
-		QDate currentDate = QDate::currentDate();
-		QTime currentTime = QTime::currentTime();
-
-		QString filename = manager->getNamingFormat();
-		filename = filename.replace("%year", currentDate.toString("yyyy"));
-		filename = filename.replace("%month", currentDate.toString("MM"));
-		filename = filename.replace("%day", currentDate.toString("dd"));
-		filename = filename.replace("%hour", currentTime.toString("hh"));
-		filename = filename.replace("%min", currentTime.toString("mm"));
-		filename = filename.replace("%sec", currentTime.toString("ss"));
-		filename = filename.replace("%channel", recording.channel->name);
-		filename = filename.replace("%title", QString(recording.name));
-		filename = filename.replace(QLatin1Char('/'), QLatin1Char('_'));
-		if (filename == "") {
-			filename = QString(recording.name);
+		QString filename = getBaseName(recording);
+		QString path = folder + QLatin1Char('/') + filename;
+		QString fileName;
+		DvbRecordingModel *recordingModel = manager->getRecordingModel();
+		qint64 availableSpace = recordingModel->getAvailableSpace();
+		qint64 neededSpace = recordingModel->estimateSize(recording);
+
+		if ((availableSpace >= 0) && (availableSpace < MinimumAvailableSpace)) {
+			Log("DvbRecordingFile::start: the disk is full") << folder;
+
+			// starting is retried every few seconds
+			if (!spaceWarningShown) {
+				spaceWarningShown = true;
+				KMessageBox::queuedMessageBox(manager->getParentWidget(),
+					KMessageBox::Sorry, i18nc("@info",
+					"The recording \"%1\" cannot be started because the disk is full.",
+					recording.name));
+			}
+
+			return false;
 		}
 
-		QString path = folder + QLatin1Char('/') + filename;
+		if ((availableSpace >= 0) && (availableSpace < neededSpace)) {
+			Log("DvbRecordingFile::start: the recording may not fit on the disk") <<
+				recording.name << neededSpace << availableSpace;
+
+			if (!spaceWarningShown) {
+				spaceWarningShown = true;
+				KMessageBox::queuedMessageBox(manager->getParentWidget(),
+					KMessageBox::Sorry, i18nc("@info",
+					"The recording \"%1\" may not fit on the disk: it needs about %2, "
+					"but only %3 are available.", recording.name,
+					KIO::convertSize(neededSpace), KIO::convertSize(availableSpace)));
+			}
+		}
 
+		// one minute per extent
+		qint64 bitrate = manager->getChannelBitrate(recording.channel->name);
+		file.setPreallocationSize(qBound(Q_INT64_C(16) << 20, 60 * bitrate,
+			Q_INT64_C(256) << 20));
+		file.setSyncPolicy(DvbTsWriter::SyncPolicy(manager->getWriteSyncPolicy()));
+		file.setDirectIo(manager->isDirectIoEnabled());
+		file.setIndexEnabled(true);
+
+		segmentSize = (qint64(manager->getSegmentSize()) << 20);
+		segmentDuration = (qint64(manager->getSegmentDuration()) * 60000);
+		segmentRetention = manager->getSegmentRetention();
+		segmentManifest = manager->isSegmentManifestEnabled();
+		bool segmented = ((segmentSize > 0) || (segmentDuration > 0));
+
+		if (segmented && (segmentRetention > 0) && !segmentManifest) {
+			// the recording refers to the first segment then, which would be deleted
+			Log("DvbRecordingFile::start: segments are only deleted with a playlist");
+			segmentRetention = 0;
+		}
 
 		for (int attempt = 0; attempt < 100; ++attempt) {
-			if (attempt == 0) {
-				file.setFileName(path + QLatin1String(".m2t"));
-				recording.filename = filename + QLatin1String(".m2t");
+			QString suffix;
+
+			if (attempt != 0) {
+				suffix = QLatin1Char('-') + QString::number(attempt);
+			}
+
+			if (segmented) {
+				segmentPath = path + suffix;
+				fileName = getSegmentFileName(1);
+
+				if (segmentManifest) {
+					recording.filename = filename + suffix + QLatin1String(".m3u");
+				} else {
+					recording.filename = QFileInfo(fileName).fileName();
+				}
+
+				if (segmentManifest &&
+				    QFile::exists(segmentPath + QLatin1String(".m3u"))) {
+					continue;
+				}
 			} else {
-				file.setFileName(path + QLatin1Char('-') + QString::number(attempt) +
-					QLatin1String(".m2t"));
-				recording.filename = filename + QLatin1Char('-') + QString::number(attempt) +
-					QLatin1String(".m2t");
+				fileName = path + suffix + QLatin1String(".m2t");
+				recording.filename = filename + suffix + QLatin1String(".m2t");
 			}
 
-			if (file.exists()) {
+			if (QFile::exists(fileName)) {
 				continue;
 			}
 
-			if (file.open(QIODevice::WriteOnly)) {
+			if (file.open(fileName)) {
 				break;
 			} else {
-				Log("DvbRecordingFile::start: cannot open file") <<
-					file.fileName();
+				Log("DvbRecordingFile::start: cannot open file") << fileName;
 			}
 
 			if ((attempt == 0) && !QDir(folder).exists()) {
@@ -844,18 +1964,127 @@ bool DvbRecordingFile::start(DvbRecording &recording)
 		}
 
 		if (!file.isOpen()) {
-			Log("DvbRecordingFile::start: cannot open file") << file.fileName();
+			Log("DvbRecordingFile::start: cannot open file") << fileName;
+			segmentPath.clear();
 			return false;
 		}
+
+		recordingTimer.start();
+
+		if (!segmentPath.isEmpty()) {
+			segmentNumber = 1;
+			segmentBytes = 0;
+			segmentTimer.start();
+			segments.append(DvbRecordingSegment(fileName));
+			writeManifest();
+		}
+
+		// the device may have been tuned in advance
+		if (pmtValid) {
+			file.write(patGenerator.generatePackets());
+			file.write(pmtGenerator.generatePackets());
+		}
+	}
+
+	if (!prepare(recording)) {
+		return false;
+	}
+
+	manager->getRecordingModel()->setCurrentRecording(recording);
+
+	return true;
+}
+
+QString DvbRecordingFile::getBaseName(const DvbRecording &recording) const
+{
+	QDate currentDate = QDate::currentDate();
+	QTime currentTime = QTime::currentTime();
+
+	QString filename = manager->getNamingFormat();
+	filename = filename.replace("%year", currentDate.toString("yyyy"));
+	filename = filename.replace("%month", currentDate.toString("MM"));
+	filename = filename.replace("%day", currentDate.toString("dd"));
+	filename = filename.replace("%hour", currentTime.toString("hh"));
+	filename = filename.replace("%min", currentTime.toString("mm"));
+	filename = filename.replace("%sec", currentTime.toString("ss"));
+	filename = filename.replace("%channel", recording.channel->name);
+	filename = filename.replace("%title", QString(recording.name));
+	filename = filename.replace(QLatin1Char('/'), QLatin1Char('_'));
+	if (filename == "") {
+		filename = QString(recording.name);
+	}
+
+	return filename;
+}
+
+bool DvbRecordingFile::startMuxRecording(DvbRecording &recording)
+{
+	muxRecording = manager->getRecordingModel()->acquireMuxRecording(recording.channel);
+
+	if (muxRecording == NULL) {
+		Log("DvbRecordingFile::startMuxRecording: cannot start transponder recording");
+		return false;
+	}
+
+	// the file is created by the extraction
+	QString path = manager->getRecordingFolder() + QLatin1Char('/') + getBaseName(recording);
+	QString fileName = path + QLatin1String(".m2t");
+
+	for (int attempt = 1; QFile::exists(fileName) && (attempt < 100); ++attempt) {
+		fileName = path + QLatin1Char('-') + QString::number(attempt) +
+			QLatin1String(".m2t");
 	}
 
+	muxJob = DvbMuxRecordingJob();
+	muxJob.recordingKey = recording;
+	muxJob.fileName = fileName;
+	muxJob.pmtPid = recording.channel->pmtPid;
+	muxJob.beginOffset = muxRecording->position();
+
+	// the device may have been tuned in advance
+	foreach (int pid, pids) {
+		device->removePidFilter(pid, this);
+		muxRecording->addPid(pid);
+	}
+
+	if (pmtValid) {
+		pmtSectionChanged(pmtSectionData);
+	}
+
+	// switched to the extracted file by the model once the extraction has succeeded
+	recording.filename = QFileInfo(muxRecording->fileName()).fileName();
+
+	recordingTimer.start();
+	return true;
+}
+
+void DvbRecordingFile::addPid(int pid)
+{
+	if (muxRecording != NULL) {
+		muxRecording->addPid(pid);
+	} else {
+		device->addPidFilter(pid, this);
+	}
+}
+
+void DvbRecordingFile::removePid(int pid)
+{
+	if (muxRecording != NULL) {
+		muxRecording->removePid(pid);
+	} else {
+		device->removePidFilter(pid, this);
+	}
+}
+
+bool DvbRecordingFile::prepare(const DvbRecording &recording)
+{
 	if (device == NULL) {
 		channel = recording.channel;
 		device = manager->requestDevice(channel->source, channel->transponder,
 			DvbManager::Prioritized);
 
 		if (device == NULL) {
-			Log("DvbRecordingFile::start: cannot find a suitable device");
+			Log("DvbRecordingFile::prepare: cannot find a suitable device");
 			return false;
 		}
 
@@ -863,6 +2092,13 @@ bool DvbRecordingFile::start(DvbRecording &recording)
 		pmtFilter.setProgramNumber(channel->serviceId);
 		device->addSectionFilter(channel->pmtPid, &pmtFilter);
 		pmtSectionData = channel->pmtSectionData;
+		QString streams = recording.streams;
+
+		if (streams.isEmpty()) {
+			streams = manager->getStreamSelection();
+		}
+
+		streamSelection = DvbStreamSelection(streams);
 		patGenerator.initPat(channel->transportStreamId, channel->serviceId,
 			channel->pmtPid);
 
@@ -871,20 +2107,20 @@ bool DvbRecordingFile::start(DvbRecording &recording)
 		}
 	}
 
-	manager->getRecordingModel()->setCurrentRecording(recording);
-
 	return true;
 }
 
 void DvbRecordingFile::stop()
 {
+	bool wasRecording = isRecording();
+
 	if (device != NULL) {
 		if (channel->isScrambled && !pmtSectionData.isEmpty()) {
 			device->stopDescrambling(pmtSectionData, this);
 		}
 
 		foreach (int pid, pids) {
-			device->removePidFilter(pid, this);
+			removePid(pid);
 		}
 
 		device->removeSectionFilter(channel->pmtPid, &pmtFilter);
@@ -893,6 +2129,15 @@ void DvbRecordingFile::stop()
 		device = NULL;
 	}
 
+	if (muxRecording != NULL) {
+		muxJob.endOffset = muxRecording->position();
+		muxJob.patGenerator = patGenerator;
+		muxJob.pmtGenerator = pmtGenerator;
+		manager->getRecordingModel()->releaseMuxRecording(muxRecording, muxJob);
+		muxRecording = NULL;
+		muxJob = DvbMuxRecordingJob();
+	}
+
 	pmtValid = false;
 	patPmtTimer.stop();
 	patGenerator.reset();
@@ -900,20 +2145,51 @@ void DvbRecordingFile::stop()
 	pmtSectionData.clear();
 	pids.clear();
 	buffers.clear();
+
+	if (!segmentPath.isEmpty()) {
+		segments.last().duration = int(segmentTimer.elapsed() / 1000);
+		writeManifest();
+		segmentPath.clear();
+		segments.clear();
+	}
+
+	QString fileName = file.fileName();
+	bool fileOpen = file.isOpen();
 	file.close();
+
+	if (wasRecording && channel.isValid() && (recordingTimer.elapsed() >= 60000) &&
+	    (file.totalSize() > 0)) {
+		// used for the next space estimations and preallocations
+		manager->updateChannelBitrate(channel->name,
+			(1000 * file.totalSize()) / recordingTimer.elapsed());
+	}
+
 	channel = DvbSharedChannel();
 
-	manager->getRecordingModel()->executeActionAfterRecording(manager->getRecordingModel()->getCurrentRecording());
-	manager->getRecordingModel()->findNewRecordings();
-	manager->getRecordingModel()->removeDuplicates();
-	manager->getRecordingModel()->disableConflicts();
+	if (!wasRecording) {
+		// only prepared
+		return;
+	}
+
+	DvbRecordingModel *recordingModel = manager->getRecordingModel();
+
+	if (fileOpen) {
+		// the remaining data is still being written
+		recordingModel->executeActionAfterClosing(fileName,
+			recordingModel->getCurrentRecording());
+	} else {
+		recordingModel->executeActionAfterRecording(recordingModel->getCurrentRecording());
+	}
+
+	// the auto recording rules are checked later (stopping mustn't be delayed)
+	recordingModel->findNewRecordings();
 }
 
 void DvbRecordingFile::deviceStateChanged()
 {
 	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
 		foreach (int pid, pids) {
-			device->removePidFilter(pid, this);
+			removePid(pid);
 		}
 
 		device->removeSectionFilter(channel->pmtPid, &pmtFilter);
@@ -931,7 +2207,7 @@ void DvbRecordingFile::deviceStateChanged()
 			device->addSectionFilter(channel->pmtPid, &pmtFilter);
 
 			foreach (int pid, pids) {
-				device->addPidFilter(pid, this);
+				addPid(pid);
 			}
 
 			if (channel->isScrambled && !pmtSectionData.isEmpty()) {
@@ -950,36 +2226,36 @@ void DvbRecordingFile::pmtSectionChanged(const QByteArray &pmtSectionData_)
 	pmtSectionData = pmtSectionData_;
 	DvbPmtSection pmtSection(pmtSectionData);
 	DvbPmtParser pmtParser(pmtSection);
-	QSet<int> newPids;
+	// the generated pmt only contains the selected streams
+	QSet<int> newPids = streamSelection.selectPids(pmtParser).toSet();
 
-	if (pmtParser.videoPid != -1) {
-		newPids.insert(pmtParser.videoPid);
-	}
+	int pcrPid = (pmtSection.isValid() ? pmtSection.pcrPid() : 0x1fff);
 
-	for (int i = 0; i < pmtParser.audioPids.size(); ++i) {
-		newPids.insert(pmtParser.audioPids.at(i).first);
+	if (pcrPid != 0x1fff) {
+		// needed for playback (and for the index)
+		newPids.insert(pcrPid);
 	}
 
-	for (int i = 0; i < pmtParser.subtitlePids.size(); ++i) {
-		newPids.insert(pmtParser.subtitlePids.at(i).first);
-	}
+	file.setIndexPids(pmtParser.videoPid, (pcrPid != 0x1fff) ? pcrPid : -1);
 
-	if (pmtParser.teletextPid != -1) {
-		newPids.insert(pmtParser.teletextPid);
+	if (muxRecording != NULL) {
+		muxJob.pids.unite(newPids);
+		muxJob.videoPid = pmtParser.videoPid;
+		muxJob.pcrPid = ((pcrPid != 0x1fff) ? pcrPid : -1);
 	}
 
 	for (int i = 0; i < pids.size(); ++i) {
 		int pid = pids.at(i);
 
 		if (!newPids.remove(pid)) {
-			device->removePidFilter(pid, this);
+			removePid(pid);
 			pids.removeAt(i);
 			--i;
 		}
 	}
 
 	foreach (int pid, newPids) {
-		device->addPidFilter(pid, this);
+		addPid(pid);
 		pids.append(pid);
 	}
 
@@ -987,11 +2263,14 @@ void DvbRecordingFile::pmtSectionChanged(const QByteArray &pmtSectionData_)
 
 	if (!pmtValid) {
 		pmtValid = true;
-		file.write(patGenerator.generatePackets());
-		file.write(pmtGenerator.generatePackets());
 
-		foreach (const QByteArray &buffer, buffers) {
-			file.write(buffer);
+		if (file.isOpen()) {
+			file.write(patGenerator.generatePackets());
+			file.write(pmtGenerator.generatePackets());
+
+			foreach (const QByteArray &buffer, buffers) {
+				file.write(buffer);
+			}
 		}
 
 		buffers.clear();
@@ -1012,12 +2291,19 @@ void DvbRecordingFile::insertPatPmt()
 		return;
 	}
 
-	file.write(patGenerator.generatePackets());
-	file.write(pmtGenerator.generatePackets());
+	if (file.isOpen()) {
+		file.write(patGenerator.generatePackets());
+		file.write(pmtGenerator.generatePackets());
+	}
 }
 
 void DvbRecordingFile::processData(const char data[188])
 {
+	if (!file.isOpen()) {
+		// tuned in advance
+		return;
+	}
+
 	if (!pmtValid) {
 		if (!patPmtTimer.isActive()) {
 			patPmtTimer.start(1000);
@@ -1038,6 +2324,81 @@ void DvbRecordingFile::processData(const char data[188])
 		return;
 	}
 
+	if (!segmentPath.isEmpty() && (((segmentSize > 0) && (segmentBytes >= segmentSize)) ||
+	    ((segmentDuration > 0) && (segmentTimer.elapsed() >= segmentDuration)))) {
+		startNextSegment();
+	}
+
 	file.write(data, 188);
+	segmentBytes += 188;
+}
+
+QString DvbRecordingFile::getSegmentFileName(int number) const
+{
+	return segmentPath + QLatin1Char('.') + QString(QLatin1String("%1")).arg(number, 4, 10,
+		QLatin1Char('0')) + QLatin1String(".m2t");
+}
+
+void DvbRecordingFile::startNextSegment()
+{
+	QString fileName = getSegmentFileName(segmentNumber + 1);
+	qint64 duration = segmentTimer.elapsed();
+	segmentBytes = 0;
+	segmentTimer.start();
+
+	if (!file.openNext(fileName)) {
+		// try again after the next segment
+		Log("DvbRecordingFile::startNextSegment: cannot open file") << fileName;
+		return;
+	}
+
+	++segmentNumber;
+	segments.last().duration = int(duration / 1000);
+	segments.append(DvbRecordingSegment(fileName));
+
+	// each segment can be played on its own
+	file.write(patGenerator.generatePackets());
+	file.write(pmtGenerator.generatePackets());
+
+	while ((segmentRetention > 0) && (segments.size() > segmentRetention)) {
+		// the io thread removes the file after it has been closed
+		file.removeFile(segments.takeFirst().fileName);
+	}
+
+	writeManifest();
+}
+
+void DvbRecordingFile::writeManifest()
+{
+	if (!segmentManifest) {
+		return;
+	}
+
+	// readers of the manifest (post processing) shouldn't see a partial file
+	QString manifestFileName = segmentPath + QLatin1String(".m3u");
+	QString tempFileName = manifestFileName + QLatin1String(".part");
+	QFile manifestFile(tempFileName);
+
+	if (!manifestFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		Log("DvbRecordingFile::writeManifest: cannot open file") << tempFileName;
+		return;
+	}
+
+	QTextStream stream(&manifestFile);
+	stream.setCodec("UTF-8");
+	stream << "#EXTM3U\n";
+
+	foreach (const DvbRecordingSegment &segment, segments) {
+		stream << "#EXTINF:" << segment.duration << ",\n";
+		stream << QFileInfo(segment.fileName).fileName() << '\n';
+	}
+
+	stream.flush();
+	manifestFile.close();
+	QFile::remove(manifestFileName);
+
+	if (!QFile::rename(tempFileName, manifestFileName)) {
+		Log("DvbRecordingFile::writeManifest: cannot rename file") << tempFileName;
+	}
 }
 
@@ -22,12 +22,38 @@
 #define DVBRECORDING_H
 
 #include <QDateTime>
+#include <QStringList>
 #include <QTextStream>
+#include <QTimer>
 #include "dvbchannel.h"
 
+class DvbAutoRecorder;
+class DvbEpgModel;
 class DvbManager;
+class DvbMuxExtractor;
+class DvbMuxRecording;
+class DvbMuxRecordingJob;
+class DvbPmtParser;
 class DvbRecordingFile;
-class DvbEpgEntry;
+
+// the elementary streams of a service which are recorded; the string form looks like
+// "audio:deu,eng noad notext sub:deu" ("all" = everything)
+
+class DvbStreamSelection
+{
+public:
+	DvbStreamSelection() : dropAudioDescription(false), dropTeletext(false) { }
+	explicit DvbStreamSelection(const QString &string);
+	~DvbStreamSelection() { }
+
+	QString toString() const;
+	QList<int> selectPids(const DvbPmtParser &pmtParser) const;
+
+	QStringList audioLanguages; // empty = all audio streams
+	QString subtitleLanguage; // empty = all subtitle streams
+	bool dropAudioDescription;
+	bool dropTeletext;
+};
 
 class DvbRecording : public SharedData, public SqlKey
 {
@@ -51,6 +77,7 @@ public:
 	QString filename;
 	QString subheading;
 	QString details;
+	QString streams; // see DvbStreamSelection; empty = default selection
 	DvbSharedChannel channel;
 	QDateTime begin; // UTC
 	QDateTime end; // UTC, read-only
@@ -67,6 +94,18 @@ public:
 typedef ExplicitlySharedDataPointer<const DvbRecording> DvbSharedRecording;
 Q_DECLARE_TYPEINFO(DvbSharedRecording, Q_MOVABLE_TYPE);
 
+class DvbRecordingDeadline
+{
+public:
+	DvbRecordingDeadline() { }
+	DvbRecordingDeadline(const QDateTime &dateTime_, const SqlKey &sqlKey_) :
+		dateTime(dateTime_), sqlKey(sqlKey_) { }
+	~DvbRecordingDeadline() { }
+
+	QDateTime dateTime; // UTC
+	SqlKey sqlKey;
+};
+
 class DvbRecordingModel : public QObject, private SqlInterface
 {
 	Q_OBJECT
@@ -85,19 +124,37 @@ public:
 	void updateRecording(DvbSharedRecording recording, DvbRecording &modifiedRecording);
 	void removeRecording(DvbSharedRecording recording);
 	void addToUnwantedRecordings(DvbSharedRecording recording);
+	// the epg model is created after the recording model
+	void setEpgModel(DvbEpgModel *epgModel);
+	// checks all epg entries against the auto recording rules (asynchronously);
+	// new or updated epg entries are checked automatically
 	void findNewRecordings();
 	void removeDuplicates();
 	void executeActionAfterRecording(DvbRecording recording);
+	// the action is executed when 'fileName' has been closed by the writing thread
+	void executeActionAfterClosing(const QString &fileName, const DvbRecording &recording);
 	DvbRecording getCurrentRecording();
 	void setCurrentRecording(DvbRecording _currentRecording);
-	void disableLessImportant(DvbSharedRecording &recording1, DvbSharedRecording &recording2);
 	bool areInConflict(DvbSharedRecording recording1, DvbSharedRecording recording2);
-	bool isInConflictWithAll(DvbSharedRecording rec, QList<DvbSharedRecording> recList);
-	int getNumberOfLeastImportants(QList<DvbSharedRecording> recList);
-	DvbSharedRecording getLeastImportant(QList<DvbSharedRecording> recList);
-	void disableLeastImportants(QList<DvbSharedRecording> recList);
+	// disables the recordings which can't be assigned to a tuner (by priority)
 	void disableConflicts();
 	int getSecondsUntilNextRecording() const;
+	// returns true if another recording on the same transponder overlaps with 'recording'
+	bool hasOverlappingRecordings(const DvbRecording &recording) const;
+	// returns the transponder recording of the channel (it's created if necessary);
+	// returns NULL if it can't be started
+	DvbMuxRecording *acquireMuxRecording(const DvbSharedChannel &channel);
+	// 'job' describes the part of the transponder recording which has to be extracted
+	void releaseMuxRecording(DvbMuxRecording *muxRecording, const DvbMuxRecordingJob &job);
+	// called when the transponder recording is completely on disk
+	void extractMuxRecording(const QString &muxFileName, const QList<DvbMuxRecordingJob> &jobs);
+	// estimated size of the (remaining part of the) recording in bytes
+	qint64 estimateSize(const DvbRecording &recording) const;
+	// free space in the recording folder in bytes (-1 = unknown)
+	qint64 getAvailableSpace() const;
+	// returns the first scheduled recording which won't fit into the recording folder
+	// (or an invalid pointer); 'neededSpace' is the space needed up to its end
+	DvbSharedRecording findSpaceShortfall(qint64 &neededSpace, qint64 &availableSpace) const;
 	bool isScanWhenIdle() const;
 	bool shouldWeScanChannels() const;
 	void scanChannels();
@@ -109,18 +166,34 @@ signals:
 	void recordingUpdated(const DvbSharedRecording &recording);
 	void recordingRemoved(const DvbSharedRecording &recording);
 
+private slots:
+	void processDeadlines();
+	void recordingFileClosed(const QString &fileName);
+	void muxExtractorFinished();
+
 private:
-	void timerEvent(QTimerEvent *event);
+	// returns when the status of the recording has to be checked next
+	QDateTime getNextDeadline(const DvbRecording &recording,
+		const QDateTime &currentDateTime) const;
+	void scheduleDeadline(const DvbRecording &recording);
+	void updateDeadlineTimer();
 
 	void bindToSqlQuery(SqlKey sqlKey, QSqlQuery &query, int index) const;
 	bool insertFromSqlQuery(SqlKey sqlKey, const QSqlQuery &query, int index);
 	bool updateStatus(DvbRecording &recording);
-	bool existsSimilarRecording(DvbEpgEntry recording);
 
 	DvbManager *manager;
+	DvbAutoRecorder *autoRecorder;
 	QMap<SqlKey, DvbSharedRecording> recordings;
 	QList<DvbSharedRecording> unwantedRecordings;
+	// has to be declared before recordingFiles (stopping a recording file releases them)
+	QList<DvbMuxRecording *> muxRecordings;
+	QList<DvbMuxExtractor *> muxExtractors;
 	QMap<SqlKey, QExplicitlySharedDataPointer<DvbRecordingFile> > recordingFiles;
+	QMap<QString, DvbRecording> closingRecordingFiles; // key = file name
+	QVector<DvbRecordingDeadline> deadlines; // min-heap; may contain outdated deadlines
+	QMap<SqlKey, QDateTime> currentDeadlines;
+	QTimer deadlineTimer;
 	bool hasPendingOperation;
 	DvbRecording currentRecording;
 };
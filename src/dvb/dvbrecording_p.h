@@ -21,15 +21,155 @@
 #ifndef DVBRECORDING_P_H
 #define DVBRECORDING_P_H
 
-#include <QFile>
+#include <QAtomicInt>
+#include <QElapsedTimer>
+#include <QMap>
+#include <QRegExp>
+#include <QSet>
+#include <QThread>
 #include <QTimer>
 #include "dvbchannel.h"
+#include "dvbepg.h"
+#include "dvbmanager.h"
 #include "dvbsi.h"
+#include "dvbtswriter.h"
 
 class DvbDevice;
 class DvbManager;
 class DvbRecording;
 
+class DvbRecordingSegment
+{
+public:
+	DvbRecordingSegment() : duration(-1) { }
+	explicit DvbRecordingSegment(const QString &fileName_) : fileName(fileName_),
+		duration(-1) { }
+	~DvbRecordingSegment() { }
+
+	QString fileName;
+	int duration; // seconds; -1 = still being recorded
+};
+
+// the part of a transponder recording which belongs to a recording
+
+class DvbMuxRecordingJob
+{
+public:
+	DvbMuxRecordingJob() : pmtPid(-1), videoPid(-1), pcrPid(-1), beginOffset(0),
+		endOffset(0) { }
+	~DvbMuxRecordingJob() { }
+
+	SqlKey recordingKey;
+	QString fileName; // the extracted recording
+	QSet<int> pids; // all streams which have been selected during the recording
+	int pmtPid;
+	int videoPid; // for the index; -1 = unknown
+	int pcrPid; // -1 = unknown
+	DvbSectionGenerator patGenerator;
+	DvbSectionGenerator pmtGenerator;
+	qint64 beginOffset; // in the transponder recording
+	qint64 endOffset;
+};
+
+// records the selected streams of all running recordings on a transponder into one file
+// (together with the pat and the original pmts); the recordings are extracted into their
+// own files after the last one has stopped
+
+class DvbMuxRecording : private QObject, private DvbPidFilter
+{
+	Q_OBJECT
+public:
+	explicit DvbMuxRecording(DvbManager *manager_);
+	~DvbMuxRecording();
+
+	bool open(const DvbSharedChannel &channel_);
+	// the object deletes itself when the file is completely on disk (after starting the
+	// extraction if enabled)
+	void close();
+
+	DvbSharedChannel getChannel() const
+	{
+		return channel;
+	}
+
+	QString fileName() const
+	{
+		return file.fileName();
+	}
+
+	// the current end of the file
+	qint64 position() const
+	{
+		return file.position();
+	}
+
+	// the pids are reference counted
+	void addPid(int pid);
+	void removePid(int pid);
+
+	// the pmt pid of the recording is added as well
+	void addRecording(int pmtPid);
+	// returns true if it was the last recording
+	bool removeRecording(const DvbMuxRecordingJob &job);
+
+private slots:
+	void deviceStateChanged();
+	void fileClosed(const QString &muxFileName);
+
+private:
+	void releaseDevice();
+	void processData(const char data[188]);
+
+	DvbManager *manager;
+	DvbSharedChannel channel;
+	DvbDevice *device;
+	DvbTsWriter file;
+	QMap<int, int> pids; // pid -> reference count
+	int recordingCount;
+	QList<DvbMuxRecordingJob> jobs;
+};
+
+// owned by DvbRecordingModel; the transponder recording is removed if everything has been
+// extracted
+
+class DvbMuxExtractor : public QThread
+{
+public:
+	DvbMuxExtractor(const QString &muxFileName_, const QList<DvbMuxRecordingJob> &jobs_);
+	~DvbMuxExtractor();
+
+	// the partially extracted files are removed (the transponder recording is kept)
+	void cancel();
+
+	QString getMuxFileName() const
+	{
+		return muxFileName;
+	}
+
+	// the jobs which have been extracted (with the final file names); only valid after
+	// the thread has finished
+	QList<DvbMuxRecordingJob> getExtractedJobs() const
+	{
+		return extractedJobs;
+	}
+
+private:
+	enum Constants {
+		BufferSize = (4096 * 188),
+		PatPmtInterval = 2048 // packets
+	};
+
+	void run();
+	// on failure the partially extracted file and its index are removed
+	bool extract(QFile &muxFile, DvbMuxRecordingJob &job);
+	static void removeOutput(QFile &file, TsIndexWriter &index);
+
+	QString muxFileName;
+	QList<DvbMuxRecordingJob> jobs;
+	QList<DvbMuxRecordingJob> extractedJobs;
+	QAtomicInt cancelled;
+};
+
 class DvbRecordingFile : private QObject, public QSharedData, private DvbPidFilter
 {
 	Q_OBJECT
@@ -37,6 +177,14 @@ public:
 	explicit DvbRecordingFile(DvbManager *manager_);
 	~DvbRecordingFile();
 
+	// tunes the device and waits for the pmt (without writing anything)
+	bool prepare(const DvbRecording &recording);
+
+	bool isPrepared() const
+	{
+		return (device != NULL);
+	}
+
 	// start() returns true if the recording is already running
 	bool start(DvbRecording &recording);
 	void stop();
@@ -47,12 +195,44 @@ private slots:
 	void insertPatPmt();
 
 private:
+	enum {
+		MinimumAvailableSpace = (64 << 20)
+	};
+
+	bool isRecording() const
+	{
+		return (file.isOpen() || (muxRecording != NULL));
+	}
+
+	QString getBaseName(const DvbRecording &recording) const;
+	bool startMuxRecording(DvbRecording &recording);
+	void addPid(int pid);
+	void removePid(int pid);
 	void processData(const char data[188]);
+	QString getSegmentFileName(int number) const;
+	void startNextSegment();
+	void writeManifest();
 
 	DvbManager *manager;
 	DvbSharedChannel channel;
-	QFile file;
+	DvbStreamSelection streamSelection;
+	DvbTsWriter file;
+	QElapsedTimer recordingTimer;
+	DvbMuxRecording *muxRecording; // the file isn't used if set
+	DvbMuxRecordingJob muxJob;
+
+	// recordings are split into segments if a limit is set
+	QString segmentPath; // without number and extension; empty = not segmented
+	qint64 segmentSize; // bytes; 0 = no limit
+	qint64 segmentDuration; // ms; 0 = no limit
+	int segmentRetention; // 0 = keep all segments
+	bool segmentManifest;
+	int segmentNumber;
+	qint64 segmentBytes;
+	QElapsedTimer segmentTimer;
+	QList<DvbRecordingSegment> segments; // the segments which haven't been deleted
 	QList<QByteArray> buffers;
+	bool spaceWarningShown;
 	DvbDevice *device;
 	QList<int> pids;
 	DvbPmtFilter pmtFilter;
@@ -63,4 +243,118 @@ private:
 	bool pmtValid;
 };
 
+class DvbRecordingTuner
+{
+public:
+	DvbRecordingTuner() : maxDuration(0) { }
+	~DvbRecordingTuner() { }
+
+	// returns false if the tuner can't receive the source of 'recording' or if it's tuned
+	// to another transponder while 'recording' runs; 'shared' is set if the tuner is
+	// already tuned to the transponder of 'recording' during that time
+	bool isAvailable(const DvbSharedRecording &recording, bool &shared) const;
+
+	QMultiMap<QDateTime, DvbSharedRecording>::Iterator insert(
+		const DvbSharedRecording &recording);
+	// removes the recordings which begin in [begin, end)
+	void remove(const QDateTime &begin, const QDateTime &end);
+
+	QStringList sources;
+	QMultiMap<QDateTime, DvbSharedRecording> recordings; // key = begin
+	qint64 maxDuration; // seconds; upper bound for the duration of all recordings
+};
+
+// assigns recordings to the configured tuners; recordings of services on the same
+// transponder can share a tuner; the overlap checks look at the recordings of a tuner
+// around the begin of a recording only
+
+class DvbRecordingScheduler
+{
+public:
+	explicit DvbRecordingScheduler(const QList<DvbDeviceConfig> &deviceConfigs);
+	~DvbRecordingScheduler();
+
+	bool hasTuners() const
+	{
+		return !tuners.isEmpty();
+	}
+
+	// returns false if there's certainly no assignment of the recordings added so far and
+	// the new recording to the tuners (the recordings added so far are never given up);
+	// if the search for an assignment is aborted, the recording is kept
+	bool add(const DvbSharedRecording &recording);
+
+private:
+	enum {
+		MaxSearchSteps = 10000
+	};
+
+	int findTuner(const DvbSharedRecording &recording) const;
+	bool assign(const QList<DvbSharedRecording> &pending, int index, int &steps);
+
+	QList<DvbRecordingTuner> tuners;
+};
+
+class DvbAutoRecordingRule
+{
+public:
+	DvbAutoRecordingRule() : priority(0), isPlainText(false) { }
+	~DvbAutoRecordingRule() { }
+
+	QString pattern;
+	QRegExp regex;
+	int priority;
+	QString streams; // see DvbStreamSelection
+	bool isPlainText; // can be looked up in the epg text index
+};
+
+// checks new or updated epg entries against the auto recording rules; the checks are
+// deferred to the event loop (the epg and recording models can't be modified from their
+// own signals and stopping a recording mustn't wait for them)
+
+class DvbAutoRecorder : public QObject
+{
+	Q_OBJECT
+public:
+	DvbAutoRecorder(DvbManager *manager_, QObject *parent);
+	~DvbAutoRecorder();
+
+	void setEpgModel(DvbEpgModel *epgModel_);
+
+	// recompiles the rules and checks all epg entries
+	void checkAllEntries();
+	// has to be called if the epg recordings or the unwanted recordings have changed
+	// outside of the epg model signals
+	void invalidateIndex();
+
+	bool existsSimilarRecording(const DvbEpgEntry &entry);
+
+private slots:
+	void entryAdded(const DvbSharedEpgEntry &entry);
+	void entriesAdded(const QList<DvbSharedEpgEntry> &entries);
+	void entryUpdated(const DvbSharedEpgEntry &entry);
+	void entryRemoved(const DvbSharedEpgEntry &entry);
+	void entriesRemoved(const QList<DvbSharedEpgEntry> &entries);
+	void checkEntries();
+
+private:
+	void compileRules();
+	bool checkEntry(const DvbAutoRecordingRule &rule, const DvbSharedEpgEntry &entry);
+	void updateIndex();
+	static QString unwantedKey(const QString &channelName, const QDateTime &begin,
+		int duration);
+
+	DvbManager *manager;
+	DvbEpgModel *epgModel;
+	QList<DvbAutoRecordingRule> rules;
+	bool rulesValid;
+	bool checkAll;
+	QList<DvbSharedEpgEntry> pendingEntries;
+	QTimer checkTimer;
+	// similar recording index
+	QMultiHash<QString, DvbSharedEpgEntry> scheduledEntries; // key = channel name
+	QSet<QString> unwantedKeys;
+	bool indexValid;
+};
+
 #endif /* DVBRECORDING_P_H */
@@ -31,6 +31,7 @@
 #include <KLocalizedString>
 #include <KComboBox>
 #include <KLineEdit>
+#include <KIO/Global>
 #include "../datetimeedit.h"
 #include "../log.h"
 #include "dvbchanneldialog.h"
@@ -78,6 +79,19 @@ DvbRecordingDialog::DvbRecordingDialog(DvbManager *manager_, QWidget *parent) :
 	QBoxLayout *mainLayout = new QVBoxLayout(this);
 	mainLayout->addLayout(boxLayout);
 	mainLayout->addWidget(treeView);
+
+	spaceLabel = new QLabel(this);
+	spaceLabel->setWordWrap(true);
+	mainLayout->addWidget(spaceLabel);
+	DvbRecordingModel *recordingModel = manager->getRecordingModel();
+	connect(recordingModel, SIGNAL(recordingAdded(DvbSharedRecording)),
+		this, SLOT(updateSpaceLabel()));
+	connect(recordingModel, SIGNAL(recordingUpdated(DvbSharedRecording)),
+		this, SLOT(updateSpaceLabel()));
+	connect(recordingModel, SIGNAL(recordingRemoved(DvbSharedRecording)),
+		this, SLOT(updateSpaceLabel()));
+	updateSpaceLabel();
+
     QDialogButtonBox* buttonBox = new QDialogButtonBox(QDialogButtonBox::Close);
     connect(buttonBox, SIGNAL(rejected()), SLOT(reject()));
     mainLayout->addWidget(buttonBox);
@@ -97,6 +111,25 @@ void DvbRecordingDialog::showDialog(DvbManager *manager_, QWidget *parent)
 	dialog->show();
 }
 
+void DvbRecordingDialog::updateSpaceLabel()
+{
+	qint64 neededSpace;
+	qint64 availableSpace;
+	DvbSharedRecording recording =
+		manager->getRecordingModel()->findSpaceShortfall(neededSpace, availableSpace);
+
+	if (!recording.isValid()) {
+		spaceLabel->hide();
+		return;
+	}
+
+	spaceLabel->setText(i18n("Not enough disk space: the recordings up to \"%1\" (%2) need about %3, "
+		"but only %4 are available.", recording->name,
+		QLocale().toString(recording->begin.toLocalTime(), QLocale::ShortFormat),
+		KIO::convertSize(neededSpace), KIO::convertSize(availableSpace)));
+	spaceLabel->show();
+}
+
 void DvbRecordingDialog::newRecording()
 {
 	QDialog *dialog = new DvbRecordingEditor(manager, DvbSharedRecording(), this);
@@ -447,6 +480,15 @@ DvbRecordingEditor::DvbRecordingEditor(DvbManager *manager_, const DvbSharedReco
 
 	gridLayout->addLayout(dayLayout, 6, 1);
 
+	streamsEdit = new KLineEdit(widget);
+	streamsEdit->setToolTip(i18n("Streams to record, for example \"audio:deu,eng noad notext sub:deu\" "
+		"(\"all\" records everything). Leave empty to use the general options."));
+	gridLayout->addWidget(streamsEdit, 7, 1);
+
+	label = new QLabel(i18nc("@label recording", "Streams:"), widget);
+	label->setBuddy(streamsEdit);
+	gridLayout->addWidget(label, 7, 0);
+
     QBoxLayout* mainLayout = new QVBoxLayout(this);
     mainLayout->addWidget(widget);
     buttonBox = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel);
@@ -460,6 +502,7 @@ DvbRecordingEditor::DvbRecordingEditor(DvbManager *manager_, const DvbSharedReco
 		channelBox->setCurrentIndex(channelModel->find(recording->channel).row());
 		beginEdit->setDateTime(recording->begin.toLocalTime());
 		durationEdit->setTime(recording->duration);
+		streamsEdit->setText(recording->streams);
 
 		for (int i = 0; i < 7; ++i) {
 			if ((recording->repeat & (1 << i)) != 0) {
@@ -475,6 +518,7 @@ DvbRecordingEditor::DvbRecordingEditor(DvbManager *manager_, const DvbSharedReco
 			nameEdit->setEnabled(false);
 			channelBox->setEnabled(false);
 			beginEdit->setEnabled(false);
+			streamsEdit->setEnabled(false);
 			break;
 		}
 	} else {
@@ -541,6 +585,7 @@ void DvbRecordingEditor::accept()
 		manager->getChannelModel()->findChannelByName(channelBox->currentText());
 	newRecording.begin = beginEdit->dateTime().toUTC();
 	newRecording.duration = durationEdit->time();
+	newRecording.streams = streamsEdit->text().trimmed();
 
 	for (int i = 0; i < 7; ++i) {
 		if (dayCheckBoxes[i]->isChecked()) {
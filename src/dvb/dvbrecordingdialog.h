@@ -23,6 +23,7 @@
 
 #include <QDialog>
 
+class QLabel;
 class QTreeView;
 class DvbManager;
 class DvbRecordingTableModel;
@@ -40,11 +41,13 @@ private slots:
 	void newRecording();
 	void editRecording();
 	void removeRecording();
+	void updateSpaceLabel();
 
 private:
 	DvbManager *manager;
 	DvbRecordingTableModel *model;
 	QTreeView *treeView;
+	QLabel *spaceLabel;
 };
 
 #endif /* DVBRECORDINGDIALOG_H */
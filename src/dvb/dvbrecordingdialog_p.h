@@ -142,6 +142,7 @@ private:
 	DurationEdit *durationEdit;
 	DateTimeEdit *endEdit;
 	QCheckBox *dayCheckBoxes[7];
+	KLineEdit *streamsEdit;
     QDialogButtonBox* buttonBox;
 };
 
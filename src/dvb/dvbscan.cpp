@@ -243,175 +243,16 @@ void DvbScanFilter::timerEvent(QTimerEvent *)
 
 DvbScan::DvbScan(DvbDevice *device_, const QString &source_, const DvbTransponder &transponder_) :
 	device(device_), source(source_), transponder(transponder_), isLive(true), isAuto(false),
-	transponderIndex(-1), state(ScanPat), patIndex(0), activeFilters(0)
+	coordinator(NULL), state(ScanPat), patIndex(0), activeFilters(0)
 {
 }
 
-DvbScan::DvbScan(DvbDevice *device_, const QString &source_,
-	const QList<DvbTransponder> &transponders_) : device(device_), source(source_),
-	isLive(false), isAuto(false), transponders(transponders_), transponderIndex(0),
-	state(ScanTune), patIndex(0), activeFilters(0)
+DvbScan::DvbScan(DvbDevice *device_, const QString &source_, DvbScanCoordinator *coordinator_,
+	bool isAuto_) : device(device_), source(source_), isLive(false), isAuto(isAuto_),
+	coordinator(coordinator_), state(ScanTune), patIndex(0), activeFilters(0)
 {
 }
 
-DvbScan::DvbScan(DvbDevice *device_, const QString &source_, const QString &autoScanSource) :
-	device(device_), source(source_), isLive(false), isAuto(true), transponderIndex(0),
-	state(ScanTune), patIndex(0), activeFilters(0)
-{
-	if ((autoScanSource == QLatin1String("AUTO-Normal")) || (autoScanSource == QLatin1String("AUTO-Offsets"))) {
-		bool offsets = (autoScanSource == QLatin1String("AUTO-Offsets"));
-
-		for (int frequency = 177500000; frequency <= 226500000; frequency += 7000000) {
-			DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-			DvbTTransponder *dvbTTransponder = currentTransponder.as<DvbTTransponder>();
-			dvbTTransponder->frequency = frequency;
-			dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth7MHz;
-			dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-			dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-			dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-			dvbTTransponder->transmissionMode = DvbTTransponder::TransmissionModeAuto;
-			dvbTTransponder->guardInterval = DvbTTransponder::GuardIntervalAuto;
-			dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-			transponders.append(currentTransponder);
-		}
-
-		for (int frequency = 474000000; frequency <= 858000000; frequency += 8000000) {
-			for (int i = 0; i < 3; ++i) {
-				if ((i != 0) && (!offsets)) {
-					break;
-				}
-
-				int offset = 0;
-
-				if (i == 1) {
-					offset = -167000;
-				} else if (i == 2) {
-					offset = 167000;
-				}
-
-				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-				DvbTTransponder *dvbTTransponder =
-					currentTransponder.as<DvbTTransponder>();
-				dvbTTransponder->frequency = frequency + offset;
-				dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth8MHz;
-				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-				dvbTTransponder->transmissionMode =
-					DvbTTransponder::TransmissionModeAuto;
-				dvbTTransponder->guardInterval =
-					DvbTTransponder::GuardIntervalAuto;
-				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-				transponders.append(currentTransponder);
-			}
-		}
-	} else if (autoScanSource == QLatin1String("AUTO-Australia")) {
-		for (int frequency = 177500000; frequency <= 226500000; frequency += 7000000) {
-			for (int i = 0; i < 2; ++i) {
-				int offset = 0;
-
-				if (i == 1) {
-					offset = 125000;
-				}
-
-				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-				DvbTTransponder *dvbTTransponder =
-					currentTransponder.as<DvbTTransponder>();
-				dvbTTransponder->frequency = frequency + offset;
-				dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth7MHz;
-				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-				dvbTTransponder->transmissionMode =
-					DvbTTransponder::TransmissionModeAuto;
-				dvbTTransponder->guardInterval =
-					DvbTTransponder::GuardIntervalAuto;
-				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-				transponders.append(currentTransponder);
-			}
-		}
-
-		for (int frequency = 529500000; frequency <= 816500000; frequency += 7000000) {
-			for (int i = 0; i < 2; ++i) {
-				int offset = 0;
-
-				if (i == 1) {
-					offset = 125000;
-				}
-
-				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-				DvbTTransponder *dvbTTransponder =
-					currentTransponder.as<DvbTTransponder>();
-				dvbTTransponder->frequency = frequency + offset;
-				dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth7MHz;
-				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-				dvbTTransponder->transmissionMode =
-					DvbTTransponder::TransmissionModeAuto;
-				dvbTTransponder->guardInterval =
-					DvbTTransponder::GuardIntervalAuto;
-				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-				transponders.append(currentTransponder);
-			}
-		}
-	} else if (autoScanSource == QLatin1String("AUTO-Italy")) {
-		static const int italyVhf[] = { 177500000, 186000000, 194500000, 203500000,
-						212500000, 219500000, 226500000 };
-
-		for (unsigned i = 0; i < (sizeof(italyVhf) / sizeof(italyVhf[0])); ++i) {
-			for (int j = 0; j < 2; ++j) {
-				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-				DvbTTransponder *dvbTTransponder =
-					currentTransponder.as<DvbTTransponder>();
-				dvbTTransponder->frequency = italyVhf[i];
-				dvbTTransponder->bandwidth = ((j == 0) ?
-					DvbTTransponder::Bandwidth7MHz :
-					DvbTTransponder::Bandwidth8MHz);
-				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-				dvbTTransponder->transmissionMode =
-					DvbTTransponder::TransmissionModeAuto;
-				dvbTTransponder->guardInterval =
-					DvbTTransponder::GuardIntervalAuto;
-				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-				transponders.append(currentTransponder);
-			}
-		}
-
-		for (int frequency = 474000000; frequency <= 858000000; frequency += 8000000) {
-			DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-			DvbTTransponder *dvbTTransponder =
-				currentTransponder.as<DvbTTransponder>();
-			dvbTTransponder->frequency = frequency;
-			dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth8MHz;
-			dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-			dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-			dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-			dvbTTransponder->transmissionMode = DvbTTransponder::TransmissionModeAuto;
-			dvbTTransponder->guardInterval = DvbTTransponder::GuardIntervalAuto;
-			dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-			transponders.append(currentTransponder);
-		}
-	} else if (autoScanSource == QLatin1String("AUTO-Taiwan")) {
-		for (int frequency = 527000000; frequency <= 599000000; frequency += 6000000) {
-			DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
-			DvbTTransponder *dvbTTransponder =
-				currentTransponder.as<DvbTTransponder>();
-			dvbTTransponder->frequency = frequency;
-			dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth6MHz;
-			dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
-			dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
-			dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
-			dvbTTransponder->transmissionMode = DvbTTransponder::TransmissionModeAuto;
-			dvbTTransponder->guardInterval = DvbTTransponder::GuardIntervalAuto;
-			dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
-			transponders.append(currentTransponder);
-		}
-	}
-}
-
 DvbScan::~DvbScan()
 {
 	qDeleteAll(filters);
@@ -423,9 +264,21 @@ void DvbScan::start()
 	updateState();
 }
 
+void DvbScan::resume()
+{
+	if (state == ScanIdle) {
+		state = ScanTune;
+		updateState();
+	}
+}
+
 void DvbScan::deviceStateChanged()
 {
 	if (device->getDeviceState() == DvbDevice::DeviceReleased) {
+		if (coordinator != NULL) {
+			coordinator->deviceReleased(this, device, transponder);
+		}
+
 		emit scanFinished();
 		return;
 	}
@@ -556,18 +409,17 @@ void DvbScan::updateState()
 		    }
 			// fall through
 		case ScanTune: {
-			if (transponders.size() > 0) {
-				emit scanProgress((100 * transponderIndex) / transponders.size());
-			}
+			if (!coordinator->takeTransponder(this, device, &transponder)) {
+				if (coordinator->isFinished()) {
+					emit scanFinished();
+				} else {
+					// other devices may still find transponders in the NIT
+					state = ScanIdle;
+				}
 
-			if (transponderIndex >= transponders.size()) {
-				emit scanFinished();
 				return;
 			}
 
-			transponder = transponders.at(transponderIndex);
-			++transponderIndex;
-
 			state = ScanTuning;
 
 			if (!isAuto) {
@@ -579,6 +431,9 @@ void DvbScan::updateState()
 			return;
 		    }
 
+		case ScanIdle:
+			return;
+
 		case ScanTuning: {
 			switch (device->getDeviceState()) {
 			case DvbDevice::DeviceIdle:
@@ -586,11 +441,6 @@ void DvbScan::updateState()
 				break;
 
 			case DvbDevice::DeviceTuned:
-				if (isAuto) {
-					transponders[transponderIndex - 1] =
-						device->getAutoTransponder();
-				}
-
 				state = ScanPat;
 				break;
 
@@ -993,10 +843,6 @@ void DvbScan::processNitDescriptor(const DvbDescriptor &descriptor)
 			newTransponder = DvbTransponder(DvbTransponderBase::DvbS);
 			dvbSTransponder = newTransponder.as<DvbSTransponder>();
 		} else {
-			if ((device->getTransmissionTypes() & DvbDevice::DvbS2) == 0) {
-				break;
-			}
-
 			newTransponder = DvbTransponder(DvbTransponderBase::DvbS2);
 			DvbS2Transponder *dvbS2Transponder = newTransponder.as<DvbS2Transponder>();
 			dvbS2Transponder->modulation = extractDvbS2Modulation(satelliteDescriptor);
@@ -1046,24 +892,360 @@ void DvbScan::processNitDescriptor(const DvbDescriptor &descriptor)
 	}
 
 	if (newTransponder.isValid()) {
-		bool duplicate = false;
+		coordinator->addTransponder(newTransponder);
+	}
+}
+
+void DvbScan::filterFinished(DvbScanFilter *filter)
+{
+	filter->stopFilter();
+	--activeFilters;
+	updateState();
+}
+
+DvbScanCoordinator::DvbScanCoordinator(DvbDevice *device, const QString &source,
+	const DvbTransponder &transponder) : scannedTransponders(0), finished(false)
+{
+	devices.append(device);
+	addScan(new DvbScan(device, source, transponder));
+}
+
+DvbScanCoordinator::DvbScanCoordinator(const QList<DvbDevice *> &devices_, const QString &source,
+	const QList<DvbTransponder> &transponders_) : devices(devices_),
+	transponders(transponders_), pendingTransponders(transponders_), scannedTransponders(0),
+	finished(false)
+{
+	foreach (DvbDevice *device, devices) {
+		addScan(new DvbScan(device, source, this, false));
+	}
+}
+
+DvbScanCoordinator::DvbScanCoordinator(const QList<DvbDevice *> &devices_, const QString &source,
+	const QString &autoScanSource) : devices(devices_), scannedTransponders(0), finished(false)
+{
+	transponders = getAutoScanTransponders(autoScanSource);
+	pendingTransponders = transponders;
+
+	foreach (DvbDevice *device, devices) {
+		addScan(new DvbScan(device, source, this, true));
+	}
+}
+
+DvbScanCoordinator::~DvbScanCoordinator()
+{
+	qDeleteAll(scans);
+}
+
+void DvbScanCoordinator::start()
+{
+	foreach (DvbScan *scan, scans) {
+		scan->start();
+	}
+}
+
+bool DvbScanCoordinator::takeTransponder(DvbScan *scan, DvbDevice *device,
+	DvbTransponder *transponder)
+{
+	if (busyDevices.remove(device)) {
+		++scannedTransponders;
+	}
+
+	if (!transponders.isEmpty()) {
+		emit scanProgress((100 * scannedTransponders) / transponders.size());
+	}
+
+	for (int i = 0; i < pendingTransponders.size(); ++i) {
+		if (canTune(device, pendingTransponders.at(i))) {
+			*transponder = pendingTransponders.takeAt(i);
+			busyDevices.insert(device);
+			return true;
+		}
+	}
+
+	if (!finished) {
+		idleScans.append(scan);
+		checkFinished();
+	}
+
+	return false;
+}
+
+void DvbScanCoordinator::addTransponder(const DvbTransponder &transponder)
+{
+	bool canBeTuned = false;
+
+	foreach (DvbDevice *device, devices) {
+		if (canTune(device, transponder)) {
+			canBeTuned = true;
+			break;
+		}
+	}
 
-		foreach (const DvbTransponder &existingTransponder, transponders) {
-			if (existingTransponder.corresponds(newTransponder)) {
-				duplicate = true;
+	if (!canBeTuned) {
+		return;
+	}
+
+	foreach (const DvbTransponder &existingTransponder, transponders) {
+		if (existingTransponder.corresponds(transponder)) {
+			return;
+		}
+	}
+
+	transponders.append(transponder);
+	pendingTransponders.append(transponder);
+	// an idle device takes it (the other ones become idle again)
+	resumeIdleScans();
+}
+
+void DvbScanCoordinator::deviceReleased(DvbScan *scan, DvbDevice *device,
+	const DvbTransponder &transponder)
+{
+	devices.removeAll(device);
+	idleScans.removeAll(scan);
+
+	if (busyDevices.remove(device)) {
+		// another device scans it instead
+		pendingTransponders.prepend(transponder);
+		resumeIdleScans();
+	}
+
+	checkFinished();
+}
+
+void DvbScanCoordinator::scanFoundChannels(const QList<DvbPreviewChannel> &channels)
+{
+	QList<DvbPreviewChannel> newChannels;
+
+	foreach (const DvbPreviewChannel &channel, channels) {
+		// a transponder may be scanned twice (e.g. at a slightly different frequency
+		// from the NIT); services on other transponders are different channels
+		quint64 service = ((quint64(quint16(channel.networkId)) << 32) |
+			(quint64(quint16(channel.transportStreamId)) << 16) |
+			quint16(channel.serviceId));
+		QList<DvbTransponder> &serviceTransponders = services[service];
+		bool found = false;
+
+		foreach (const DvbTransponder &transponder, serviceTransponders) {
+			if (transponder.corresponds(channel.transponder)) {
+				found = true;
 				break;
 			}
 		}
 
-		if (!duplicate) {
-			transponders.append(newTransponder);
+		if (!found) {
+			serviceTransponders.append(channel.transponder);
+			newChannels.append(channel);
 		}
 	}
+
+	if (!newChannels.isEmpty()) {
+		emit foundChannels(newChannels);
+	}
 }
 
-void DvbScan::filterFinished(DvbScanFilter *filter)
+void DvbScanCoordinator::scanStopped()
 {
-	filter->stopFilter();
-	--activeFilters;
-	updateState();
+	// a scan may report that its device has been released after it has finished
+	finishedScans.insert(qobject_cast<DvbScan *>(sender()));
+
+	if (finishedScans.size() == scans.size()) {
+		emit scanFinished();
+	}
+}
+
+void DvbScanCoordinator::resumeIdleScans()
+{
+	QList<DvbScan *> scansToResume = idleScans;
+	idleScans.clear();
+
+	foreach (DvbScan *scan, scansToResume) {
+		scan->resume();
+	}
+}
+
+void DvbScanCoordinator::checkFinished()
+{
+	if (!finished && busyDevices.isEmpty()) {
+		// the idle scans have tried all pending transponders; nothing can be added anymore
+		finished = true;
+		resumeIdleScans();
+	}
+}
+
+void DvbScanCoordinator::addScan(DvbScan *scan)
+{
+	connect(scan, SIGNAL(foundChannels(QList<DvbPreviewChannel>)),
+		this, SLOT(scanFoundChannels(QList<DvbPreviewChannel>)));
+	connect(scan, SIGNAL(scanFinished()), this, SLOT(scanStopped()));
+	scans.append(scan);
+}
+
+bool DvbScanCoordinator::canTune(DvbDevice *device, const DvbTransponder &transponder)
+{
+	// the other transmission types are determined by the source
+	if (transponder.getTransmissionType() == DvbTransponderBase::DvbS2) {
+		return ((device->getTransmissionTypes() & DvbDevice::DvbS2) != 0);
+	}
+
+	return true;
+}
+
+QList<DvbTransponder> DvbScanCoordinator::getAutoScanTransponders(const QString &autoScanSource)
+{
+	QList<DvbTransponder> transponders;
+
+	if ((autoScanSource == QLatin1String("AUTO-Normal")) || (autoScanSource == QLatin1String("AUTO-Offsets"))) {
+		bool offsets = (autoScanSource == QLatin1String("AUTO-Offsets"));
+
+		for (int frequency = 177500000; frequency <= 226500000; frequency += 7000000) {
+			DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+			DvbTTransponder *dvbTTransponder = currentTransponder.as<DvbTTransponder>();
+			dvbTTransponder->frequency = frequency;
+			dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth7MHz;
+			dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+			dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+			dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+			dvbTTransponder->transmissionMode = DvbTTransponder::TransmissionModeAuto;
+			dvbTTransponder->guardInterval = DvbTTransponder::GuardIntervalAuto;
+			dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+			transponders.append(currentTransponder);
+		}
+
+		for (int frequency = 474000000; frequency <= 858000000; frequency += 8000000) {
+			for (int i = 0; i < 3; ++i) {
+				if ((i != 0) && (!offsets)) {
+					break;
+				}
+
+				int offset = 0;
+
+				if (i == 1) {
+					offset = -167000;
+				} else if (i == 2) {
+					offset = 167000;
+				}
+
+				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+				DvbTTransponder *dvbTTransponder =
+					currentTransponder.as<DvbTTransponder>();
+				dvbTTransponder->frequency = frequency + offset;
+				dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth8MHz;
+				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+				dvbTTransponder->transmissionMode =
+					DvbTTransponder::TransmissionModeAuto;
+				dvbTTransponder->guardInterval =
+					DvbTTransponder::GuardIntervalAuto;
+				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+				transponders.append(currentTransponder);
+			}
+		}
+	} else if (autoScanSource == QLatin1String("AUTO-Australia")) {
+		for (int frequency = 177500000; frequency <= 226500000; frequency += 7000000) {
+			for (int i = 0; i < 2; ++i) {
+				int offset = 0;
+
+				if (i == 1) {
+					offset = 125000;
+				}
+
+				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+				DvbTTransponder *dvbTTransponder =
+					currentTransponder.as<DvbTTransponder>();
+				dvbTTransponder->frequency = frequency + offset;
+				dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth7MHz;
+				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+				dvbTTransponder->transmissionMode =
+					DvbTTransponder::TransmissionModeAuto;
+				dvbTTransponder->guardInterval =
+					DvbTTransponder::GuardIntervalAuto;
+				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+				transponders.append(currentTransponder);
+			}
+		}
+
+		for (int frequency = 529500000; frequency <= 816500000; frequency += 7000000) {
+			for (int i = 0; i < 2; ++i) {
+				int offset = 0;
+
+				if (i == 1) {
+					offset = 125000;
+				}
+
+				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+				DvbTTransponder *dvbTTransponder =
+					currentTransponder.as<DvbTTransponder>();
+				dvbTTransponder->frequency = frequency + offset;
+				dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth7MHz;
+				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+				dvbTTransponder->transmissionMode =
+					DvbTTransponder::TransmissionModeAuto;
+				dvbTTransponder->guardInterval =
+					DvbTTransponder::GuardIntervalAuto;
+				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+				transponders.append(currentTransponder);
+			}
+		}
+	} else if (autoScanSource == QLatin1String("AUTO-Italy")) {
+		static const int italyVhf[] = { 177500000, 186000000, 194500000, 203500000,
+						212500000, 219500000, 226500000 };
+
+		for (unsigned i = 0; i < (sizeof(italyVhf) / sizeof(italyVhf[0])); ++i) {
+			for (int j = 0; j < 2; ++j) {
+				DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+				DvbTTransponder *dvbTTransponder =
+					currentTransponder.as<DvbTTransponder>();
+				dvbTTransponder->frequency = italyVhf[i];
+				dvbTTransponder->bandwidth = ((j == 0) ?
+					DvbTTransponder::Bandwidth7MHz :
+					DvbTTransponder::Bandwidth8MHz);
+				dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+				dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+				dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+				dvbTTransponder->transmissionMode =
+					DvbTTransponder::TransmissionModeAuto;
+				dvbTTransponder->guardInterval =
+					DvbTTransponder::GuardIntervalAuto;
+				dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+				transponders.append(currentTransponder);
+			}
+		}
+
+		for (int frequency = 474000000; frequency <= 858000000; frequency += 8000000) {
+			DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+			DvbTTransponder *dvbTTransponder =
+				currentTransponder.as<DvbTTransponder>();
+			dvbTTransponder->frequency = frequency;
+			dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth8MHz;
+			dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+			dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+			dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+			dvbTTransponder->transmissionMode = DvbTTransponder::TransmissionModeAuto;
+			dvbTTransponder->guardInterval = DvbTTransponder::GuardIntervalAuto;
+			dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+			transponders.append(currentTransponder);
+		}
+	} else if (autoScanSource == QLatin1String("AUTO-Taiwan")) {
+		for (int frequency = 527000000; frequency <= 599000000; frequency += 6000000) {
+			DvbTransponder currentTransponder(DvbTransponderBase::DvbT);
+			DvbTTransponder *dvbTTransponder =
+				currentTransponder.as<DvbTTransponder>();
+			dvbTTransponder->frequency = frequency;
+			dvbTTransponder->bandwidth = DvbTTransponder::Bandwidth6MHz;
+			dvbTTransponder->modulation = DvbTTransponder::ModulationAuto;
+			dvbTTransponder->fecRateHigh = DvbTTransponder::FecAuto;
+			dvbTTransponder->fecRateLow = DvbTTransponder::FecNone;
+			dvbTTransponder->transmissionMode = DvbTTransponder::TransmissionModeAuto;
+			dvbTTransponder->guardInterval = DvbTTransponder::GuardIntervalAuto;
+			dvbTTransponder->hierarchy = DvbTTransponder::HierarchyNone;
+			transponders.append(currentTransponder);
+		}
+	}
+
+	return transponders;
 }
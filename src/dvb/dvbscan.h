@@ -21,6 +21,8 @@
 #ifndef DVBSCAN_H
 #define DVBSCAN_H
 
+#include <QHash>
+#include <QSet>
 #include "dvbchannel.h"
 
 class AtscVctSection;
@@ -30,6 +32,7 @@ class DvbNitSection;
 class DvbPatEntry;
 class DvbPatSection;
 class DvbPmtSection;
+class DvbScanCoordinator;
 class DvbScanFilter;
 class DvbSdtEntry;
 class DvbSdtSection;
@@ -70,22 +73,25 @@ public:
 	// int number;
 };
 
+// scans the current transponder or the transponders which are handed out by the coordinator
+// (one scan per device)
+
 class DvbScan : public QObject
 {
 	friend class DvbScanFilter;
 	Q_OBJECT
 public:
 	DvbScan(DvbDevice *device_, const QString &source_, const DvbTransponder &transponder_);
-	DvbScan(DvbDevice *device_, const QString &source_,
-		const QList<DvbTransponder> &transponders_);
-	DvbScan(DvbDevice *device_, const QString &source_, const QString &autoScanSource);
+	DvbScan(DvbDevice *device_, const QString &source_, DvbScanCoordinator *coordinator_,
+		bool isAuto_);
 	~DvbScan();
 
 	void start();
+	// continues an idle scan (see DvbScanCoordinator::takeTransponder())
+	void resume();
 
 signals:
 	void foundChannels(const QList<DvbPreviewChannel> &channels);
-	void scanProgress(int percentage);
 	void scanFinished();
 
 private slots:
@@ -108,7 +114,8 @@ private:
 		ScanSdt,
 		ScanPmt,
 		ScanTune,
-		ScanTuning
+		ScanTuning,
+		ScanIdle // waiting for the coordinator
 	};
 
 	bool startFilter(int pid, FilterType type);
@@ -127,10 +134,7 @@ private:
 	DvbTransponder transponder;
 	bool isLive;
 	bool isAuto;
-
-	// only used if isLive is false
-	QList<DvbTransponder> transponders;
-	int transponderIndex;
+	DvbScanCoordinator *coordinator; // only used if isLive is false
 
 	State state;
 	QList<DvbPatEntry> patEntries;
@@ -145,4 +149,69 @@ private:
 	int activeFilters;
 };
 
+// distributes the transponders of a source among several devices (which have been acquired
+// exclusively); the transponders found in the NIT are added to the same list (idle devices
+// wait for them until no device is busy anymore); the results are merged (every service is
+// reported once) and the progress is combined
+
+class DvbScanCoordinator : public QObject
+{
+	Q_OBJECT
+public:
+	// scans the current transponder of the (already tuned) device
+	DvbScanCoordinator(DvbDevice *device, const QString &source,
+		const DvbTransponder &transponder);
+	DvbScanCoordinator(const QList<DvbDevice *> &devices_, const QString &source,
+		const QList<DvbTransponder> &transponders_);
+	DvbScanCoordinator(const QList<DvbDevice *> &devices_, const QString &source,
+		const QString &autoScanSource);
+	~DvbScanCoordinator();
+
+	void start();
+
+	// returns false if there's no transponder left which the device can tune; the scan is
+	// idle then and resumed once a transponder has been added or once the scan of the
+	// source is finished (nothing is pending and no device is busy; see isFinished())
+	bool takeTransponder(DvbScan *scan, DvbDevice *device, DvbTransponder *transponder);
+	// ignored if the transponder is already known
+	void addTransponder(const DvbTransponder &transponder);
+	// the device has been taken (e.g. by a recording); the scan doesn't continue and the
+	// transponder which it was scanning is handed out again
+	void deviceReleased(DvbScan *scan, DvbDevice *device, const DvbTransponder &transponder);
+
+	bool isFinished() const
+	{
+		return finished;
+	}
+
+signals:
+	void foundChannels(const QList<DvbPreviewChannel> &channels);
+	void scanProgress(int percentage);
+	void scanFinished();
+
+private slots:
+	void scanFoundChannels(const QList<DvbPreviewChannel> &channels);
+	void scanStopped();
+
+private:
+	void addScan(DvbScan *scan);
+	void resumeIdleScans();
+	// the scan of the source is finished if no device is busy anymore
+	void checkFinished();
+	static bool canTune(DvbDevice *device, const DvbTransponder &transponder);
+	static QList<DvbTransponder> getAutoScanTransponders(const QString &autoScanSource);
+
+	QList<DvbScan *> scans;
+	QList<DvbDevice *> devices;
+	QList<DvbTransponder> transponders; // all known transponders
+	QList<DvbTransponder> pendingTransponders;
+	QSet<DvbDevice *> busyDevices; // a transponder has been handed out to these devices
+	QList<DvbScan *> idleScans; // waiting for a transponder
+	int scannedTransponders;
+	bool finished;
+	QSet<DvbScan *> finishedScans;
+	// network id, transport stream id and service id -> the transponders it was found on
+	QHash<quint64, QList<DvbTransponder> > services;
+};
+
 #endif /* DVBSCAN_H */
@@ -379,6 +379,10 @@ DvbScanDialog::DvbScanDialog(DvbManager *manager_, QWidget *parent) : QDialog(pa
 DvbScanDialog::~DvbScanDialog()
 {
 	delete internal;
+
+	foreach (DvbDevice *scanDevice, scanDevices) {
+		manager->releaseDevice(scanDevice, DvbManager::Exclusive);
+	}
 }
 
 void DvbScanDialog::scanButtonClicked(bool checked)
@@ -393,7 +397,11 @@ void DvbScanDialog::scanButtonClicked(bool checked)
 		internal = NULL;
 
 		if (!isLive) {
-			manager->releaseDevice(device, DvbManager::Exclusive);
+			foreach (DvbDevice *scanDevice, scanDevices) {
+				manager->releaseDevice(scanDevice, DvbManager::Exclusive);
+			}
+
+			scanDevices.clear();
 			setDevice(NULL);
 		}
 
@@ -409,20 +417,42 @@ void DvbScanDialog::scanButtonClicked(bool checked)
 
 	if (isLive) {
 		const DvbSharedChannel &channel = manager->getLiveView()->getChannel();
-		internal = new DvbScan(device, channel->source, channel->transponder);
+		internal = new DvbScanCoordinator(device, channel->source, channel->transponder);
 	} else {
 		QString source = sourceBox->currentText();
-		setDevice(manager->requestExclusiveDevice(source));
 
-		if (device != NULL) {
+		// the transponders are distributed among all idle devices of the source
+		while (true) {
+			DvbDevice *scanDevice = manager->requestExclusiveDevice(source);
+
+			if (scanDevice == NULL) {
+				break;
+			}
+
+			scanDevices.append(scanDevice);
+		}
+
+		if (!scanDevices.isEmpty()) {
+			setDevice(scanDevices.at(0));
 			// FIXME ugly
 			QString autoScanSource = manager->getAutoScanSource(source);
 
 			if (autoScanSource.isEmpty()) {
-				internal = new DvbScan(device, source,
-					manager->getTransponders(device, source));
+				// the list depends on the capabilities (dvb-s2); the coordinator
+				// hands out transponders only to devices which can tune them
+				DvbDevice *transponderDevice = device;
+
+				foreach (DvbDevice *scanDevice, scanDevices) {
+					if ((scanDevice->getTransmissionTypes() & DvbDevice::DvbS2) != 0) {
+						transponderDevice = scanDevice;
+						break;
+					}
+				}
+
+				internal = new DvbScanCoordinator(scanDevices, source,
+					manager->getTransponders(transponderDevice, source));
 			} else {
-				internal = new DvbScan(device, source, autoScanSource);
+				internal = new DvbScanCoordinator(scanDevices, source, autoScanSource);
 			}
 		} else {
 			scanButton->setChecked(false);
@@ -36,7 +36,7 @@ class DvbGradProgress;
 class DvbManager;
 class DvbPreviewChannel;
 class DvbPreviewChannelTableModel;
-class DvbScan;
+class DvbScanCoordinator;
 
 class DvbScanDialog : public QDialog
 {
@@ -77,11 +77,12 @@ private:
 	DvbPreviewChannelTableModel *previewModel;
 	QTreeView *scanResultsView;
 
-	DvbDevice *device;
+	DvbDevice *device; // the status of this device is shown
+	QList<DvbDevice *> scanDevices; // only used if isLive is false
 	QTimer statusTimer;
 	bool isLive;
 
-	DvbScan *internal;
+	DvbScanCoordinator *internal;
 };
 
 class DvbGradProgress : public QLabel
@@ -20,6 +20,7 @@
 
 #include "dvbsi.h"
 
+#include <QMutex>
 #include <QTextCodec>
 #include "../log.h"
 
@@ -242,7 +243,7 @@ QString DvbSiText::convertText(const char *data, int size)
 	}
 
 	// determine encoding
-	TextEncoding encoding = (override6937 ? Iso8859_1 : Iso6937);
+	TextEncoding encoding = ((override6937.load() != 0) ? Iso8859_1 : Iso6937);
 
 	if (quint8(data[0]) < 0x20) {
 		switch (data[0]) {
@@ -299,33 +300,7 @@ QString DvbSiText::convertText(const char *data, int size)
 		size--;
 	}
 
-	if (codecTable[encoding] == NULL) {
-		QTextCodec *codec = NULL;
-
-		switch (encoding) {
-		case Iso6937: codec = new Iso6937Codec(); break;
-		case Iso8859_1: codec = QTextCodec::codecForName("ISO 8859-1"); break;
-		case Iso8859_2: codec = QTextCodec::codecForName("ISO 8859-2"); break;
-		case Iso8859_3: codec = QTextCodec::codecForName("ISO 8859-3"); break;
-		case Iso8859_4: codec = QTextCodec::codecForName("ISO 8859-4"); break;
-		case Iso8859_5: codec = QTextCodec::codecForName("ISO 8859-5"); break;
-		case Iso8859_6: codec = QTextCodec::codecForName("ISO 8859-6"); break;
-		case Iso8859_7: codec = QTextCodec::codecForName("ISO 8859-7"); break;
-		case Iso8859_8: codec = QTextCodec::codecForName("ISO 8859-8"); break;
-		case Iso8859_9: codec = QTextCodec::codecForName("ISO 8859-9"); break;
-		case Iso8859_10: codec = QTextCodec::codecForName("ISO 8859-10"); break;
-		case Iso8859_11: codec = QTextCodec::codecForName("ISO 8859-11"); break;
-		case Iso8859_13: codec = QTextCodec::codecForName("ISO 8859-13"); break;
-		case Iso8859_14: codec = QTextCodec::codecForName("ISO 8859-14"); break;
-		case Iso8859_15: codec = QTextCodec::codecForName("ISO 8859-15"); break;
-		case Gb2312: codec = QTextCodec::codecForName("GB2312"); break;
-		case Big5: codec = QTextCodec::codecForName("BIG5"); break;
-		case Utf_8: codec = QTextCodec::codecForName("UTF-8"); break;
-		}
-
-		Q_ASSERT(codec != NULL);
-		codecTable[encoding] = codec;
-	}
+	QTextCodec *codec = getCodec(encoding);
 
 	if (encoding <= Iso8859_15) {
 		// only strip control codes for one-byte character tables
@@ -341,22 +316,66 @@ QString DvbSiText::convertText(const char *data, int size)
 			}
 		}
 
-		QString result = codecTable[encoding]->toUnicode(dest, int(destIt - dest));
+		QString result = codec->toUnicode(dest, int(destIt - dest));
 		delete[] dest;
 
 		return result;
 	}
 
-	return codecTable[encoding]->toUnicode(data, size);
+	return codec->toUnicode(data, size);
 }
 
 void DvbSiText::setOverride6937(bool override)
 {
-	override6937 = override;
+	override6937.store(override ? 1 : 0);
+}
+
+static QMutex codecTableMutex;
+
+QTextCodec *DvbSiText::getCodec(TextEncoding encoding)
+{
+	QTextCodec *codec = codecTable[encoding].loadAcquire();
+
+	if (codec != NULL) {
+		return codec;
+	}
+
+	QMutexLocker locker(&codecTableMutex);
+	codec = codecTable[encoding].loadAcquire();
+
+	if (codec != NULL) {
+		// another thread was faster
+		return codec;
+	}
+
+	switch (encoding) {
+	case Iso6937: codec = new Iso6937Codec(); break;
+	case Iso8859_1: codec = QTextCodec::codecForName("ISO 8859-1"); break;
+	case Iso8859_2: codec = QTextCodec::codecForName("ISO 8859-2"); break;
+	case Iso8859_3: codec = QTextCodec::codecForName("ISO 8859-3"); break;
+	case Iso8859_4: codec = QTextCodec::codecForName("ISO 8859-4"); break;
+	case Iso8859_5: codec = QTextCodec::codecForName("ISO 8859-5"); break;
+	case Iso8859_6: codec = QTextCodec::codecForName("ISO 8859-6"); break;
+	case Iso8859_7: codec = QTextCodec::codecForName("ISO 8859-7"); break;
+	case Iso8859_8: codec = QTextCodec::codecForName("ISO 8859-8"); break;
+	case Iso8859_9: codec = QTextCodec::codecForName("ISO 8859-9"); break;
+	case Iso8859_10: codec = QTextCodec::codecForName("ISO 8859-10"); break;
+	case Iso8859_11: codec = QTextCodec::codecForName("ISO 8859-11"); break;
+	case Iso8859_13: codec = QTextCodec::codecForName("ISO 8859-13"); break;
+	case Iso8859_14: codec = QTextCodec::codecForName("ISO 8859-14"); break;
+	case Iso8859_15: codec = QTextCodec::codecForName("ISO 8859-15"); break;
+	case Gb2312: codec = QTextCodec::codecForName("GB2312"); break;
+	case Big5: codec = QTextCodec::codecForName("BIG5"); break;
+	case Utf_8: codec = QTextCodec::codecForName("UTF-8"); break;
+	}
+
+	Q_ASSERT(codec != NULL);
+	codecTable[encoding].storeRelease(codec);
+	return codec;
 }
 
-QTextCodec *DvbSiText::codecTable[EncodingTypeMax + 1] = { NULL };
-bool DvbSiText::override6937 = false;
+QAtomicPointer<QTextCodec> DvbSiText::codecTable[EncodingTypeMax + 1];
+QAtomicInt DvbSiText::override6937;
 
 void DvbDescriptor::initDescriptor(const char *data, int size)
 {
@@ -1146,6 +1165,7 @@ DvbPmtParser::DvbPmtParser(const DvbPmtSection &section) : videoPid(-1), teletex
 	for (DvbPmtSectionEntry entry = section.entries(); entry.isValid(); entry.advance()) {
 		QString streamLanguage;
 		QString subtitleLanguage;
+		bool audioDescription = false;
 		bool teletextPresent = false;
 		bool ac3Present = false;
 
@@ -1164,6 +1184,8 @@ DvbPmtParser::DvbPmtParser(const DvbPmtSection &section) : videoPid(-1), teletex
 				streamLanguage.append(QChar(languageDescriptor.languageCode1()));
 				streamLanguage.append(QChar(languageDescriptor.languageCode2()));
 				streamLanguage.append(QChar(languageDescriptor.languageCode3()));
+				// visual impaired commentary
+				audioDescription = (languageDescriptor.audioType() == 0x03);
 				break;
 			    }
 
@@ -1219,6 +1241,11 @@ DvbPmtParser::DvbPmtParser(const DvbPmtSection &section) : videoPid(-1), teletex
 		case 0x81: // AC-3 audio (ATSC specific)
 		case 0x87: // enhanced AC-3 audio (ATSC specific)
 			audioPids.append(qMakePair(entry.pid(), streamLanguage));
+
+			if (audioDescription) {
+				audioDescriptionPids.append(entry.pid());
+			}
+
 			break;
 
 		case 0x06: // private data - can be teletext, subtitle, ac3 or something else
@@ -1242,6 +1269,10 @@ DvbPmtParser::DvbPmtParser(const DvbPmtSection &section) : videoPid(-1), teletex
 
 			if (ac3Present) {
 				audioPids.append(qMakePair(entry.pid(), streamLanguage));
+
+				if (audioDescription) {
+					audioDescriptionPids.append(entry.pid());
+				}
 			}
 
 			break;
@@ -21,6 +21,7 @@
 #ifndef DVBSI_H
 #define DVBSI_H
 
+#include <QAtomicPointer>
 #include <QPair>
 #include <QObject>
 #include "dvbbackenddevice.h"
@@ -178,8 +179,11 @@ private:
 		EncodingTypeMax	= 17
 	};
 
-	static QTextCodec *codecTable[EncodingTypeMax + 1];
-	static bool override6937;
+	static QTextCodec *getCodec(TextEncoding encoding);
+
+	// convertText() is called from several threads; the codecs are created on demand
+	static QAtomicPointer<QTextCodec> codecTable[EncodingTypeMax + 1];
+	static QAtomicInt override6937;
 };
 
 class DvbDescriptor : public DvbSectionData
@@ -314,6 +318,7 @@ public:
 
 	int videoPid;
 	QList<QPair<int, QString> > audioPids; // QString = language code (may be empty)
+	QList<int> audioDescriptionPids; // audio pids for the visually impaired
 	QList<QPair<int, QString> > subtitlePids; // QString = language code
 	int teletextPid;
 };
@@ -382,6 +387,11 @@ public:
 		return at(4);
 	}
 
+	int audioType() const
+	{
+		return at(5);
+	}
+
 private:
 	Q_DISABLE_COPY(DvbLanguageDescriptor)
 };
@@ -732,6 +742,11 @@ public:
 		initEitSectionEntry(getData() + getLength(), getSize() - getLength());
 	}
 
+	int eventId() const
+	{
+		return (at(0) << 8) | at(1);
+	}
+
 	int startDate() const
 	{
 		return (at(2) << 8) | at(3);
@@ -948,6 +963,11 @@ public:
 		return (at(3) << 8) | at(4);
 	}
 
+	int pcrPid() const
+	{
+		return ((at(8) & 0x1f) << 8) | at(9);
+	}
+
 	DvbDescriptor descriptors() const
 	{
 		return DvbDescriptor(getData() + 12, descriptorsLength);
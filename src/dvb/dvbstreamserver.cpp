@@ -0,0 +1,591 @@
+/*
+ * dvbstreamserver.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbstreamserver.h"
+#include "dvbstreamserver_p.h"
+
+#include <QSet>
+#include <QTcpServer>
+#include <QTcpSocket>
+#include <QUdpSocket>
+#include <QUrl>
+#include <QUrlQuery>
+#include <QtEndian>
+#include "../log.h"
+#include "dvbdevice.h"
+#include "dvbmanager.h"
+#include "dvbrecording.h"
+
+DvbStreamServer::DvbStreamServer(DvbManager *manager_, QObject *parent) : QObject(parent),
+	manager(manager_)
+{
+	tcpServer = new QTcpServer(this);
+	connect(tcpServer, SIGNAL(newConnection()), this, SLOT(newConnection()));
+}
+
+DvbStreamServer::~DvbStreamServer()
+{
+	// the connections release their services
+	qDeleteAll(findChildren<DvbStreamConnection *>(QString(), Qt::FindDirectChildrenOnly));
+}
+
+void DvbStreamServer::setPort(int port)
+{
+	if (tcpServer->isListening()) {
+		if (tcpServer->serverPort() == port) {
+			return;
+		}
+
+		// the existing connections aren't affected
+		tcpServer->close();
+	}
+
+	if ((port > 0) && !tcpServer->listen(QHostAddress::Any, quint16(port))) {
+		Log("DvbStreamServer::setPort: cannot listen on port") << port <<
+			tcpServer->errorString();
+	}
+}
+
+bool DvbStreamServer::addClient(const DvbSharedChannel &channel, DvbStreamClient *client)
+{
+	DvbStreamService *service = services.value(channel.constData());
+
+	if (service == NULL) {
+		service = new DvbStreamService(manager, channel, this);
+
+		if (!service->start()) {
+			delete service;
+			return false;
+		}
+
+		services.insert(channel.constData(), service);
+	}
+
+	clients.insert(client, service);
+	service->addClient(client);
+	return true;
+}
+
+void DvbStreamServer::removeClient(DvbStreamClient *client)
+{
+	DvbStreamService *service = clients.take(client);
+
+	if (service == NULL) {
+		return;
+	}
+
+	service->removeClient(client);
+
+	if (service->isUnused()) {
+		services.remove(services.key(service));
+		delete service;
+	}
+}
+
+void DvbStreamServer::newConnection()
+{
+	while (tcpServer->hasPendingConnections()) {
+		new DvbStreamConnection(this, tcpServer->nextPendingConnection());
+	}
+}
+
+DvbStreamService::DvbStreamService(DvbManager *manager_, const DvbSharedChannel &channel_,
+	QObject *parent) : QObject(parent), manager(manager_), channel(channel_), device(NULL),
+	videoPid(-1), batchRandomAccess(false)
+{
+	batch.reserve(MaxBatchSize);
+	pmtFilter.setProgramNumber(channel->serviceId);
+	connect(&pmtFilter, SIGNAL(pmtSectionChanged(QByteArray)),
+		this, SLOT(pmtSectionChanged(QByteArray)));
+	connect(&patPmtTimer, SIGNAL(timeout()), this, SLOT(insertPatPmt()));
+}
+
+DvbStreamService::~DvbStreamService()
+{
+	if (device != NULL) {
+		stopDevice();
+		manager->releaseDevice(device, DvbManager::Shared);
+	}
+}
+
+bool DvbStreamService::start()
+{
+	device = manager->requestDevice(channel->source, channel->transponder,
+		DvbManager::Shared);
+
+	if (device == NULL) {
+		return false;
+	}
+
+	patGenerator.initPat(channel->transportStreamId, channel->serviceId, channel->pmtPid);
+	startDevice();
+	// the stored pmt is used until the current one arrives
+	pmtSectionChanged(channel->pmtSectionData);
+	patPmtTimer.start(500);
+	return true;
+}
+
+void DvbStreamService::addClient(DvbStreamClient *client)
+{
+	// the new client starts after the data which has already been received
+	processBatchEnd();
+	clients.append(client);
+	QByteArray data = patGenerator.generatePackets();
+	data.append(pmtGenerator.generatePackets());
+	client->writePackets(data.constData(), data.size(), false);
+
+	// the client doesn't have to wait for the next random access point
+	data = gopCache.getData();
+
+	if (!data.isEmpty()) {
+		client->writePackets(data.constData(), data.size(), true);
+	}
+}
+
+void DvbStreamService::removeClient(DvbStreamClient *client)
+{
+	clients.removeAll(client);
+}
+
+void DvbStreamService::pmtSectionChanged(const QByteArray &pmtSectionData_)
+{
+	DvbPmtSection pmtSection(pmtSectionData_);
+
+	if (!pmtSection.isValid()) {
+		return;
+	}
+
+	pmtSectionData = pmtSectionData_;
+	DvbPmtParser pmtParser(pmtSection);
+	QSet<int> newPids = DvbStreamSelection().selectPids(pmtParser).toSet();
+	int pcrPid = pmtSection.pcrPid();
+
+	if (pcrPid != 0x1fff) {
+		newPids.insert(pcrPid);
+	}
+
+	videoPid = pmtParser.videoPid;
+	gopCache.setVideoPid(videoPid);
+
+	for (int i = 0; i < pids.size(); ++i) {
+		int pid = pids.at(i);
+
+		if (!newPids.remove(pid)) {
+			device->removePidFilter(pid, this);
+			pids.removeAt(i);
+			--i;
+		}
+	}
+
+	foreach (int pid, newPids) {
+		device->addPidFilter(pid, this);
+		pids.append(pid);
+	}
+
+	pmtGenerator.initPmt(channel->pmtPid, pmtSection, pids);
+	insertPatPmt();
+
+	if (channel->isScrambled) {
+		device->startDescrambling(pmtSectionData, this);
+	}
+}
+
+void DvbStreamService::insertPatPmt()
+{
+	processBatchEnd();
+	QByteArray data = patGenerator.generatePackets();
+	data.append(pmtGenerator.generatePackets());
+
+	foreach (DvbStreamClient *client, clients) {
+		client->writePackets(data.constData(), data.size(), false);
+	}
+}
+
+void DvbStreamService::deviceStateChanged()
+{
+	switch (device->getDeviceState()) {
+	case DvbDevice::DeviceReleased:
+		// the device has been taken by a recording
+		stopDevice();
+		device = manager->requestDevice(channel->source, channel->transponder,
+			DvbManager::Shared);
+
+		if (device != NULL) {
+			startDevice();
+		} else {
+			Log("DvbStreamService::deviceStateChanged: no device available for") <<
+				channel->name;
+
+			foreach (DvbStreamClient *client, clients) {
+				client->serviceStopped();
+			}
+		}
+
+		break;
+	case DvbDevice::DeviceIdle:
+	case DvbDevice::DeviceRotorMoving:
+	case DvbDevice::DeviceTuning:
+	case DvbDevice::DeviceTuned:
+		break;
+	}
+}
+
+void DvbStreamService::processData(const char data[188])
+{
+	bool gopStart = TsGopCache::isRandomAccessPacket(data, videoPid);
+	gopCache.processPacket(data, gopStart);
+
+	if (gopStart || (batch.size() >= MaxBatchSize)) {
+		processBatchEnd();
+	}
+
+	if (batch.isEmpty()) {
+		// without video every packet is a possible start
+		batchRandomAccess = (gopStart || (videoPid < 0));
+	}
+
+	batch.append(data, 188);
+}
+
+void DvbStreamService::processBatchEnd()
+{
+	if (batch.isEmpty()) {
+		return;
+	}
+
+	foreach (DvbStreamClient *client, clients) {
+		client->writePackets(batch.constData(), batch.size(), batchRandomAccess);
+	}
+
+	// keeps the capacity
+	batch.resize(0);
+}
+
+void DvbStreamService::startDevice()
+{
+	foreach (int pid, pids) {
+		device->addPidFilter(pid, this);
+	}
+
+	device->addSectionFilter(channel->pmtPid, &pmtFilter);
+	connect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+
+	if (channel->isScrambled && !pmtSectionData.isEmpty()) {
+		device->startDescrambling(pmtSectionData, this);
+	}
+}
+
+void DvbStreamService::stopDevice()
+{
+	if (channel->isScrambled && !pmtSectionData.isEmpty()) {
+		device->stopDescrambling(pmtSectionData, this);
+	}
+
+	foreach (int pid, pids) {
+		device->removePidFilter(pid, this);
+	}
+
+	device->removeSectionFilter(channel->pmtPid, &pmtFilter);
+	disconnect(device, SIGNAL(stateChanged()), this, SLOT(deviceStateChanged()));
+}
+
+DvbStreamConnection::DvbStreamConnection(DvbStreamServer *server_, QTcpSocket *socket_) :
+	QObject(server_), server(server_), socket(socket_), mode(Request), streaming(false),
+	headerSent(false), closing(false), dropping(false), bytesDropped(0), udpSocket(NULL), port(0),
+	sequenceNumber(0), ssrc(0)
+{
+	socket->setParent(this);
+	connect(socket, SIGNAL(readyRead()), this, SLOT(readyRead()));
+	connect(socket, SIGNAL(disconnected()), this, SLOT(close()));
+}
+
+DvbStreamConnection::~DvbStreamConnection()
+{
+	if (streaming) {
+		server->removeClient(this);
+	}
+
+	if (bytesDropped != 0) {
+		Log("DvbStreamConnection::~DvbStreamConnection: the client was too slow; "
+			"bytes dropped:") << bytesDropped;
+	}
+}
+
+void DvbStreamConnection::writePackets(const char *data, int size, bool randomAccess)
+{
+	if (closing) {
+		return;
+	}
+
+	switch (mode) {
+	case Request:
+	case Response:
+		break;
+	case Http:
+		if (dropping) {
+			if (!randomAccess || (socket->bytesToWrite() > (MaxBacklog / 2))) {
+				bytesDropped += size;
+
+				if (dropTimer.elapsed() > MaxDropTime) {
+					Log("DvbStreamConnection::writePackets: disconnecting slow client") <<
+						socket->peerAddress().toString();
+					close();
+				}
+
+				break;
+			}
+
+			// continue with a decodable picture
+			dropping = false;
+		} else if (socket->bytesToWrite() > MaxBacklog) {
+			dropping = true;
+			dropTimer.start();
+			bytesDropped += size;
+			break;
+		}
+
+		sendStreamHeader();
+		socket->write(data, size);
+		break;
+	case Rtp:
+	case Udp: {
+		int datagramSize = (PacketsPerDatagram * 188);
+
+		if (mode == Rtp) {
+			datagramSize += RtpHeaderSize;
+		}
+
+		for (int i = 0; i < size; i += 188) {
+			datagram.append(data + i, 188);
+
+			if (datagram.size() >= datagramSize) {
+				sendDatagram();
+			}
+		}
+
+		break;
+	    }
+	}
+}
+
+void DvbStreamConnection::serviceStopped()
+{
+	close();
+}
+
+void DvbStreamConnection::close()
+{
+	if (!closing) {
+		closing = true;
+		deleteLater();
+	}
+}
+
+void DvbStreamConnection::readyRead()
+{
+	if (mode != Request) {
+		// there's nothing else to do with the data
+		socket->readAll();
+		return;
+	}
+
+	request.append(socket->readAll());
+	int end = request.indexOf("\r\n\r\n");
+
+	if (end < 0) {
+		if (request.size() > MaxRequestSize) {
+			sendResponse("400 Bad Request", "text/plain", "Bad Request\r\n");
+		}
+
+		return;
+	}
+
+	processRequest(request.left(end));
+}
+
+void DvbStreamConnection::processRequest(const QByteArray &header)
+{
+	QList<QByteArray> lines = header.split('\n');
+	QList<QByteArray> requestLine = lines.first().trimmed().split(' ');
+
+	if ((requestLine.size() < 2) || (requestLine.at(0) != "GET")) {
+		sendResponse("400 Bad Request", "text/plain", "Bad Request\r\n");
+		return;
+	}
+
+	QUrl url = QUrl::fromEncoded(requestLine.at(1));
+	QString path = url.path().mid(1);
+	DvbChannelModel *channelModel = server->getManager()->getChannelModel();
+
+	if (path.isEmpty()) {
+		QByteArray host;
+
+		foreach (const QByteArray &line, lines) {
+			if (line.toLower().startsWith("host:")) {
+				host = line.mid(5).trimmed();
+			}
+		}
+
+		if (host.isEmpty()) {
+			host = socket->localAddress().toString().toLatin1() + ':' +
+				QByteArray::number(socket->localPort());
+		}
+
+		QByteArray playlist = "#EXTM3U\n";
+
+		foreach (const DvbSharedChannel &channel, channelModel->getChannels()) {
+			playlist += "#EXTINF:-1," + channel->name.toUtf8() + '\n';
+			playlist += "http://" + host + '/' + QByteArray::number(channel->number) + '\n';
+		}
+
+		sendResponse("200 OK", "audio/x-mpegurl", playlist);
+		return;
+	}
+
+	bool ok;
+	int number = path.toInt(&ok);
+	DvbSharedChannel channel;
+
+	if (ok) {
+		channel = channelModel->findChannelByNumber(number);
+	} else {
+		channel = channelModel->findChannelByName(path);
+	}
+
+	if (!channel.isValid()) {
+		sendResponse("404 Not Found", "text/plain", "Not Found\r\n");
+		return;
+	}
+
+	QUrlQuery query(url);
+	Mode streamMode = Http;
+	QString destination;
+
+	if (query.hasQueryItem(QLatin1String("rtp"))) {
+		streamMode = Rtp;
+		destination = query.queryItemValue(QLatin1String("rtp"));
+	} else if (query.hasQueryItem(QLatin1String("udp"))) {
+		streamMode = Udp;
+		destination = query.queryItemValue(QLatin1String("udp"));
+	}
+
+	if (streamMode != Http) {
+		// only the requesting host or a multicast group (no third parties)
+		address = socket->peerAddress();
+		quint32 ipv4Address = address.toIPv4Address(&ok);
+
+		if (ok) {
+			address = QHostAddress(ipv4Address);
+		}
+
+		int index = destination.lastIndexOf(QLatin1Char(':'));
+
+		if (index >= 0) {
+			QHostAddress requestedAddress(destination.left(index));
+
+			if (!requestedAddress.isMulticast() && !requestedAddress.isEqual(address)) {
+				sendResponse("403 Forbidden", "text/plain", "Forbidden\r\n");
+				return;
+			}
+
+			address = requestedAddress;
+		}
+
+		port = destination.mid(index + 1).toUShort(&ok);
+
+		if (!ok || (port == 0)) {
+			sendResponse("400 Bad Request", "text/plain", "Bad Request\r\n");
+			return;
+		}
+	}
+
+	mode = streamMode;
+
+	if (mode != Http) {
+		udpSocket = new QUdpSocket(this);
+
+		if (mode == Rtp) {
+			datagram.fill(0, RtpHeaderSize);
+			ssrc = quint32(qrand());
+			clock.start();
+		}
+	}
+
+	if (!server->addClient(channel, this)) {
+		sendResponse("503 Service Unavailable", "text/plain", "No available device found.\r\n");
+		return;
+	}
+
+	streaming = true;
+	sendStreamHeader();
+}
+
+void DvbStreamConnection::sendResponse(const QByteArray &status, const QByteArray &contentType,
+	const QByteArray &body)
+{
+	mode = Response;
+	socket->write("HTTP/1.0 " + status + "\r\nContent-Type: " + contentType +
+		"\r\nContent-Length: " + QByteArray::number(body.size()) +
+		"\r\nConnection: close\r\n\r\n" + body);
+	socket->disconnectFromHost();
+}
+
+void DvbStreamConnection::sendStreamHeader()
+{
+	if (headerSent) {
+		return;
+	}
+
+	headerSent = true;
+
+	if (mode == Http) {
+		socket->write("HTTP/1.0 200 OK\r\nContent-Type: video/mp2t\r\n"
+			"Cache-Control: no-cache\r\nConnection: close\r\n\r\n");
+	} else {
+		// the stream stops when this connection is closed
+		socket->write("HTTP/1.0 200 OK\r\nContent-Type: text/plain\r\n\r\n" +
+			QByteArray(mode == Rtp ? "rtp://" : "udp://") +
+			address.toString().toLatin1() + ':' + QByteArray::number(port) + "\r\n");
+	}
+}
+
+void DvbStreamConnection::sendDatagram()
+{
+	int headerSize = 0;
+
+	if (mode == Rtp) {
+		// version 2, payload type 33 (mpeg-2 ts), 90 kHz time stamp
+		uchar *header = reinterpret_cast<uchar *>(datagram.data());
+		header[0] = 0x80;
+		header[1] = 33;
+		qToBigEndian<quint16>(sequenceNumber, header + 2);
+		qToBigEndian<quint32>(quint32(clock.elapsed() * 90), header + 4);
+		qToBigEndian<quint32>(ssrc, header + 8);
+		++sequenceNumber;
+		headerSize = RtpHeaderSize;
+	}
+
+	// udp doesn't have back pressure; the datagram is lost if the socket buffer is full
+	if (udpSocket->writeDatagram(datagram, address, port) < 0) {
+		bytesDropped += (datagram.size() - headerSize);
+	}
+
+	datagram.resize(headerSize);
+}
@@ -0,0 +1,87 @@
+/*
+ * dvbstreamserver.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBSTREAMSERVER_H
+#define DVBSTREAMSERVER_H
+
+#include <QMap>
+#include "dvbchannel.h"
+
+class QTcpServer;
+class DvbManager;
+class DvbStreamService;
+
+// receives the packets of a service (see DvbStreamServer::addClient())
+
+class DvbStreamClient
+{
+public:
+	// 'data' contains complete packets; 'randomAccess' = a group of pictures starts
+	virtual void writePackets(const char *data, int size, bool randomAccess) = 0;
+	// there's no device available anymore; the client has to call removeClient(), but
+	// not from within this function
+	virtual void serviceStopped() = 0;
+
+protected:
+	DvbStreamClient() { }
+	virtual ~DvbStreamClient() { }
+};
+
+// serves live services to players on the network:
+// http://host:port/ - playlist of all channels
+// http://host:port/<channel number or name> - the service over http
+// http://host:port/<channel number or name>?rtp=[address:]port - the service over rtp; it's
+//	sent to the requesting host (or to a multicast address) as long as the http connection
+//	stays open ('udp' instead of 'rtp' sends plain udp datagrams)
+// the clients of a service (network clients as well as local players) share the pid filters
+// and the clients of a transponder share the device; devices are requested as shared, so
+// recordings take precedence
+
+class DvbStreamServer : public QObject
+{
+	Q_OBJECT
+public:
+	DvbStreamServer(DvbManager *manager_, QObject *parent);
+	~DvbStreamServer();
+
+	// 0 = disabled
+	void setPort(int port);
+
+	DvbManager *getManager() const
+	{
+		return manager;
+	}
+
+	// the client gets the pat, the pmt and the cached group of pictures first; returns
+	// false if there's no device available
+	bool addClient(const DvbSharedChannel &channel, DvbStreamClient *client);
+	void removeClient(DvbStreamClient *client);
+
+private slots:
+	void newConnection();
+
+private:
+	DvbManager *manager;
+	QTcpServer *tcpServer;
+	QMap<const DvbChannel *, DvbStreamService *> services;
+	QMap<DvbStreamClient *, DvbStreamService *> clients;
+};
+
+#endif /* DVBSTREAMSERVER_H */
@@ -0,0 +1,158 @@
+/*
+ * dvbstreamserver_p.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBSTREAMSERVER_P_H
+#define DVBSTREAMSERVER_P_H
+
+#include <QElapsedTimer>
+#include <QHostAddress>
+#include <QTimer>
+#include "../tsindex.h"
+#include "dvbbackenddevice.h"
+#include "dvbchannel.h"
+#include "dvbsi.h"
+#include "dvbstreamserver.h"
+
+class QTcpSocket;
+class QUdpSocket;
+class DvbDevice;
+class DvbManager;
+
+// a service which is streamed to one or more clients
+
+class DvbStreamService : public QObject, public DvbPidFilter
+{
+	Q_OBJECT
+public:
+	DvbStreamService(DvbManager *manager_, const DvbSharedChannel &channel_,
+		QObject *parent);
+	~DvbStreamService();
+
+	// returns false if there's no device available
+	bool start();
+
+	void addClient(DvbStreamClient *client);
+	void removeClient(DvbStreamClient *client);
+
+	bool isUnused() const
+	{
+		return clients.isEmpty();
+	}
+
+private slots:
+	void pmtSectionChanged(const QByteArray &pmtSectionData_);
+	void insertPatPmt();
+	void deviceStateChanged();
+
+private:
+	enum {
+		MaxBatchSize = (348 * 188) // the batch is passed on earlier if it gets larger
+	};
+
+	void processData(const char data[188]);
+	// passes the batch to the clients
+	void processBatchEnd();
+	void startDevice();
+	void stopDevice();
+
+	DvbManager *manager;
+	DvbSharedChannel channel;
+	DvbDevice *device;
+	DvbPmtFilter pmtFilter;
+	QByteArray pmtSectionData;
+	DvbSectionGenerator patGenerator;
+	DvbSectionGenerator pmtGenerator;
+	QList<int> pids;
+	int videoPid;
+	TsGopCache gopCache;
+	QByteArray batch; // a random access point only appears at the beginning
+	bool batchRandomAccess;
+	QTimer patPmtTimer;
+	QList<DvbStreamClient *> clients;
+};
+
+// a client; the http connection either carries the stream or controls an rtp / udp stream
+
+class DvbStreamConnection : public QObject, public DvbStreamClient
+{
+	Q_OBJECT
+public:
+	DvbStreamConnection(DvbStreamServer *server_, QTcpSocket *socket_);
+	~DvbStreamConnection();
+
+	void writePackets(const char *data, int size, bool randomAccess);
+	void serviceStopped();
+
+public slots:
+	// the connection is deleted later (it's safe to call this from writePackets())
+	void close();
+
+private slots:
+	void readyRead();
+
+private:
+	enum Constants {
+		MaxRequestSize = 8192,
+		MaxBacklog = (4 << 20), // bytes; data is dropped if the client doesn't keep up
+		MaxDropTime = 10000, // ms; the client is disconnected after dropping this long
+		PacketsPerDatagram = 7,
+		RtpHeaderSize = 12
+	};
+
+	enum Mode {
+		Request,
+		Response, // the connection is closed after sending the response
+		Http,
+		Rtp,
+		Udp
+	};
+
+	void processRequest(const QByteArray &header);
+	void sendResponse(const QByteArray &status, const QByteArray &contentType,
+		const QByteArray &body);
+	// sent once the stream starts
+	void sendStreamHeader();
+	void sendDatagram();
+
+	DvbStreamServer *server;
+	QTcpSocket *socket;
+	QByteArray request;
+	Mode mode;
+	bool streaming; // the client has been added to the server
+	bool headerSent;
+	bool closing;
+
+	// back pressure: data is dropped until the backlog is small enough and a group of
+	// pictures starts
+	bool dropping;
+	QElapsedTimer dropTimer;
+	qint64 bytesDropped;
+
+	// only used for rtp / udp
+	QUdpSocket *udpSocket;
+	QHostAddress address;
+	quint16 port;
+	QByteArray datagram;
+	quint16 sequenceNumber;
+	quint32 ssrc;
+	QElapsedTimer clock;
+};
+
+#endif /* DVBSTREAMSERVER_P_H */
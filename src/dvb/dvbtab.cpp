@@ -41,6 +41,7 @@
 #include "dvbepgdialog.h"
 #include "dvbliveview.h"
 #include "dvbmanager.h"
+#include "dvbmultiview.h"
 #include "dvbrecordingdialog.h"
 #include "dvbscandialog.h"
 
@@ -95,6 +96,11 @@ DvbTab::DvbTab(QMenu *menu, KActionCollection *collection, MediaWidget *mediaWid
 	connect(epgAction, SIGNAL(triggered(bool)), this, SLOT(toggleEpgDialog()));
 	menu->addAction(collection->addAction(QLatin1String("dvb_epg"), epgAction));
 
+	QAction *multiViewAction = new QAction(QIcon::fromTheme(QLatin1String("view-split-left-right")),
+		i18n("Multi View"), this);
+	connect(multiViewAction, SIGNAL(triggered(bool)), this, SLOT(toggleMultiViewDialog()));
+	menu->addAction(collection->addAction(QLatin1String("dvb_multi_view"), multiViewAction));
+
 	QAction *osdAction = new QAction(QIcon::fromTheme(QLatin1String("dialog-information")), i18n("OSD"), this);
 	osdAction->setShortcut(Qt::Key_O);
 	connect(osdAction, SIGNAL(triggered(bool)), manager->getLiveView(), SLOT(toggleOsd()));
@@ -338,6 +344,19 @@ void DvbTab::toggleEpgDialog()
 	}
 }
 
+void DvbTab::toggleMultiViewDialog()
+{
+	if (multiViewDialog.isNull()) {
+		multiViewDialog = new DvbMultiViewDialog(manager, this);
+		multiViewDialog->setAttribute(Qt::WA_DeleteOnClose, true);
+		multiViewDialog->setModal(false);
+		multiViewDialog->show();
+	} else {
+		multiViewDialog->deleteLater();
+		multiViewDialog = NULL;
+	}
+}
+
 void DvbTab::instantRecord(bool checked)
 {
 	if (checked) {
@@ -469,6 +488,18 @@ void DvbTab::playChannel(const DvbSharedChannel &channel, const QModelIndex &ind
 	channelView->setCurrentIndex(index);
 	currentChannel = channel->name;
 	manager->getLiveView()->playChannel(channel);
+
+	QList<DvbSharedChannel> standbyChannels;
+
+	if (manager->isFastZapEnabled()) {
+		// the channels which are reached by previousChannel() and nextChannel()
+		standbyChannels.append(channelProxyModel->value(
+			index.sibling(index.row() - 1, index.column())));
+		standbyChannels.append(channelProxyModel->value(
+			index.sibling(index.row() + 1, index.column())));
+	}
+
+	manager->getLiveView()->setStandbyChannels(standbyChannels);
 	
 	if (!epgDialog.isNull()) {
 		epgDialog->setCurrentChannel(manager->getLiveView()->getChannel());
@@ -36,6 +36,7 @@ class QMenu;
 class DvbChannelTableModel;
 class DvbChannelView;
 class DvbEpgDialog;
+class DvbMultiViewDialog;
 class DvbTimeShiftCleaner;
 class MediaWidget;
 
@@ -66,6 +67,7 @@ public slots:
 private slots:
 	void showChannelDialog();
 	void toggleEpgDialog();
+	void toggleMultiViewDialog();
 	void showRecordingDialog();
 	void instantRecord(bool checked);
 	void recordingRemoved(const DvbSharedRecording &recording);
@@ -88,6 +90,7 @@ private:
 	DvbChannelTableModel *channelProxyModel;
 	DvbChannelView *channelView;
 	QPointer<DvbEpgDialog> epgDialog;
+	QPointer<DvbMultiViewDialog> multiViewDialog;
 	QLayout *mediaLayout;
 	QString osdChannel;
 	QTimer osdChannelTimer;
@@ -0,0 +1,407 @@
+/*
+ * dvbtimeshiftbuffer.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbtimeshiftbuffer.h"
+
+#include <QFile>
+#include <algorithm>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include "../log.h"
+
+DvbTimeShiftBuffer::DvbTimeShiftBuffer() : active(false), fd(-1), maxMemoryChunks(0),
+	fileChunks(0), bytesDropped(0), beginOffset(0), memoryOffset(0), endOffset(0),
+	readOffset(0), clearCount(0), consumerWaiting(false), reading(false),
+	interrupted(false), stopping(false)
+{
+	index.setKeepEntries(true);
+}
+
+DvbTimeShiftBuffer::~DvbTimeShiftBuffer()
+{
+	stop();
+}
+
+void DvbTimeShiftBuffer::start(const QString &fileName_, qint64 memorySize, qint64 fileSize)
+{
+	stop();
+	// the incomplete chunk is always in memory
+	maxMemoryChunks = int(qMax(Q_INT64_C(2), memorySize / ChunkSize));
+	fileChunks = int(fileSize / ChunkSize);
+
+	if (fileChunks > 0) {
+		fd = ::open(QFile::encodeName(fileName_).constData(),
+			O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+
+		if (fd >= 0) {
+			// the file is preallocated by the spill thread
+			fileName = fileName_;
+		} else {
+			Log("DvbTimeShiftBuffer::start: cannot open file") << fileName_;
+			fileChunks = 0;
+		}
+	}
+
+	index.reset();
+	entries.clear();
+	bytesDropped = 0;
+	beginOffset = 0;
+	memoryOffset = 0;
+	endOffset = 0;
+	readOffset = 0;
+	stopping = false;
+	active = true;
+
+	if (fd >= 0) {
+		QThread::start();
+	}
+}
+
+void DvbTimeShiftBuffer::stop()
+{
+	if (!active) {
+		return;
+	}
+
+	mutex.lock();
+	stopping = true;
+	spillCondition.wakeOne();
+	mutex.unlock();
+	wait();
+
+	QMutexLocker locker(&mutex);
+	// the player mustn't access the file or the chunks anymore
+	interrupted = true;
+	condition.wakeAll();
+
+	while (reading) {
+		readCondition.wait(&mutex);
+	}
+
+	active = false;
+
+	if (fd >= 0) {
+		::close(fd);
+		fd = -1;
+		QFile::remove(fileName);
+		fileName.clear();
+	}
+
+	foreach (char *chunk, memoryChunks + freeChunks) {
+		delete[] chunk;
+	}
+
+	memoryChunks.clear();
+	freeChunks.clear();
+	beginOffset = 0;
+	memoryOffset = 0;
+	endOffset = 0;
+	readOffset = 0;
+	entries.clear();
+
+	if (bytesDropped != 0) {
+		Log("DvbTimeShiftBuffer::stop: the disk was too slow; bytes dropped:") << bytesDropped;
+	}
+}
+
+void DvbTimeShiftBuffer::setIndexPids(int videoPid, int pcrPid)
+{
+	index.setPids(videoPid, pcrPid);
+}
+
+void DvbTimeShiftBuffer::write(const char *data, int size)
+{
+	if (!active) {
+		return;
+	}
+
+	QMutexLocker locker(&mutex);
+	int newChunks = int(((endOffset + size + ChunkSize - 1) / ChunkSize) -
+		((endOffset + ChunkSize - 1) / ChunkSize));
+
+	if ((fd >= 0) && ((memoryChunks.size() + newChunks) > (maxMemoryChunks + MaxSpillBacklog))) {
+		bytesDropped += size;
+		return;
+	}
+
+	index.processData(data, size, endOffset);
+	entries += index.takeEntries();
+
+	while (size > 0) {
+		int chunkOffset = int(endOffset % ChunkSize);
+
+		if (chunkOffset == 0) {
+			if (!freeChunks.isEmpty()) {
+				memoryChunks.append(freeChunks.takeLast());
+			} else {
+				memoryChunks.append(new char[ChunkSize]);
+			}
+		}
+
+		int count = qMin(size, ChunkSize - chunkOffset);
+		memcpy(memoryChunks.last() + chunkOffset, data, count);
+		data += count;
+		size -= count;
+		endOffset += count;
+	}
+
+	if (memoryChunks.size() > maxMemoryChunks) {
+		if (fd >= 0) {
+			spillCondition.wakeOne();
+		} else {
+			while (memoryChunks.size() > maxMemoryChunks) {
+				freeChunks.append(memoryChunks.takeFirst());
+				memoryOffset += ChunkSize;
+			}
+
+			discardBefore(memoryOffset);
+		}
+	}
+
+	while (!entries.isEmpty() && (entries.first().offset < beginOffset)) {
+		entries.remove(0);
+	}
+
+	if (consumerWaiting) {
+		condition.wakeOne();
+	}
+}
+
+void DvbTimeShiftBuffer::clear()
+{
+	QMutexLocker locker(&mutex);
+	freeChunks += memoryChunks;
+	memoryChunks.clear();
+	memoryOffset = (((endOffset + ChunkSize - 1) / ChunkSize) * ChunkSize);
+	beginOffset = memoryOffset;
+	endOffset = memoryOffset;
+	readOffset = memoryOffset;
+	++clearCount;
+	index.reset();
+	entries.clear();
+}
+
+int DvbTimeShiftBuffer::skip(int time)
+{
+	QMutexLocker locker(&mutex);
+	const TsIndexEntry *currentEntry = findEntry(readOffset);
+
+	if (currentEntry == NULL) {
+		return 0;
+	}
+
+	// the last random access point at or before the requested time (or the first one)
+	QVector<TsIndexEntry>::ConstIterator it = std::upper_bound(entries.constBegin(),
+		entries.constEnd(), TsIndexEntry(currentEntry->time + time, 0));
+
+	if (it != entries.constBegin()) {
+		--it;
+	}
+
+	if ((it->offset == currentEntry->offset) || (it->offset < beginOffset)) {
+		return 0;
+	}
+
+	readOffset = it->offset;
+	return (it->time - currentEntry->time);
+}
+
+void DvbTimeShiftBuffer::open()
+{
+	QMutexLocker locker(&mutex);
+	interrupted = false;
+}
+
+int DvbTimeShiftBuffer::read(char *data, int size)
+{
+	QMutexLocker locker(&mutex);
+	reading = true;
+	int result = readData(locker, data, size);
+	reading = false;
+
+	if (interrupted) {
+		readCondition.wakeAll();
+	}
+
+	return result;
+}
+
+int DvbTimeShiftBuffer::readData(QMutexLocker &locker, char *data, int size)
+{
+	while (!interrupted) {
+		if (readOffset >= endOffset) {
+			consumerWaiting = true;
+			condition.wait(&mutex);
+			consumerWaiting = false;
+			continue;
+		}
+
+		qint64 offset = readOffset;
+		int chunkOffset = int(offset % ChunkSize);
+		int count = int(qMin(qint64(qMin(size, ChunkSize - chunkOffset)), endOffset - offset));
+
+		if (offset >= memoryOffset) {
+			memcpy(data, memoryChunks.at(int((offset - memoryOffset) / ChunkSize)) +
+				chunkOffset, count);
+			readOffset = (offset + count);
+			return count;
+		}
+
+		qint64 filePosition = ((((offset / ChunkSize) % fileChunks) * ChunkSize) + chunkOffset);
+		locker.unlock();
+		ssize_t bytesRead = pread(fd, data, count, filePosition);
+		int error = errno;
+		locker.relock();
+
+		if (bytesRead <= 0) {
+			if ((bytesRead < 0) && (error == EINTR)) {
+				continue;
+			}
+
+			Log("DvbTimeShiftBuffer::read: cannot read from") << fileName;
+			return -1;
+		}
+
+		// the chunk may have been overwritten or the position may have changed meanwhile
+		if ((offset < beginOffset) || (readOffset != offset)) {
+			continue;
+		}
+
+		readOffset = (offset + bytesRead);
+		return int(bytesRead);
+	}
+
+	return -1;
+}
+
+void DvbTimeShiftBuffer::interrupt()
+{
+	QMutexLocker locker(&mutex);
+	interrupted = true;
+	condition.wakeAll();
+}
+
+void DvbTimeShiftBuffer::run()
+{
+#ifdef Q_OS_LINUX
+	// the ring mustn't run out of space later; the size isn't changed (the file grows
+	// while the chunks are written if this isn't supported)
+	if (fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, qint64(fileChunks) * ChunkSize) != 0) {
+		Log("DvbTimeShiftBuffer::run: cannot preallocate file") << fileName <<
+			QString::fromLocal8Bit(strerror(errno));
+	}
+#endif
+
+	QMutexLocker locker(&mutex);
+	bool writeError = false;
+
+	while (!stopping) {
+		if (memoryChunks.size() <= maxMemoryChunks) {
+			spillCondition.wait(&mutex);
+			continue;
+		}
+
+		char *chunk = memoryChunks.first();
+		qint64 chunkIndex = (memoryOffset / ChunkSize);
+		int currentClearCount = clearCount;
+		// the oldest chunk in the file is going to be overwritten
+		discardBefore((chunkIndex - fileChunks + 1) * ChunkSize);
+		locker.unlock();
+
+		const char *data = chunk;
+		int size = ChunkSize;
+		qint64 filePosition = ((chunkIndex % fileChunks) * ChunkSize);
+		int error = 0;
+
+		while (size > 0) {
+			ssize_t bytesWritten = pwrite(fd, data, size, filePosition);
+
+			if (bytesWritten < 0) {
+				if (errno == EINTR) {
+					continue;
+				}
+
+				error = errno;
+				break;
+			}
+
+			data += bytesWritten;
+			size -= int(bytesWritten);
+			filePosition += bytesWritten;
+		}
+
+		locker.relock();
+
+		if (clearCount != currentClearCount) {
+			// the chunk isn't used anymore
+			continue;
+		}
+
+		if (size != 0) {
+			if (!writeError) {
+				Log("DvbTimeShiftBuffer::run: cannot write to") << fileName <<
+					QString::fromLocal8Bit(strerror(error));
+				writeError = true;
+			}
+
+			// the chunk is lost
+			discardBefore(memoryOffset + ChunkSize);
+		}
+
+		memoryChunks.removeFirst();
+		freeChunks.append(chunk);
+		memoryOffset += ChunkSize;
+	}
+}
+
+void DvbTimeShiftBuffer::discardBefore(qint64 offset)
+{
+	if (beginOffset < offset) {
+		beginOffset = offset;
+
+		if (readOffset < beginOffset) {
+			// the player has been paused for too long
+			readOffset = beginOffset;
+		}
+	}
+}
+
+static bool offsetLessThan(qint64 offset, const TsIndexEntry &entry)
+{
+	return (offset < entry.offset);
+}
+
+const TsIndexEntry *DvbTimeShiftBuffer::findEntry(qint64 offset) const
+{
+	if (entries.isEmpty()) {
+		return NULL;
+	}
+
+	QVector<TsIndexEntry>::ConstIterator it =
+		std::upper_bound(entries.constBegin(), entries.constEnd(), offset, offsetLessThan);
+
+	if (it != entries.constBegin()) {
+		--it;
+	}
+
+	return &(*it);
+}
@@ -0,0 +1,112 @@
+/*
+ * dvbtimeshiftbuffer.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBTIMESHIFTBUFFER_H
+#define DVBTIMESHIFTBUFFER_H
+
+#include <QList>
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include "../mediastreambuffer.h"
+#include "../tsindex.h"
+
+// bounded time shift store; the newest data is kept in memory, older data is moved to a
+// file which is used as a ring (by a separate thread, which also preallocates the file); the
+// oldest data is discarded once both are full; the player reads it as a stream and the
+// position is changed with skip() (based on an index of the random access points)
+
+class DvbTimeShiftBuffer : public MediaStream, private QThread
+{
+public:
+	DvbTimeShiftBuffer();
+	~DvbTimeShiftBuffer();
+
+	// sizes in bytes; 'fileName_' isn't used if 'fileSize' is zero (memory only); if the
+	// file can't be created, only the memory is used
+	void start(const QString &fileName_, qint64 memorySize, qint64 fileSize);
+	// interrupts the player (and waits until it has left read())
+	void stop();
+
+	bool isActive() const
+	{
+		return active;
+	}
+
+	// can be changed at any time; -1 = unknown
+	void setIndexPids(int videoPid, int pcrPid);
+
+	// the following functions are called by the main thread
+
+	void write(const char *data, int size);
+	// discards everything (e.g. after switching the channel)
+	void clear();
+	// moves the playback position relative to the data which is read next (the player
+	// has buffered some data, so this is approximate); returns the time which has
+	// actually been skipped (milliseconds)
+	int skip(int time);
+
+	// the following functions are called by the player
+
+	// continues at the current playback position
+	void open();
+	int read(char *data, int size);
+	void interrupt();
+
+private:
+	enum Constants {
+		ChunkSize = (1 << 20),
+		MaxSpillBacklog = 16 // chunks; data is dropped if the disk can't keep up
+	};
+
+	void run();
+	// the caller has to lock the mutex
+	int readData(QMutexLocker &locker, char *data, int size);
+	void discardBefore(qint64 offset);
+	const TsIndexEntry *findEntry(qint64 offset) const;
+
+	bool active;
+	int fd;
+	QString fileName;
+	int maxMemoryChunks;
+	int fileChunks;
+	TsIndexWriter index;
+	QVector<TsIndexEntry> entries; // only used by the main thread
+	qint64 bytesDropped; // only used by the main thread
+
+	QMutex mutex;
+	QWaitCondition condition; // wakes up the player
+	QWaitCondition spillCondition; // wakes up the spill thread
+	QWaitCondition readCondition; // wakes up stop() once the player has left read()
+	// chunk n contains the data at [n * ChunkSize, (n + 1) * ChunkSize)
+	QList<char *> memoryChunks; // starting at memoryOffset; the last one may be incomplete
+	QList<char *> freeChunks;
+	qint64 beginOffset; // the data before has been discarded
+	qint64 memoryOffset; // the data before is in the file
+	qint64 endOffset;
+	qint64 readOffset;
+	int clearCount; // changes invalidate a spill which is in progress
+	bool consumerWaiting;
+	bool reading; // the player is in read() (it may access the file without the lock)
+	bool interrupted;
+	bool stopping;
+};
+
+#endif /* DVBTIMESHIFTBUFFER_H */
@@ -0,0 +1,483 @@
+/*
+ * dvbtswriter.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "dvbtswriter.h"
+#include "dvbtswriter_p.h"
+
+#include <QCoreApplication>
+#include <QFile>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "../log.h"
+
+DvbTsWriter::DvbTsWriter() : thread(new DvbTsWriterThread()), threadStarted(false),
+	syncPolicy(NoSync), directIo(false), preallocationSize(0), fd(-1), indexEnabled(false),
+	indexing(false), writeOffset(0), totalOffset(0)
+{
+	index.setKeepEntries(true);
+}
+
+DvbTsWriter::~DvbTsWriter()
+{
+	close();
+
+	if (threadStarted) {
+		thread->detach();
+	} else {
+		delete thread;
+	}
+}
+
+bool DvbTsWriter::open(const QString &fileName_)
+{
+	close();
+	fd = openFile(fileName_);
+
+	if (fd < 0) {
+		return false;
+	}
+
+	currentFileName = fileName_;
+	writeOffset = 0;
+	totalOffset = 0;
+	indexing = indexEnabled;
+	index.reset();
+
+	if (!threadStarted) {
+		thread->start();
+		threadStarted = true;
+	}
+
+	return true;
+}
+
+bool DvbTsWriter::openNext(const QString &fileName_)
+{
+	if (fd < 0) {
+		return open(fileName_);
+	}
+
+	int nextFd = openFile(fileName_);
+
+	if (nextFd < 0) {
+		return false;
+	}
+
+	if (currentBuffer.data != NULL) {
+		queueCurrentBuffer();
+	}
+
+	queueCloseFile(false);
+	fd = nextFd;
+	currentFileName = fileName_;
+	writeOffset = 0;
+	indexing = indexEnabled;
+	index.reset();
+
+	return true;
+}
+
+void DvbTsWriter::close()
+{
+	if (fd < 0) {
+		return;
+	}
+
+	if (currentBuffer.data != NULL) {
+		if (currentBuffer.size > 0) {
+			queueCurrentBuffer();
+		} else {
+			QMutexLocker locker(&thread->mutex);
+			thread->freeBuffers.append(currentBuffer);
+			currentBuffer = Buffer();
+		}
+	}
+
+	queueCloseFile(true);
+	fd = -1;
+	indexing = false;
+}
+
+void DvbTsWriter::removeFile(const QString &fileName_)
+{
+	if (!threadStarted) {
+		thread->start();
+		threadStarted = true;
+	}
+
+	Buffer buffer;
+	buffer.fileName = fileName_;
+	QMutexLocker locker(&thread->mutex);
+	thread->queuedBuffers.append(buffer);
+	thread->condition.wakeOne();
+}
+
+void DvbTsWriter::connectClosed(QObject *receiver, const char *member)
+{
+	QObject::connect(thread, SIGNAL(closed(QString)), receiver, member);
+}
+
+int DvbTsWriter::openFile(const QString &fileName_)
+{
+	int flags = (O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC);
+#ifdef O_DIRECT
+	if (directIo) {
+		flags |= O_DIRECT;
+	}
+#endif
+
+	int fileFd = ::open(QFile::encodeName(fileName_).constData(), flags, 0666);
+
+#ifdef O_DIRECT
+	if ((fileFd < 0) && directIo && (errno == EINVAL)) {
+		// the file system doesn't support O_DIRECT
+		Log("DvbTsWriter::openFile: O_DIRECT isn't supported for") << fileName_;
+		directIo = false;
+		fileFd = ::open(QFile::encodeName(fileName_).constData(), flags & ~O_DIRECT, 0666);
+	}
+#endif
+
+	return fileFd;
+}
+
+void DvbTsWriter::write(const char *data, int size)
+{
+	if (fd < 0) {
+		return;
+	}
+
+	if ((currentBuffer.data != NULL) && !directIo &&
+	    (currentBufferTimer.elapsed() >= MaxLatency)) {
+		// readers of the file (time shift) shouldn't wait too long
+		queueCurrentBuffer();
+	}
+
+	int availableSize = 0;
+
+	if (currentBuffer.data != NULL) {
+		availableSize = (BufferSize - currentBuffer.size);
+	}
+
+	if (availableSize < size) {
+		// make sure that there are enough buffers before copying anything
+		int neededBuffers = ((size - availableSize + BufferSize - 1) / BufferSize);
+		QMutexLocker locker(&thread->mutex);
+
+		if ((thread->freeBuffers.size() + MaxBuffers - thread->allocatedBuffers) <
+		    neededBuffers) {
+			thread->statistics.bytesDropped += size;
+			return;
+		}
+	}
+
+	if (indexing) {
+		index.processData(data, size, writeOffset);
+	}
+
+	writeOffset += size;
+	totalOffset += size;
+
+	while (size > 0) {
+		if (currentBuffer.data == NULL) {
+			thread->mutex.lock();
+
+			if (!thread->freeBuffers.isEmpty()) {
+				currentBuffer = thread->freeBuffers.takeLast();
+			}
+
+			thread->mutex.unlock();
+
+			if (currentBuffer.data == NULL) {
+				void *memory = NULL;
+
+				if (posix_memalign(&memory, Alignment, BufferSize) != 0) {
+					Log("DvbTsWriter::write: cannot allocate buffer");
+					QMutexLocker locker(&thread->mutex);
+					thread->statistics.bytesDropped += size;
+					return;
+				}
+
+				currentBuffer.data = static_cast<char *>(memory);
+				QMutexLocker locker(&thread->mutex);
+				++thread->allocatedBuffers;
+			}
+
+			currentBuffer.size = 0;
+			currentBufferTimer.start();
+		}
+
+		int count = qMin(size, BufferSize - currentBuffer.size);
+		memcpy(currentBuffer.data + currentBuffer.size, data, count);
+		currentBuffer.size += count;
+		data += count;
+		size -= count;
+
+		if (currentBuffer.size == BufferSize) {
+			queueCurrentBuffer();
+		}
+	}
+}
+
+DvbTsWriterStatistics DvbTsWriter::getStatistics() const
+{
+	QMutexLocker locker(&thread->mutex);
+	return thread->statistics;
+}
+
+void DvbTsWriter::queueCurrentBuffer()
+{
+	currentBuffer.fd = fd;
+	currentBuffer.syncPolicy = syncPolicy;
+	currentBuffer.preallocationSize = preallocationSize;
+	currentBuffer.fileName = currentFileName;
+	currentBuffer.indexEnabled = indexing;
+	currentBuffer.indexEntries = index.takeEntries();
+	QMutexLocker locker(&thread->mutex);
+	thread->queuedBuffers.append(currentBuffer);
+	currentBuffer = Buffer();
+
+	if (thread->statistics.maxQueuedBuffers < thread->queuedBuffers.size()) {
+		thread->statistics.maxQueuedBuffers = thread->queuedBuffers.size();
+	}
+
+	thread->condition.wakeOne();
+}
+
+void DvbTsWriter::queueCloseFile(bool notifyClosed)
+{
+	Buffer buffer;
+	buffer.fd = fd;
+	buffer.fileName = currentFileName;
+	buffer.indexEnabled = indexing;
+	buffer.indexEntries = index.takeEntries();
+	buffer.notifyClosed = notifyClosed;
+	QMutexLocker locker(&thread->mutex);
+	thread->queuedBuffers.append(buffer);
+	thread->condition.wakeOne();
+}
+
+DvbTsWriterThread::DvbTsWriterThread() : allocatedBuffers(0), detached(false), fileOffset(0),
+	syncOffset(0), allocatedOffset(0), preallocationFailed(false), reportedBytesDropped(0)
+{
+	// threads which are still writing are waited for when the application exits
+	setParent(QCoreApplication::instance());
+	connect(this, SIGNAL(finished()), this, SLOT(deleteLater()));
+}
+
+DvbTsWriterThread::~DvbTsWriterThread()
+{
+	detach();
+	wait();
+
+	foreach (const DvbTsWriter::Buffer &buffer, freeBuffers) {
+		free(buffer.data);
+	}
+}
+
+void DvbTsWriterThread::detach()
+{
+	QMutexLocker locker(&mutex);
+	detached = true;
+	condition.wakeOne();
+}
+
+void DvbTsWriterThread::run()
+{
+	mutex.lock();
+
+	while (true) {
+		if (queuedBuffers.isEmpty()) {
+			if (detached) {
+				break;
+			}
+
+			condition.wait(&mutex);
+			continue;
+		}
+
+		DvbTsWriter::Buffer buffer = queuedBuffers.takeFirst();
+		mutex.unlock();
+
+		if (buffer.data != NULL) {
+			writeBuffer(buffer);
+			mutex.lock();
+			freeBuffers.append(buffer);
+			continue;
+		}
+
+		if (buffer.fd < 0) {
+			removeFile(buffer.fileName);
+			mutex.lock();
+			continue;
+		}
+
+		closeFile(buffer);
+
+		if (buffer.notifyClosed) {
+			emit closed(buffer.fileName);
+		}
+
+		mutex.lock();
+
+		if (queuedBuffers.isEmpty()) {
+			// keep two buffers for the next file
+			while (freeBuffers.size() > 2) {
+				free(freeBuffers.takeLast().data);
+				--allocatedBuffers;
+			}
+		}
+	}
+
+	mutex.unlock();
+}
+
+void DvbTsWriterThread::writeBuffer(const DvbTsWriter::Buffer &buffer)
+{
+#ifdef O_DIRECT
+	if ((buffer.size % DvbTsWriter::Alignment) != 0) {
+		// only the last buffer of a file can be incomplete
+		int flags = fcntl(buffer.fd, F_GETFL);
+
+		if ((flags != -1) && ((flags & O_DIRECT) != 0)) {
+			fcntl(buffer.fd, F_SETFL, flags & ~O_DIRECT);
+		}
+	}
+#endif
+
+#ifdef Q_OS_LINUX
+	if ((buffer.preallocationSize > 0) && !preallocationFailed &&
+	    ((fileOffset + buffer.size) > allocatedOffset)) {
+		// large extents avoid fragmentation if several recordings are running
+		if (fallocate(buffer.fd, FALLOC_FL_KEEP_SIZE, allocatedOffset,
+		    buffer.preallocationSize) == 0) {
+			allocatedOffset += buffer.preallocationSize;
+		} else {
+			// not supported by the file system (or the disk is full)
+			preallocationFailed = true;
+		}
+	}
+#endif
+
+	if (buffer.indexEnabled && (fileOffset == 0)) {
+		index.open(buffer.fileName);
+	}
+
+	const char *data = buffer.data;
+	int size = buffer.size;
+
+	while (size > 0) {
+		ssize_t bytesWritten = ::write(buffer.fd, data, size);
+
+		if (bytesWritten < 0) {
+			if (errno == EINTR) {
+				continue;
+			}
+
+			QMutexLocker locker(&mutex);
+
+			if (statistics.writeErrors == 0) {
+				Log("DvbTsWriterThread::writeBuffer: cannot write to") << buffer.fileName <<
+					QString::fromLocal8Bit(strerror(errno));
+			}
+
+			++statistics.writeErrors;
+			statistics.bytesDropped += size;
+			return;
+		}
+
+		data += bytesWritten;
+		size -= int(bytesWritten);
+	}
+
+	switch (buffer.syncPolicy) {
+	case DvbTsWriter::NoSync:
+		break;
+	case DvbTsWriter::SyncFileRange:
+#ifdef Q_OS_LINUX
+		// start the write back of this buffer and wait for the previous one; this
+		// way the page cache doesn't fill up with dirty pages of the recording
+		sync_file_range(buffer.fd, fileOffset, buffer.size, SYNC_FILE_RANGE_WRITE);
+
+		if (fileOffset > syncOffset) {
+			sync_file_range(buffer.fd, syncOffset, fileOffset - syncOffset,
+				SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE |
+				SYNC_FILE_RANGE_WAIT_AFTER);
+			syncOffset = fileOffset;
+		}
+
+		break;
+#endif
+	case DvbTsWriter::DataSync:
+		fdatasync(buffer.fd);
+		break;
+	}
+
+	fileOffset += buffer.size;
+	// the entries don't point beyond the data which has been written
+	index.writeEntries(buffer.indexEntries);
+	QMutexLocker locker(&mutex);
+	statistics.bytesWritten += buffer.size;
+}
+
+void DvbTsWriterThread::removeFile(const QString &fileName)
+{
+	if (!QFile::remove(fileName)) {
+		Log("DvbTsWriterThread::removeFile: cannot remove file") << fileName;
+	}
+
+	QFile::remove(TsIndex::indexFileName(fileName));
+}
+
+void DvbTsWriterThread::closeFile(const DvbTsWriter::Buffer &buffer)
+{
+	index.writeEntries(buffer.indexEntries);
+	index.close();
+
+	if (allocatedOffset > fileOffset) {
+		// the extents past the end of the file stay allocated after closing it;
+		// truncating releases them (the file size itself doesn't change)
+		if (ftruncate(buffer.fd, fileOffset) != 0) {
+			Log("DvbTsWriterThread::closeFile: cannot release preallocated space of") <<
+				buffer.fileName;
+		}
+	}
+
+	if (::close(buffer.fd) != 0) {
+		Log("DvbTsWriterThread::closeFile: cannot close file");
+	}
+
+	fileOffset = 0;
+	syncOffset = 0;
+	allocatedOffset = 0;
+	preallocationFailed = false;
+
+	mutex.lock();
+	qint64 bytesDropped = (statistics.bytesDropped - reportedBytesDropped);
+	reportedBytesDropped = statistics.bytesDropped;
+	mutex.unlock();
+
+	if (bytesDropped != 0) {
+		Log("DvbTsWriterThread::closeFile: the disk was too slow; bytes dropped:") <<
+			bytesDropped << buffer.fileName;
+	}
+}
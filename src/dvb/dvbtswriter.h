@@ -0,0 +1,192 @@
+/*
+ * dvbtswriter.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBTSWRITER_H
+#define DVBTSWRITER_H
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QString>
+#include "../tsindex.h"
+
+class QObject;
+class DvbTsWriterThread;
+
+// covers all files since the writer has been created
+
+class DvbTsWriterStatistics
+{
+public:
+	DvbTsWriterStatistics() : bytesWritten(0), bytesDropped(0), maxQueuedBuffers(0),
+		writeErrors(0) { }
+	~DvbTsWriterStatistics() { }
+
+	qint64 bytesWritten;
+	qint64 bytesDropped; // the disk was too slow (all buffers were in use)
+	int maxQueuedBuffers;
+	int writeErrors;
+};
+
+// writes transport stream data to a file in a separate thread; write() copies the data
+// into large aligned buffers and never blocks (if the disk can't keep up, data is dropped);
+// neither close() nor the destructor wait for the data to be written
+
+class DvbTsWriter
+{
+	friend class DvbTsWriterThread;
+public:
+	DvbTsWriter();
+	~DvbTsWriter();
+
+	enum SyncPolicy {
+		NoSync = 0,	// leave everything to the page cache
+		SyncFileRange = 1,	// start the write back of each buffer immediately
+		DataSync = 2	// fdatasync() after each buffer
+	};
+
+	void setSyncPolicy(SyncPolicy syncPolicy_)
+	{
+		syncPolicy = syncPolicy_;
+	}
+
+	// bypass the page cache (O_DIRECT); data is only written in complete buffers then
+	void setDirectIo(bool directIo_)
+	{
+		directIo = directIo_;
+	}
+
+	// the file is allocated in extents of this size (0 = disabled); the unused part of
+	// the last extent is released by close()
+	void setPreallocationSize(qint64 preallocationSize_)
+	{
+		preallocationSize = preallocationSize_;
+	}
+
+	// writes a sidecar index for each file (see TsIndex); the data is parsed by write(),
+	// the index file is written by the io thread
+	void setIndexEnabled(bool indexEnabled_)
+	{
+		indexEnabled = indexEnabled_;
+	}
+
+	// can be changed at any time; -1 = unknown
+	void setIndexPids(int videoPid, int pcrPid)
+	{
+		index.setPids(videoPid, pcrPid);
+	}
+
+	// creates (or truncates) the file; the settings above are used until close()
+	bool open(const QString &fileName_);
+	// continues with another file without waiting for the data of the current one
+	// (returns false and keeps the current file if the new one can't be created)
+	bool openNext(const QString &fileName_);
+	// queues the remaining data; the file is closed after it has been written
+	void close();
+	// removes a file which has been closed by openNext() (and its index) in the io thread
+	void removeFile(const QString &fileName_);
+
+	// 'member' (a slot with a QString argument) is invoked with the name of the file
+	// when a file which has been closed by close() is completely on disk
+	void connectClosed(QObject *receiver, const char *member);
+
+	bool isOpen() const
+	{
+		return (fd >= 0);
+	}
+
+	QString fileName() const
+	{
+		return currentFileName;
+	}
+
+	// the size of the current file (including the data which hasn't been written yet)
+	qint64 position() const
+	{
+		return writeOffset;
+	}
+
+	// the data which has been accepted since open() (including the files before openNext())
+	qint64 totalSize() const
+	{
+		return totalOffset;
+	}
+
+	// the data of a single call is either written completely or dropped
+	void write(const char *data, int size);
+
+	void write(const QByteArray &data)
+	{
+		write(data.constData(), data.size());
+	}
+
+	DvbTsWriterStatistics getStatistics() const;
+
+private:
+	enum Constants {
+		BufferSize = (1 << 20),
+		Alignment = 4096,
+		MaxBuffers = 16,
+		MaxLatency = 1000 // ms; only without O_DIRECT
+	};
+
+	// a buffer without data closes the file (or removes it if 'fd' is -1)
+	class Buffer
+	{
+	public:
+		Buffer() : data(NULL), size(0), fd(-1), syncPolicy(NoSync), preallocationSize(0),
+			indexEnabled(false), notifyClosed(false) { }
+		~Buffer() { }
+
+		char *data;
+		int size;
+		int fd;
+		SyncPolicy syncPolicy;
+		qint64 preallocationSize;
+		QString fileName;
+		bool indexEnabled;
+		QVector<TsIndexEntry> indexEntries; // found since the previous buffer
+		bool notifyClosed;
+	};
+
+	int openFile(const QString &fileName_);
+	void queueCurrentBuffer();
+	void queueCloseFile(bool notifyClosed);
+
+	// deletes itself after the destruction of the writer (when everything is on disk)
+	DvbTsWriterThread *thread;
+	bool threadStarted;
+
+	SyncPolicy syncPolicy;
+	bool directIo;
+	qint64 preallocationSize;
+	int fd;
+	QString currentFileName;
+
+	// only used by the writing thread
+	bool indexEnabled;
+	bool indexing; // the current file has an index
+	TsIndexWriter index; // collects the entries
+	qint64 writeOffset; // position of the next data in the current file
+	qint64 totalOffset;
+	Buffer currentBuffer;
+	QElapsedTimer currentBufferTimer;
+};
+
+#endif /* DVBTSWRITER_H */
@@ -0,0 +1,68 @@
+/*
+ * dvbtswriter_p.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef DVBTSWRITER_P_H
+#define DVBTSWRITER_P_H
+
+#include <QMutex>
+#include <QThread>
+#include <QWaitCondition>
+#include "dvbtswriter.h"
+
+// the io thread of a DvbTsWriter; it isn't stopped by the writer, but finishes the queued
+// files after the writer has been destroyed and deletes itself then
+
+class DvbTsWriterThread : public QThread
+{
+	Q_OBJECT
+public:
+	DvbTsWriterThread();
+	~DvbTsWriterThread();
+
+	void detach();
+
+	QMutex mutex;
+	QWaitCondition condition;
+	QList<DvbTsWriter::Buffer> queuedBuffers;
+	QList<DvbTsWriter::Buffer> freeBuffers;
+	int allocatedBuffers;
+	DvbTsWriterStatistics statistics;
+
+signals:
+	void closed(const QString &fileName);
+
+private:
+	void run();
+	void writeBuffer(const DvbTsWriter::Buffer &buffer);
+	void closeFile(const DvbTsWriter::Buffer &buffer);
+	static void removeFile(const QString &fileName);
+
+	bool detached;
+
+	// only used by this thread (for the file which is being written)
+	qint64 fileOffset;
+	qint64 syncOffset; // the data before has been written back
+	qint64 allocatedOffset;
+	bool preallocationFailed;
+	TsIndexWriter index; // writes the index file
+	qint64 reportedBytesDropped;
+};
+
+#endif /* DVBTSWRITER_P_H */
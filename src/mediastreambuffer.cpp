@@ -0,0 +1,145 @@
+/*
+ * mediastreambuffer.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "mediastreambuffer.h"
+
+#include <string.h>
+
+MediaStreamBuffer::MediaStreamBuffer() : readPosition(0), writePosition(0), flushPosition(0),
+	flushCount(0), consumedFlushCount(0), interrupted(0), consumerWaiting(0), bytesDropped(0)
+{
+	ring = new char[Size];
+}
+
+MediaStreamBuffer::~MediaStreamBuffer()
+{
+	delete[] ring;
+}
+
+void MediaStreamBuffer::write(const char *data, int size)
+{
+	quint32 position = writePosition.load();
+	quint32 consumerPosition;
+
+	if (consumedFlushCount.loadAcquire() != flushCount.load()) {
+		// the consumer hasn't seen the last flush yet
+		consumerPosition = flushPosition.load();
+	} else {
+		consumerPosition = readPosition.loadAcquire();
+	}
+
+	if ((Size - quint32(position - consumerPosition)) < quint32(size)) {
+		bytesDropped += size;
+		return;
+	}
+
+	int offset = int(position & (Size - 1));
+	int firstSize = qMin(size, Size - offset);
+	memcpy(ring + offset, data, firstSize);
+	memcpy(ring, data + firstSize, size - firstSize);
+	writePosition.fetchAndAddOrdered(size);
+
+	if (consumerWaiting.fetchAndAddOrdered(0) != 0) {
+		QMutexLocker locker(&mutex);
+		condition.wakeOne();
+	}
+}
+
+void MediaStreamBuffer::flush()
+{
+	flushPosition.store(writePosition.load());
+	// acquire: the copy of a read() which hasn't seen this flush is complete before
+	// write() reuses the space in front of the flush position (see read())
+	flushCount.fetchAndAddOrdered(1);
+}
+
+void MediaStreamBuffer::open()
+{
+	interrupted.storeRelease(0);
+	int currentFlushCount = flushCount.loadAcquire();
+
+	if (consumedFlushCount.load() != currentFlushCount) {
+		// the data since the flush belongs to the new stream
+		readPosition.storeRelease(flushPosition.load());
+		consumedFlushCount.storeRelease(currentFlushCount);
+	} else {
+		readPosition.storeRelease(writePosition.loadAcquire());
+	}
+}
+
+int MediaStreamBuffer::read(char *data, int size)
+{
+	while (interrupted.loadAcquire() == 0) {
+		int currentFlushCount = flushCount.loadAcquire();
+
+		if (consumedFlushCount.load() != currentFlushCount) {
+			readPosition.storeRelease(flushPosition.load());
+			consumedFlushCount.storeRelease(currentFlushCount);
+		}
+
+		quint32 position = readPosition.load();
+		quint32 available = (writePosition.loadAcquire() - position);
+
+		if (available > 0) {
+			int count = int(qMin(quint32(size), available));
+			int offset = int(position & (Size - 1));
+			int firstCount = qMin(count, Size - offset);
+			memcpy(data, ring + offset, firstCount);
+			memcpy(data + firstCount, ring, count - firstCount);
+
+			if (flushCount.fetchAndAddOrdered(0) != currentFlushCount) {
+				// the data has been flushed and may have been overwritten meanwhile
+				continue;
+			}
+
+			readPosition.storeRelease(position + count);
+			return count;
+		}
+
+		QMutexLocker locker(&mutex);
+		consumerWaiting.fetchAndStoreOrdered(1);
+
+		if ((writePosition.fetchAndAddOrdered(0) == position) &&
+		    (interrupted.loadAcquire() == 0)) {
+			condition.wait(&mutex);
+		}
+
+		consumerWaiting.storeRelease(0);
+	}
+
+	return -1;
+}
+
+void MediaStreamBuffer::interrupt()
+{
+	interrupted.storeRelease(1);
+	QMutexLocker locker(&mutex);
+	condition.wakeOne();
+}
+
+int MediaStreamBuffer::getBufferedBytes() const
+{
+	if (consumedFlushCount.loadAcquire() != flushCount.load()) {
+		// the consumer hasn't seen the last flush yet
+		return int(writePosition.load() - flushPosition.load());
+	}
+
+	return int(writePosition.load() - readPosition.loadAcquire());
+}
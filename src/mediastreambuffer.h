@@ -0,0 +1,107 @@
+/*
+ * mediastreambuffer.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef MEDIASTREAMBUFFER_H
+#define MEDIASTREAMBUFFER_H
+
+#include <QAtomicInteger>
+#include <QMutex>
+#include <QWaitCondition>
+
+// a stream which is read by the player (see MediaSource::getStream()); the functions are
+// called by the thread of the player
+
+class MediaStream
+{
+public:
+	MediaStream() { }
+	virtual ~MediaStream() { }
+
+	// called before the first read()
+	virtual void open() = 0;
+	// returns the number of bytes read (waits for data) or -1 after interrupt()
+	virtual int read(char *data, int size) = 0;
+	// read() returns -1 until the next open() (the player is going to stop); this
+	// function is called by the main thread
+	virtual void interrupt() = 0;
+	// the amount of data which hasn't been read yet or -1 if unknown; this function is
+	// called by the main thread
+	virtual int getBufferedBytes() const { return -1; }
+
+private:
+	Q_DISABLE_COPY(MediaStream)
+};
+
+// ring buffer which passes a stream (live tv) from the main thread directly to the player;
+// single producer and single consumer; the data path doesn't use locks (the mutex is only
+// needed to wake up the consumer); write() never blocks (data is dropped if the player
+// doesn't keep up), read() waits for data; write() should be called with larger batches of
+// packets (each call may have to wake up the consumer)
+
+class MediaStreamBuffer : public MediaStream
+{
+public:
+	MediaStreamBuffer();
+	~MediaStreamBuffer();
+
+	// producer
+
+	void write(const char *data, int size);
+	// discards the data which hasn't been read yet (e.g. after switching the channel)
+	void flush();
+
+	qint64 getBytesDropped() const
+	{
+		return bytesDropped;
+	}
+
+	// consumer
+
+	// starts at the last flush or at the current end of the stream
+	void open();
+	int read(char *data, int size);
+	void interrupt();
+
+	int getBufferedBytes() const;
+
+private:
+	enum Constants {
+		Size = (4 << 20) // has to be a power of two
+	};
+
+	char *ring;
+	// positions are counted modulo 2^32 (only the difference matters)
+	QAtomicInteger<quint32> readPosition;
+	QAtomicInteger<quint32> writePosition;
+	QAtomicInteger<quint32> flushPosition;
+	// write() regards the data before the flush position as free as soon as flush() has
+	// been called; read() discards its copy if a flush happened during the copy
+	QAtomicInt flushCount;
+	QAtomicInt consumedFlushCount; // the consumer has moved to the flush position
+	QAtomicInt interrupted;
+	// writePosition and consumerWaiting are published with ordered (sequentially consistent)
+	// operations: either the producer sees the waiting consumer or the consumer sees the data
+	QAtomicInt consumerWaiting;
+	qint64 bytesDropped; // only used by the producer
+	QMutex mutex;
+	QWaitCondition condition;
+};
+
+#endif /* MEDIASTREAMBUFFER_H */
@@ -50,7 +50,7 @@
 MediaWidget::MediaWidget(QMenu *menu_, KToolBar *toolBar, KActionCollection *collection,
 	QWidget *parent) : QWidget(parent), menu(menu_), displayMode(NormalMode),
 	automaticResize(ResizeOff), blockBackendUpdates(false), muted(false),
-	screenSaverSuspended(false), showElapsedTime(true)
+	screenSaverSuspended(false), showElapsedTime(true), trickPlaySpeed(0), trickPlayTime(0)
 {
 	dummySource.reset(new MediaSource());
 	source = dummySource.data();
@@ -309,6 +309,22 @@ MediaWidget::MediaWidget(QMenu *menu_, KToolBar *toolBar, KActionCollection *col
 	navigationMenu->addAction(
 		collection->addAction(QLatin1String("controls_long_skip_forward"), longSkipForwardAction));
 
+	rewindAction = new QAction(QIcon::fromTheme(QLatin1String("media-seek-backward")),
+		i18nc("submenu of 'Skip'", "Rewind"), this);
+	rewindAction->setShortcut(Qt::CTRL + Qt::Key_Left);
+	connect(rewindAction, SIGNAL(triggered()), this, SLOT(rewind()));
+	navigationMenu->addAction(collection->addAction(QLatin1String("controls_rewind"), rewindAction));
+
+	fastForwardAction = new QAction(QIcon::fromTheme(QLatin1String("media-seek-forward")),
+		i18nc("submenu of 'Skip'", "Fast Forward"), this);
+	fastForwardAction->setShortcut(Qt::CTRL + Qt::Key_Right);
+	connect(fastForwardAction, SIGNAL(triggered()), this, SLOT(fastForward()));
+	navigationMenu->addAction(
+		collection->addAction(QLatin1String("controls_fast_forward"), fastForwardAction));
+
+	trickPlayTimer = new QTimer(this);
+	connect(trickPlayTimer, SIGNAL(timeout()), this, SLOT(trickPlayTimeout()));
+
 	toolBar->addAction(QIcon::fromTheme(QLatin1String("player-time")), i18n("Seek Slider"))->setEnabled(false);
 
 	action = new QWidgetAction(this);
@@ -452,8 +468,14 @@ void MediaWidget::play(MediaSource *source_)
 	}
 
 	source->setMediaWidget(this);
+	stopTrickPlay();
 	backend->play(*source);
 	actionPlayPause->setChecked(false);
+	tsIndex.close();
+
+	if (source->getUrl().isLocalFile()) {
+		tsIndex.open(source->getUrl().toLocalFile());
+	}
 }
 
 void MediaWidget::mediaSourceDestroyed(MediaSource *mediaSource)
@@ -570,7 +592,7 @@ void MediaWidget::togglePause()
 
 void MediaWidget::setPosition(int position)
 {
-	backend->seek(position);
+	seekBackend(position);
 }
 
 void MediaWidget::setVolume(int volume)
@@ -605,6 +627,7 @@ void MediaWidget::stop()
 		break;
 	}
 
+	stopTrickPlay();
 	backend->stop();
 }
 
@@ -710,7 +733,7 @@ void MediaWidget::seek(int position)
 		return;
 	}
 
-	backend->seek(position);
+	seekBackend(position);
 }
 
 void MediaWidget::deinterlacingChanged(bool deinterlacing)
@@ -767,6 +790,8 @@ void MediaWidget::autoResizeTriggered(QAction *action)
 
 void MediaWidget::pausedChanged(bool paused)
 {
+	stopTrickPlay();
+
 	switch (backend->getPlaybackStatus()) {
 	case Idle:
 		if (source != dummySource.data())
@@ -790,37 +815,51 @@ void MediaWidget::timeButtonClicked()
 void MediaWidget::longSkipBackward()
 {
 	int longSkipDuration = Configuration::instance()->getLongSkipDuration();
-	int currentTime = (backend->getCurrentTime() - 1000 * longSkipDuration);
-
-	if (currentTime < 0) {
-		currentTime = 0;
-	}
-
-	backend->seek(currentTime);
+	skipBackend(-1000 * longSkipDuration);
 }
 
 void MediaWidget::shortSkipBackward()
 {
 	int shortSkipDuration = Configuration::instance()->getShortSkipDuration();
-	int currentTime = (backend->getCurrentTime() - 1000 * shortSkipDuration);
-
-	if (currentTime < 0) {
-		currentTime = 0;
-	}
-
-	backend->seek(currentTime);
+	skipBackend(-1000 * shortSkipDuration);
 }
 
 void MediaWidget::shortSkipForward()
 {
 	int shortSkipDuration = Configuration::instance()->getShortSkipDuration();
-	backend->seek(backend->getCurrentTime() + 1000 * shortSkipDuration);
+	skipBackend(1000 * shortSkipDuration);
 }
 
 void MediaWidget::longSkipForward()
 {
 	int longSkipDuration = Configuration::instance()->getLongSkipDuration();
-	backend->seek(backend->getCurrentTime() + 1000 * longSkipDuration);
+	skipBackend(1000 * longSkipDuration);
+}
+
+void MediaWidget::fastForward()
+{
+	if (backend->getPlaybackStatus() == Idle) {
+		return;
+	}
+
+	if (trickPlaySpeed <= 0) {
+		setTrickPlaySpeed(2);
+	} else if (trickPlaySpeed < MaxTrickPlaySpeed) {
+		setTrickPlaySpeed(2 * trickPlaySpeed);
+	}
+}
+
+void MediaWidget::rewind()
+{
+	if (backend->getPlaybackStatus() == Idle) {
+		return;
+	}
+
+	if (trickPlaySpeed >= 0) {
+		setTrickPlaySpeed(-2);
+	} else if (trickPlaySpeed > -MaxTrickPlaySpeed) {
+		setTrickPlaySpeed(2 * trickPlaySpeed);
+	}
 }
 
 void MediaWidget::jumpToPosition()
@@ -1004,7 +1043,7 @@ void MediaWidget::seekableChanged()
 {
 	bool seekable = (backend->isSeekable() && !source->hideCurrentTotalTime());
 	seekSlider->setEnabled(seekable);
-	navigationMenu->setEnabled(seekable);
+	navigationMenu->setEnabled(seekable || source->canSkipStream());
 	jumpToPositionAction->setEnabled(seekable);
 }
 
@@ -1063,7 +1102,106 @@ void MediaWidget::wheelEvent(QWheelEvent *event)
 		currentTime = 0;
 	}
 
-	backend->seek(currentTime);
+	seekBackend(currentTime);
+}
+
+void MediaWidget::seekBackend(int time)
+{
+	stopTrickPlay();
+	seekToRandomAccessPoint(time);
+}
+
+void MediaWidget::skipBackend(int time)
+{
+	stopTrickPlay();
+
+	if (source->canSkipStream()) {
+		source->skipStream(time);
+		return;
+	}
+
+	int currentTime = (backend->getCurrentTime() + time);
+
+	if (currentTime < 0) {
+		currentTime = 0;
+	}
+
+	seekToRandomAccessPoint(currentTime);
+}
+
+void MediaWidget::seekToRandomAccessPoint(int time)
+{
+	TsIndexEntry entry = tsIndex.findEntry(time);
+
+	if (entry.offset >= 0) {
+		qint64 mediaFileSize = tsIndex.getMediaFileSize();
+
+		if (mediaFileSize > 0) {
+			backend->seekFraction(double(entry.offset) / mediaFileSize);
+			return;
+		}
+	}
+
+	backend->seek(time);
+}
+
+void MediaWidget::setTrickPlaySpeed(int speed)
+{
+	if (trickPlaySpeed == 0) {
+		trickPlayTime = backend->getCurrentTime();
+		backend->setMuted(true);
+		trickPlayTimer->start(TrickPlayInterval);
+	}
+
+	trickPlaySpeed = speed;
+
+	if (speed > 0) {
+		osdWidget->showText(i18nc("osd message", "Fast Forward %1x", speed), 1500);
+	} else {
+		osdWidget->showText(i18nc("osd message", "Rewind %1x", -speed), 1500);
+	}
+}
+
+void MediaWidget::stopTrickPlay()
+{
+	if (trickPlaySpeed != 0) {
+		trickPlaySpeed = 0;
+		trickPlayTimer->stop();
+		backend->setMuted(muted);
+	}
+}
+
+void MediaWidget::trickPlayTimeout()
+{
+	if (backend->getPlaybackStatus() == Idle) {
+		stopTrickPlay();
+		return;
+	}
+
+	if (source->canSkipStream()) {
+		// the stream continues to play at normal speed in between
+		if (source->skipStream((trickPlaySpeed - 1) * TrickPlayInterval) == 0) {
+			stopTrickPlay();
+		}
+
+		return;
+	}
+
+	// the player only shows the frames at the random access points
+	trickPlayTime += (trickPlaySpeed * TrickPlayInterval);
+
+	if (trickPlayTime <= 0) {
+		seekBackend(0);
+		return;
+	}
+
+	if ((backend->getTotalTime() > 0) && (trickPlayTime >= backend->getTotalTime())) {
+		// continue with normal playback
+		stopTrickPlay();
+		return;
+	}
+
+	seekToRandomAccessPoint(trickPlayTime);
 }
 
 void MediaWidget::playbackFinished()
@@ -22,14 +22,17 @@
 #define MEDIAWIDGET_H
 
 #include <QWidget>
+#include "tsindex.h"
 #include <QIcon>
 #include <QPointer>
+#include <QSharedPointer>
 #include <QUrl>
 
 class QActionGroup;
 class QPushButton;
 class QSlider;
 class QStringListModel;
+class QTimer;
 class KAction;
 class KActionCollection;
 class KComboBox;
@@ -37,6 +40,7 @@ class QMenu;
 class KToolBar;
 class AbstractMediaWidget;
 class MediaSource;
+class MediaStream;
 class OsdWidget;
 class SeekSlider;
 
@@ -126,6 +130,9 @@ public slots:
 	void shortSkipForward();
 	void longSkipBackward();
 	void longSkipForward();
+	// trick play: jumps from random access point to random access point
+	void fastForward();
+	void rewind();
 
 public:
 	void playbackFinished();
@@ -170,6 +177,7 @@ private slots:
 	void currentAngleChanged(QAction *action);
 	void shortSkipDurationChanged(int shortSkipDuration);
 	void longSkipDurationChanged(int longSkipDuration);
+	void trickPlayTimeout();
 
 private:
 	void contextMenuEvent(QContextMenuEvent *event);
@@ -180,6 +188,20 @@ private:
 	void resizeEvent(QResizeEvent *event);
 	void wheelEvent(QWheelEvent *event);
 
+	enum TrickPlayConstants {
+		TrickPlayInterval = 400, // ms
+		MaxTrickPlaySpeed = 32
+	};
+
+	// both snap to random access points if there's an index; seekBackend() also
+	// stops trick play
+	void seekBackend(int time); // milliseconds
+	// relative to the current position; uses MediaSource::skipStream() if possible
+	void skipBackend(int time); // milliseconds
+	void seekToRandomAccessPoint(int time); // milliseconds
+	void setTrickPlaySpeed(int speed);
+	void stopTrickPlay();
+
 	QMenu *menu;
 	AbstractMediaWidget *backend;
 	OsdWidget *osdWidget;
@@ -208,6 +230,8 @@ private:
 	QAction *shortSkipBackwardAction;
 	QAction *shortSkipForwardAction;
 	QAction *longSkipForwardAction;
+	QAction *rewindAction;
+	QAction *fastForwardAction;
 	QAction *deinterlaceAction;
 	QAction *menuAction;
 	QMenu *titleMenu;
@@ -228,6 +252,10 @@ private:
 	bool muted;
 	bool screenSaverSuspended;
 	bool showElapsedTime;
+	TsIndex tsIndex; // sidecar index of the current file (if there's one)
+	QTimer *trickPlayTimer;
+	int trickPlaySpeed; // negative = rewind; 0 = normal playback
+	int trickPlayTime; // milliseconds
 };
 
 class MediaSource
@@ -251,6 +279,18 @@ public:
 
 	virtual Type getType() const { return Url; }
 	virtual QUrl getUrl() const { return QUrl(); }
+	// played instead of the url if set
+	virtual QSharedPointer<MediaStream> getStream() const
+	{
+		return QSharedPointer<MediaStream>();
+	}
+
+	// streams can't be seeked by the player; the source moves the position itself
+	virtual bool canSkipStream() const { return false; }
+	// returns the time which has actually been skipped (milliseconds)
+	virtual int skipStream(int ) { return 0; }
+	// live stream; the player keeps the delay small (at the risk of stalls)
+	virtual bool preferLowLatency() const { return false; }
 	virtual bool hideCurrentTotalTime() const { return false; }
 	virtual bool overrideAudioStreams() const { return false; }
 	virtual bool overrideSubtitles() const { return false; }
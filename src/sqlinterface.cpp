@@ -93,6 +93,21 @@ void SqlInterface::sqlInit(const QString &tableName, const QStringList &columnNa
 		createTable = true;
 		requestSubmission();
 	} else {
+		// columns which have been added later are appended to the table
+		QStringList existingColumns;
+
+		for (QSqlQuery query = sqlHelper->exec(QLatin1String("PRAGMA table_info(") + tableName +
+		     QLatin1Char(')')); query.next();) {
+			existingColumns.append(query.value(1).toString());
+		}
+
+		foreach (const QString &columnName, columnNames) {
+			if (!existingColumns.contains(columnName, Qt::CaseInsensitive)) {
+				sqlHelper->exec(QLatin1String("ALTER TABLE ") + tableName +
+					QLatin1String(" ADD COLUMN ") + columnName);
+			}
+		}
+
 		// queries can only be prepared if the table exists
 		insertQuery = sqlHelper->prepare(insertStatement);
 		updateQuery = sqlHelper->prepare(updateStatement);
@@ -128,6 +128,100 @@ protected:
 		}
 	}
 
+	// merges the items in one layout change (instead of inserting them row by row)
+	template<class U> void insertItems(const U &container)
+	{
+		QList<ItemType> newItems;
+
+		for (typename U::ConstIterator it = container.constBegin();
+		     it != container.constEnd(); ++it) {
+			const ItemType &item = *it;
+
+			if (item.isValid() && helper.filterAcceptsItem(item)) {
+				newItems.append(item);
+			}
+		}
+
+		if (newItems.size() <= 1) {
+			if (!newItems.isEmpty()) {
+				insert(newItems.at(0));
+			}
+
+			return;
+		}
+
+		qSort(newItems.begin(), newItems.end(), lessThan);
+		beginLayoutChange();
+		QList<ItemType> mergedItems;
+		mergedItems.reserve(items.size() + newItems.size());
+		int i = 0;
+		int j = 0;
+
+		while ((i < items.size()) && (j < newItems.size())) {
+			// new items are inserted after equal items (like insert())
+			if (lessThan(newItems.at(j), items.at(i))) {
+				mergedItems.append(newItems.at(j++));
+			} else {
+				mergedItems.append(items.at(i++));
+			}
+		}
+
+		mergedItems.append(items.mid(i));
+		mergedItems.append(newItems.mid(j));
+		items = mergedItems;
+		endLayoutChange();
+	}
+
+	// removes the items in one layout change (instead of removing them row by row)
+	template<class U> void removeItems(const U &container)
+	{
+		QList<int> rows;
+
+		for (typename U::ConstIterator it = container.constBegin();
+		     it != container.constEnd(); ++it) {
+			const ItemType &item = *it;
+
+			if (item.isValid()) {
+				int row = binaryFind(item);
+
+				if (row < items.size()) {
+					rows.append(row);
+				}
+			}
+		}
+
+		if (rows.size() <= 1) {
+			if (!rows.isEmpty()) {
+				beginRemoveRows(QModelIndex(), rows.at(0), rows.at(0));
+				items.removeAt(rows.at(0));
+				endRemoveRows();
+			}
+
+			return;
+		}
+
+		qSort(rows);
+		beginLayoutChange();
+		QList<ItemType> remainingItems;
+		remainingItems.reserve(items.size() - rows.size());
+		int j = 0;
+
+		for (int i = 0; i < items.size(); ++i) {
+			if ((j < rows.size()) && (rows.at(j) == i)) {
+				while ((j < rows.size()) && (rows.at(j) == i)) {
+					++j;
+				}
+
+				continue;
+			}
+
+			remainingItems.append(items.at(i));
+		}
+
+		items = remainingItems;
+		endLayoutChange();
+	}
+
 	void aboutToUpdate(const ItemType &item)
 	{
 		updatingRow = -1;
@@ -0,0 +1,381 @@
+/*
+ * tsindex.cpp
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include "tsindex.h"
+
+#include <QFileInfo>
+#include <QtEndian>
+#include <algorithm>
+#include <string.h>
+#include "log.h"
+
+// file format: magic, version, then entries (time (qint32), offset (qint64)); big endian
+
+static const char indexMagic[4] = { 'K', 'T', 'S', 'I' };
+static const int indexVersion = 1;
+static const int indexHeaderSize = 8;
+static const int indexEntrySize = 12;
+
+TsIndexWriter::TsIndexWriter() : videoPid(-1), pcrPid(-1), keepEntries(false), lastPcr(-1),
+	pcrTime(0)
+{
+}
+
+TsIndexWriter::~TsIndexWriter()
+{
+	close();
+}
+
+bool TsIndexWriter::open(const QString &mediaFileName)
+{
+	close();
+	file.setFileName(TsIndex::indexFileName(mediaFileName));
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+		Log("TsIndexWriter::open: cannot open file") << file.fileName();
+		return false;
+	}
+
+	char header[indexHeaderSize];
+	memcpy(header, indexMagic, 4);
+	qToBigEndian<qint32>(indexVersion, reinterpret_cast<uchar *>(header + 4));
+	file.write(header, indexHeaderSize);
+	file.flush();
+	reset();
+	flushTimer.start();
+	return true;
+}
+
+void TsIndexWriter::close()
+{
+	if (file.isOpen()) {
+		file.close();
+	}
+}
+
+void TsIndexWriter::setPids(int videoPid_, int pcrPid_)
+{
+	videoPid = videoPid_;
+	pcrPid = pcrPid_;
+}
+
+QVector<TsIndexEntry> TsIndexWriter::takeEntries()
+{
+	QVector<TsIndexEntry> result = entries;
+	entries.clear();
+	return result;
+}
+
+void TsIndexWriter::writeEntries(const QVector<TsIndexEntry> &entries_)
+{
+	if (!file.isOpen() || entries_.isEmpty()) {
+		return;
+	}
+
+	foreach (const TsIndexEntry &entry, entries_) {
+		writeEntry(entry);
+	}
+
+	file.flush();
+	flushTimer.start();
+}
+
+void TsIndexWriter::reset()
+{
+	entries.clear();
+	lastPcr = -1;
+	pcrTime = 0;
+}
+
+void TsIndexWriter::processData(const char *data, int size, qint64 offset)
+{
+	if (videoPid < 0) {
+		return;
+	}
+
+	for (int i = 0; (i + 188) <= size; i += 188) {
+		processPacket(data + i, offset + i);
+	}
+}
+
+void TsIndexWriter::processPacket(const char *packet, qint64 offset)
+{
+	int pid = (((quint8(packet[1]) & 0x1f) << 8) | quint8(packet[2]));
+
+	if ((pid != videoPid) && (pid != pcrPid)) {
+		return;
+	}
+
+	int adaptationFieldControl = ((quint8(packet[3]) >> 4) & 0x03);
+
+	if ((adaptationFieldControl & 0x02) != 0) {
+		int adaptationFieldLength = quint8(packet[4]);
+		int flags = quint8(packet[5]);
+
+		if ((adaptationFieldLength >= 7) && ((flags & 0x10) != 0) &&
+		    ((pid == pcrPid) || (pcrPid < 0))) {
+			// pcr base (33 bits, 90 kHz)
+			processPcr((qint64(quint8(packet[6])) << 25) |
+				(qint64(quint8(packet[7])) << 17) |
+				(qint64(quint8(packet[8])) << 9) |
+				(qint64(quint8(packet[9])) << 1) |
+				(qint64(quint8(packet[10])) >> 7));
+		}
+	}
+
+	if ((lastPcr < 0) || !TsGopCache::isRandomAccessPacket(packet, videoPid)) {
+		return;
+	}
+
+	TsIndexEntry entry(int(pcrTime / 90), offset);
+
+	if (keepEntries) {
+		entries.append(entry);
+	}
+
+	if (!file.isOpen()) {
+		return;
+	}
+
+	writeEntry(entry);
+
+	if (flushTimer.elapsed() >= MaxLatency) {
+		file.flush();
+		flushTimer.start();
+	}
+}
+
+void TsIndexWriter::processPcr(qint64 pcr)
+{
+	if (lastPcr >= 0) {
+		qint64 delta = ((pcr - lastPcr) & ((Q_INT64_C(1) << 33) - 1));
+
+		// discontinuities (e.g. after retuning) mustn't make the time jump
+		if (delta < (10 * 90000)) {
+			pcrTime += delta;
+		}
+	}
+
+	lastPcr = pcr;
+}
+
+void TsIndexWriter::writeEntry(const TsIndexEntry &entry)
+{
+	char data[indexEntrySize];
+	qToBigEndian<qint32>(qint32(entry.time), reinterpret_cast<uchar *>(data));
+	qToBigEndian<qint64>(entry.offset, reinterpret_cast<uchar *>(data + 4));
+	file.write(data, indexEntrySize);
+}
+
+void TsGopCache::setVideoPid(int videoPid_)
+{
+	if (videoPid != videoPid_) {
+		videoPid = videoPid_;
+		clear();
+	}
+}
+
+void TsGopCache::clear()
+{
+	started = false;
+	data.clear();
+}
+
+void TsGopCache::processPacket(const char packet[188], bool randomAccess)
+{
+	if (randomAccess) {
+		data.clear();
+		started = true;
+	}
+
+	if (!started) {
+		return;
+	}
+
+	if ((data.size() + 188) > MaxSize) {
+		clear();
+		return;
+	}
+
+	data.append(packet, 188);
+}
+
+bool TsGopCache::isRandomAccessPacket(const char packet[188], int videoPid)
+{
+	int pid = (((quint8(packet[1]) & 0x1f) << 8) | quint8(packet[2]));
+
+	if ((pid != videoPid) || ((packet[1] & 0x40) == 0)) {
+		return false;
+	}
+
+	int adaptationFieldControl = ((quint8(packet[3]) >> 4) & 0x03);
+	int payloadStart = 4;
+
+	if ((adaptationFieldControl & 0x02) != 0) {
+		int adaptationFieldLength = quint8(packet[4]);
+		payloadStart = (5 + adaptationFieldLength);
+
+		if ((adaptationFieldLength >= 1) && ((packet[5] & 0x40) != 0)) {
+			return true;
+		}
+	}
+
+	return (((adaptationFieldControl & 0x01) != 0) && (payloadStart < 188) &&
+		isRandomAccessPes(packet + payloadStart, 188 - payloadStart));
+}
+
+bool TsGopCache::isRandomAccessPes(const char *data, int size)
+{
+	// pes header
+	if ((size < 9) || (data[0] != 0) || (data[1] != 0) || (data[2] != 1)) {
+		return false;
+	}
+
+	int index = (9 + quint8(data[8]));
+
+	// the first start code of the payload
+	for (; (index + 4) < size; ++index) {
+		if ((data[index] != 0) || (data[index + 1] != 0) || (data[index + 2] != 1)) {
+			continue;
+		}
+
+		int startCode = quint8(data[index + 3]);
+
+		if ((startCode == 0xb3) || (startCode == 0xb8)) {
+			// mpeg-2 sequence header or group of pictures
+			return true;
+		}
+
+		if ((startCode & 0x9f) == 0x09) {
+			// h.264 access unit delimiter; primary_pic_type 0 = I slices only
+			return ((quint8(data[index + 4]) >> 5) == 0);
+		}
+
+		if ((startCode & 0x9f) == 0x07) {
+			// h.264 sequence parameter set
+			return true;
+		}
+
+		if (startCode == 0x46) {
+			// hevc access unit delimiter; pic_type 0 = I slices only
+			return (((index + 5) < size) && ((quint8(data[index + 5]) >> 5) == 0));
+		}
+
+		return false;
+	}
+
+	return false;
+}
+
+bool TsIndex::open(const QString &mediaFileName_)
+{
+	close();
+	file.setFileName(indexFileName(mediaFileName_));
+
+	if (!file.exists() || !file.open(QIODevice::ReadOnly)) {
+		return false;
+	}
+
+	QByteArray header = file.read(indexHeaderSize);
+
+	if ((header.size() != indexHeaderSize) || (memcmp(header.constData(), indexMagic, 4) != 0) ||
+	    (qFromBigEndian<qint32>(reinterpret_cast<const uchar *>(header.constData() + 4)) !=
+	     indexVersion)) {
+		Log("TsIndex::open: invalid index") << file.fileName();
+		file.close();
+		return false;
+	}
+
+	mediaFileName = mediaFileName_;
+	readEntries();
+	return true;
+}
+
+void TsIndex::close()
+{
+	if (file.isOpen()) {
+		file.close();
+	}
+
+	mediaFileName.clear();
+	entries.clear();
+}
+
+TsIndexEntry TsIndex::findEntry(int time)
+{
+	if (!file.isOpen()) {
+		return TsIndexEntry();
+	}
+
+	readEntries();
+	QVector<TsIndexEntry>::ConstIterator it =
+		std::upper_bound(entries.constBegin(), entries.constEnd(), TsIndexEntry(time, 0));
+
+	if (it == entries.constBegin()) {
+		return TsIndexEntry();
+	}
+
+	--it;
+
+	// the index can be ahead of the data which is already on disk
+	qint64 mediaFileSize = getMediaFileSize();
+
+	while (it->offset >= mediaFileSize) {
+		if (it == entries.constBegin()) {
+			return TsIndexEntry();
+		}
+
+		--it;
+	}
+
+	return *it;
+}
+
+qint64 TsIndex::getMediaFileSize() const
+{
+	return QFileInfo(mediaFileName).size();
+}
+
+QString TsIndex::indexFileName(const QString &mediaFileName)
+{
+	return mediaFileName + QLatin1String(".idx");
+}
+
+void TsIndex::readEntries()
+{
+	int count = int((file.size() - file.pos()) / indexEntrySize);
+
+	if (count <= 0) {
+		return;
+	}
+
+	QByteArray data = file.read(qint64(count) * indexEntrySize);
+	const uchar *it = reinterpret_cast<const uchar *>(data.constData());
+	entries.reserve(entries.size() + count);
+
+	for (int i = 0; i < (data.size() / indexEntrySize); ++i) {
+		TsIndexEntry entry(qFromBigEndian<qint32>(it), qFromBigEndian<qint64>(it + 4));
+		it += indexEntrySize;
+
+		if (entries.isEmpty() || (entries.last().time <= entry.time)) {
+			entries.append(entry);
+		}
+	}
+}
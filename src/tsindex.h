@@ -0,0 +1,181 @@
+/*
+ * tsindex.h
+ *
+ * Copyright (C) 2026 agent <agent@local>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef TSINDEX_H
+#define TSINDEX_H
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QVector>
+
+// transport stream files can have a sidecar index (file name + ".idx"); it lists the
+// random access points (start of an I-frame) of the video stream together with their
+// time (derived from the pcr) and their byte offset, so that seeking lands on clean
+// entry points instead of guessing the offset
+
+class TsIndexEntry
+{
+public:
+	TsIndexEntry() : time(0), offset(-1) { }
+	TsIndexEntry(int time_, qint64 offset_) : time(time_), offset(offset_) { }
+	~TsIndexEntry() { }
+
+	int time; // milliseconds since the first pcr of the file
+	qint64 offset; // bytes; -1 = invalid
+
+	bool operator<(const TsIndexEntry &other) const
+	{
+		return (time < other.time);
+	}
+};
+
+class TsIndexWriter
+{
+public:
+	TsIndexWriter();
+	~TsIndexWriter();
+
+	// writes the index of 'mediaFileName'
+	bool open(const QString &mediaFileName);
+	void close();
+
+	bool isOpen() const
+	{
+		return file.isOpen();
+	}
+
+	// -1 = unknown; nothing is indexed without video pid
+	void setPids(int videoPid_, int pcrPid_);
+
+	// the entries are collected in memory as well (see takeEntries()); this also works
+	// without file
+	void setKeepEntries(bool keepEntries_)
+	{
+		keepEntries = keepEntries_;
+	}
+
+	// returns the entries which have been found since the last call
+	QVector<TsIndexEntry> takeEntries();
+
+	// appends entries which have been collected by another instance (this way the parsing
+	// and the file access can happen in different threads)
+	void writeEntries(const QVector<TsIndexEntry> &entries_);
+
+	// starts a new time base (done by open())
+	void reset();
+
+	// 'offset' is the position of 'data' in the media file (a multiple of 188 bytes);
+	// the random access points are found by TsGopCache::isRandomAccessPacket()
+	void processData(const char *data, int size, qint64 offset);
+
+private:
+	enum Constants {
+		MaxLatency = 1000 // ms; readers (time shift) shouldn't wait too long
+	};
+
+	void processPacket(const char *packet, qint64 offset);
+	void processPcr(qint64 pcr);
+	void writeEntry(const TsIndexEntry &entry);
+
+	QFile file;
+	int videoPid;
+	int pcrPid;
+	bool keepEntries;
+	QVector<TsIndexEntry> entries;
+	qint64 lastPcr; // 90 kHz; -1 = no pcr yet
+	qint64 pcrTime; // 90 kHz since the first pcr (without wrap arounds and jumps)
+	QElapsedTimer flushTimer;
+};
+
+// keeps the packets since the most recent random access point of the video stream; a player
+// which starts with them doesn't have to wait for the next decodable picture
+
+class TsGopCache
+{
+public:
+	TsGopCache() : videoPid(-1), started(false) { }
+	~TsGopCache() { }
+
+	// -1 = unknown (nothing is cached); the cache is cleared if the pid changes
+	void setVideoPid(int videoPid_);
+	void clear();
+
+	void processPacket(const char packet[188])
+	{
+		processPacket(packet, isRandomAccessPacket(packet, videoPid));
+	}
+
+	// 'randomAccess' = isRandomAccessPacket() (if the caller needs it anyway)
+	void processPacket(const char packet[188], bool randomAccess);
+
+	// the first packet of a group of pictures (also used by TsIndexWriter)
+	static bool isRandomAccessPacket(const char packet[188], int videoPid);
+
+	// empty if there hasn't been a random access point yet
+	QByteArray getData() const
+	{
+		return data;
+	}
+
+private:
+	enum Constants {
+		MaxSize = (8 << 20) // bytes; larger groups of pictures aren't cached
+	};
+
+	// checks the start of a video pes for a random access point
+	static bool isRandomAccessPes(const char *data, int size);
+
+	int videoPid;
+	bool started;
+	QByteArray data;
+};
+
+class TsIndex
+{
+public:
+	TsIndex() { }
+	~TsIndex() { }
+
+	// returns false if 'mediaFileName' has no index
+	bool open(const QString &mediaFileName_);
+	void close();
+
+	bool isOpen() const
+	{
+		return file.isOpen();
+	}
+
+	// returns the last random access point at or before 'time' (milliseconds); the
+	// index is updated first (the media file may still be written)
+	TsIndexEntry findEntry(int time);
+
+	qint64 getMediaFileSize() const;
+
+	static QString indexFileName(const QString &mediaFileName);
+
+private:
+	void readEntries();
+
+	QFile file;
+	QString mediaFileName;
+	QVector<TsIndexEntry> entries; // sorted by time
+};
+
+#endif /* TSINDEX_H */